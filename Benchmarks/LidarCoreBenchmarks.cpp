@@ -0,0 +1,531 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Microbenchmarks of the lidar core, reported as points per second (items_per_second).
+// Every benchmark works on full revolutions of an HDL-32E scanning the analytic street scene,
+// so the numbers are comparable between stages and between runs.
+
+#include "LidarAnalyticScene.h"
+#include "LidarCloudSerializers.h"
+#include "LidarCsvWriter.h"
+#include "LidarPointCloud.h"
+#include "LidarPointFilter.h"
+#include "LidarRangeImage.h"
+#include "LidarRecording.h"
+#include "LidarScanPattern.h"
+#include "LidarSensorModel.h"
+#include "LidarTriangleBvh.h"
+#include "LidarVelodynePackets.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// The sensor actor's defaults: 0.4 degree columns and the beam start 7.21 cm above the mount
+constexpr float AngularResolution = 0.4f;
+constexpr int32_t ColumnsPerRevolution = 900;
+constexpr float BeamStartRelativeZ = 7.21f;
+constexpr float SensorHeight = 180.f;
+constexpr float SimTimeFramerate = 9000.f;
+
+FLidarSensorModelSettings MakeSettings() {
+    FLidarSensorModelSettings Settings;
+    Settings.LidarRange = 10000.f;
+    Settings.RangeAccuracy = 2.f;
+    Settings.MaxRangeNoReturnProbability = 1.f;
+    Settings.FalloffStdDev = 10.f;
+    Settings.IntensityAffectedByAngle = 1.f;
+    Settings.NoiseSeed = 1;
+    return Settings;
+}
+
+// The head transform and beam start of one column, as the actor fires it
+struct FColumnFrame {
+    FLidarRigidTransform Head;
+    FLidarVector3 BeamStart;
+};
+
+FColumnFrame GetColumnFrame(const FLidarScanPattern &Pattern, int32_t Column) {
+    FColumnFrame Frame;
+    Frame.Head = FLidarRigidTransform::FromRotator(0.f, Column * AngularResolution, 0.f,
+                                                   FLidarVector3(0.f, 0.f, SensorHeight));
+    Frame.BeamStart = Pattern.GetBeamStart(Frame.Head, BeamStartRelativeZ);
+    return Frame;
+}
+
+// Trace one column against the scene and store it in the cloud, the way the actor does
+void TraceColumn(const FLidarScanPattern &Pattern, const FLidarSensorModel &Model,
+                 const FLidarAnalyticScene &Scene, int32_t Column, FLidarPointCloud &Cloud) {
+    const FColumnFrame Frame = GetColumnFrame(Pattern, Column);
+    const int32_t FirstPoint = Cloud.AddUninitialized(Pattern.Num());
+    for (int32_t Beam = 0; Beam < Pattern.Num(); Beam++) {
+        const FLidarVector3 End = Pattern.GetBeamEnd(Frame.Head, Frame.BeamStart, Beam,
+                                                     Model.GetSettings().LidarRange);
+        const FLidarAnalyticHit Hit = Scene.Trace(Frame.BeamStart, End);
+        if (Hit.bBlockingHit) {
+            Model.StoreReturn(Cloud, FirstPoint + Beam, Frame.BeamStart, Hit.ImpactPoint,
+                              Hit.ImpactNormal, Hit.Distance);
+            // Every surface has the actor's default reflectivity
+            Cloud.Intensity[FirstPoint + Beam] = 0.5f * 255.f;
+        } else {
+            Model.StoreMiss(Cloud, FirstPoint + Beam, End);
+        }
+        Cloud.SetFiring(FirstPoint + Beam, Column / SimTimeFramerate, Beam, Column);
+    }
+}
+
+// One traced revolution shared by the per-stage benchmarks
+struct FRevolutionFixture {
+    FLidarScanPattern Pattern = FLidarScanPattern(FLidarBeamTables::VelodyneHDL32E());
+    FLidarSensorModel Model = FLidarSensorModel(MakeSettings());
+    FLidarAnalyticScene Scene = FLidarAnalyticScene::MakeStreetScene();
+    FLidarPointCloud Cloud;
+
+    FRevolutionFixture() {
+        Cloud.Reset(ColumnsPerRevolution * Pattern.Num());
+        for (int32_t Column = 0; Column < ColumnsPerRevolution; Column++) {
+            TraceColumn(Pattern, Model, Scene, Column, Cloud);
+        }
+    }
+
+    static const FRevolutionFixture &Get() {
+        static const FRevolutionFixture Fixture;
+        return Fixture;
+    }
+};
+
+void BM_AnalyticTrace(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    FLidarPointCloud Cloud;
+    Cloud.Reset(Fixture.Cloud.Num());
+    for (auto _ : State) {
+        Cloud.Reset(Fixture.Cloud.Num());
+        for (int32_t Column = 0; Column < ColumnsPerRevolution; Column++) {
+            TraceColumn(Fixture.Pattern, Fixture.Model, Fixture.Scene, Column, Cloud);
+        }
+        benchmark::DoNotOptimize(Cloud.Flags.data());
+    }
+    State.SetItemsProcessed(State.iterations() * Fixture.Cloud.Num());
+}
+BENCHMARK(BM_AnalyticTrace);
+
+// Add a rectangle from Corner along SideU and SideV, tiled NumU by NumV
+void AddGrid(const FLidarVector3 &Corner, const FLidarVector3 &SideU, const FLidarVector3 &SideV,
+             int32_t NumU, int32_t NumV, int32_t ObjectIndex, FLidarTriangleBvh &Mesh) {
+    std::vector<FLidarVector3> Vertices;
+    std::vector<uint32_t> Indices;
+    for (int32_t V = 0; V <= NumV; V++) {
+        for (int32_t U = 0; U <= NumU; U++) {
+            Vertices.push_back(Corner + SideU * ((float)U / NumU) + SideV * ((float)V / NumV));
+        }
+    }
+    for (int32_t V = 0; V < NumV; V++) {
+        for (int32_t U = 0; U < NumU; U++) {
+            const uint32_t First = V * (NumU + 1) + U;
+            const uint32_t Quad[6] = {First, First + 1, First + NumU + 2,
+                                      First, First + NumU + 2, First + NumU + 1};
+            Indices.insert(Indices.end(), Quad, Quad + 6);
+        }
+    }
+    Mesh.AddMesh(Vertices.data(), Indices.data(), (int32_t)Indices.size() / 3, ObjectIndex);
+}
+
+void AddSphere(const FLidarVector3 &Center, float Radius, int32_t ObjectIndex,
+               FLidarTriangleBvh &Mesh) {
+    constexpr int32_t NumRings = 12;
+    constexpr int32_t NumSegments = 24;
+    const float Pi = 3.14159265358979323846f;
+    std::vector<FLidarVector3> Vertices;
+    std::vector<uint32_t> Indices;
+    for (int32_t Ring = 0; Ring <= NumRings; Ring++) {
+        const float Polar = Pi * Ring / NumRings;
+        for (int32_t Segment = 0; Segment <= NumSegments; Segment++) {
+            const float Azimuth = 2.f * Pi * Segment / NumSegments;
+            Vertices.push_back(Center + FLidarVector3(std::sin(Polar) * std::cos(Azimuth),
+                                                      std::sin(Polar) * std::sin(Azimuth),
+                                                      std::cos(Polar)) * Radius);
+        }
+    }
+    for (int32_t Ring = 0; Ring < NumRings; Ring++) {
+        for (int32_t Segment = 0; Segment < NumSegments; Segment++) {
+            const uint32_t First = Ring * (NumSegments + 1) + Segment;
+            const uint32_t Quad[6] = {First, First + NumSegments + 1, First + 1,
+                                      First + 1, First + NumSegments + 1, First + NumSegments + 2};
+            Indices.insert(Indices.end(), Quad, Quad + 6);
+        }
+    }
+    Mesh.AddMesh(Vertices.data(), Indices.data(), (int32_t)Indices.size() / 3, ObjectIndex);
+}
+
+// The street scene as meshes, the way the actor snapshots static geometry: the ground and
+// walls in 1 m tiles and the spheres as 576 triangles each, about 17k triangles in all
+const FLidarTriangleBvh &GetStreetMesh() {
+    static const FLidarTriangleBvh Mesh = [] {
+        FLidarTriangleBvh Street;
+        const float Wall = 3000.f;
+        const float WallHeight = 1000.f;
+        AddGrid(FLidarVector3(-Wall, -Wall, 0.f), FLidarVector3(2.f * Wall, 0.f, 0.f),
+                FLidarVector3(0.f, 2.f * Wall, 0.f), 60, 60, 0, Street);
+        for (int32_t Side = 0; Side < 4; Side++) {
+            const FLidarRigidTransform Frame = FLidarRigidTransform::FromRotator(
+                    0.f, 90.f * Side, 0.f, FLidarVector3());
+            AddGrid(Frame.TransformPosition(FLidarVector3(Wall, -Wall, 0.f)),
+                    Frame.TransformVector(FLidarVector3(0.f, 2.f * Wall, 0.f)),
+                    FLidarVector3(0.f, 0.f, WallHeight), 60, 10, 1 + Side, Street);
+        }
+        const int32_t NumSpheres = 12;
+        for (int32_t i = 0; i < NumSpheres; i++) {
+            const float Angle = 2.f * 3.14159265358979323846f * i / NumSpheres;
+            AddSphere(FLidarVector3(1500.f * std::cos(Angle), 1500.f * std::sin(Angle), 100.f),
+                      (i % 3 == 0) ? 40.f : 150.f, 5 + i, Street);
+        }
+        Street.Build();
+        return Street;
+    }();
+    return Mesh;
+}
+
+// Tracing a revolution against the static mesh snapshot one beam at a time
+void BM_BvhTrace(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    const FLidarTriangleBvh &Mesh = GetStreetMesh();
+    const float Range = Fixture.Model.GetSettings().LidarRange;
+    int32_t NumHits = 0;
+    for (auto _ : State) {
+        for (int32_t Column = 0; Column < ColumnsPerRevolution; Column++) {
+            const FColumnFrame Frame = GetColumnFrame(Fixture.Pattern, Column);
+            for (int32_t Beam = 0; Beam < Fixture.Pattern.Num(); Beam++) {
+                const FLidarVector3 End =
+                        Fixture.Pattern.GetBeamEnd(Frame.Head, Frame.BeamStart, Beam, Range);
+                NumHits += Mesh.Trace(Frame.BeamStart, End).bBlockingHit;
+            }
+        }
+        benchmark::DoNotOptimize(NumHits);
+    }
+    State.SetItemsProcessed(State.iterations() * Fixture.Cloud.Num());
+}
+BENCHMARK(BM_BvhTrace);
+
+// The same, with each column's beams traced together as packets
+void BM_BvhTraceFan(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    const FLidarTriangleBvh &Mesh = GetStreetMesh();
+    const float Range = Fixture.Model.GetSettings().LidarRange;
+    const int32_t NumBeams = Fixture.Pattern.Num();
+    std::vector<FLidarVector3> Ends(NumBeams);
+    std::vector<FLidarBvhHit> Hits(NumBeams);
+    int32_t NumHits = 0;
+    for (auto _ : State) {
+        for (int32_t Column = 0; Column < ColumnsPerRevolution; Column++) {
+            const FColumnFrame Frame = GetColumnFrame(Fixture.Pattern, Column);
+            for (int32_t Beam = 0; Beam < NumBeams; Beam++) {
+                Ends[Beam] = Fixture.Pattern.GetBeamEnd(Frame.Head, Frame.BeamStart, Beam, Range);
+            }
+            Mesh.TraceFan(Frame.BeamStart, Ends.data(), NumBeams, Hits.data());
+            NumHits += Hits[0].bBlockingHit;
+        }
+        benchmark::DoNotOptimize(NumHits);
+    }
+    State.SetItemsProcessed(State.iterations() * Fixture.Cloud.Num());
+}
+BENCHMARK(BM_BvhTraceFan);
+
+// StaticSnapshot mode for a sensor on a car, on its front bumper (0) or its roof (1), with two
+// more cars about. Each column is traced as a fan, then clipped against the cars' bounds the
+// way the actor picks the stretches of its beams the engine has to trace. Reports the
+// fraction of the beams that need the engine at all, and of their length it traces.
+void BM_SnapshotMountedSensor(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    const FLidarTriangleBvh &Mesh = GetStreetMesh();
+    const float Range = Fixture.Model.GetSettings().LidarRange;
+    const int32_t NumBeams = Fixture.Pattern.Num();
+    const FLidarBox Cars[3] = {
+            FLidarBox(FLidarVector3(-230.f, -90.f, 0.f), FLidarVector3(230.f, 90.f, 150.f)),
+            FLidarBox(FLidarVector3(600.f, 200.f, 0.f), FLidarVector3(1060.f, 380.f, 150.f)),
+            FLidarBox(FLidarVector3(-1400.f, -500.f, 0.f), FLidarVector3(-940.f, -320.f, 150.f))};
+    const FLidarVector3 Mount = State.range(0) == 0 ? FLidarVector3(220.f, 0.f, 50.f)
+                                                    : FLidarVector3(0.f, 0.f, 150.f);
+    std::vector<FLidarVector3> Ends(NumBeams);
+    std::vector<FLidarBvhHit> Hits(NumBeams);
+    int64_t NumEngineRays = 0;
+    double PathLength = 0.0;
+    double EngineLength = 0.0;
+    for (auto _ : State) {
+        for (int32_t Column = 0; Column < ColumnsPerRevolution; Column++) {
+            const FLidarRigidTransform Head = FLidarRigidTransform::FromRotator(
+                    0.f, Column * AngularResolution, 0.f, Mount);
+            const FLidarVector3 BeamStart = Fixture.Pattern.GetBeamStart(Head, BeamStartRelativeZ);
+            for (int32_t Beam = 0; Beam < NumBeams; Beam++) {
+                Ends[Beam] = Fixture.Pattern.GetBeamEnd(Head, BeamStart, Beam, Range);
+            }
+            Mesh.TraceFan(BeamStart, Ends.data(), NumBeams, Hits.data());
+            for (int32_t Beam = 0; Beam < NumBeams; Beam++) {
+                const FLidarVector3 PathEnd =
+                        Hits[Beam].bBlockingHit ? Hits[Beam].ImpactPoint : Ends[Beam];
+                float SpanEnter = 1.f;
+                float SpanExit = 0.f;
+                for (const FLidarBox &Car : Cars) {
+                    float Enter, Exit;
+                    if (Car.ClipSegment(BeamStart, PathEnd, Enter, Exit)) {
+                        SpanEnter = std::min(SpanEnter, Enter);
+                        SpanExit = std::max(SpanExit, Exit);
+                    }
+                }
+                const float Length = (PathEnd - BeamStart).Size();
+                PathLength += Length;
+                if (SpanEnter <= SpanExit) {
+                    NumEngineRays++;
+                    EngineLength += (SpanExit - SpanEnter) * Length;
+                }
+            }
+        }
+        benchmark::DoNotOptimize(NumEngineRays);
+    }
+    State.SetItemsProcessed(State.iterations() * Fixture.Cloud.Num());
+    State.counters["engine_rays"] =
+            (double)NumEngineRays / ((double)State.iterations() * Fixture.Cloud.Num());
+    State.counters["engine_length"] = PathLength > 0.0 ? EngineLength / PathLength : 0.0;
+}
+BENCHMARK(BM_SnapshotMountedSensor)->Arg(0)->Arg(1);
+
+void BM_Dropout(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    FLidarPointCloud Cloud = Fixture.Cloud;
+    const int32_t NumBeams = Fixture.Pattern.Num();
+    for (auto _ : State) {
+        // Start from the traced returns every time, so each pass drops the same beams
+        Cloud.Flags = Fixture.Cloud.Flags;
+        int32_t NumReturns = 0;
+        for (int32_t Column = 0; Column < ColumnsPerRevolution; Column++) {
+            NumReturns += Fixture.Model.ApplyDropout(Cloud, Column * NumBeams, NumBeams, 0,
+                                                     Column);
+        }
+        benchmark::DoNotOptimize(NumReturns);
+    }
+    State.SetItemsProcessed(State.iterations() * Cloud.Num());
+}
+BENCHMARK(BM_Dropout);
+
+void BM_RangeNoise(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    FLidarPointCloud Cloud = Fixture.Cloud;
+    const int32_t NumBeams = Fixture.Pattern.Num();
+    uint32_t Revolution = 0;
+    for (auto _ : State) {
+        for (int32_t Column = 0; Column < ColumnsPerRevolution; Column++) {
+            const FColumnFrame Frame = GetColumnFrame(Fixture.Pattern, Column);
+            Fixture.Model.ApplyRangeNoise(Cloud, Column * NumBeams, NumBeams, Frame.BeamStart,
+                                          Revolution, Column);
+        }
+        Revolution++;
+        benchmark::DoNotOptimize(Cloud.X.data());
+    }
+    State.SetItemsProcessed(State.iterations() * Cloud.Num());
+}
+BENCHMARK(BM_RangeNoise);
+
+void BM_Intensity(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    FLidarPointCloud Cloud = Fixture.Cloud;
+    const int32_t NumBeams = Fixture.Pattern.Num();
+    for (auto _ : State) {
+        Cloud.Intensity = Fixture.Cloud.Intensity;
+        for (int32_t Column = 0; Column < ColumnsPerRevolution; Column++) {
+            Fixture.Model.ApplyIntensity(Cloud, Column * NumBeams, NumBeams);
+        }
+        benchmark::DoNotOptimize(Cloud.Intensity.data());
+    }
+    State.SetItemsProcessed(State.iterations() * Cloud.Num());
+}
+BENCHMARK(BM_Intensity);
+
+void BM_TransformToLocal(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    FLidarPointCloud Cloud = Fixture.Cloud;
+    const int32_t NumBeams = Fixture.Pattern.Num();
+    const FLidarRigidTransform Sensor =
+            FLidarRigidTransform::FromRotator(1.f, 30.f, -2.f, FLidarVector3(0.f, 0.f, 180.f));
+    for (auto _ : State) {
+        Cloud.X = Fixture.Cloud.X;
+        Cloud.Y = Fixture.Cloud.Y;
+        Cloud.Z = Fixture.Cloud.Z;
+        for (int32_t Column = 0; Column < ColumnsPerRevolution; Column++) {
+            FLidarSensorModel::TransformToOutputFrame(Cloud, Column * NumBeams, NumBeams, Sensor,
+                                                      true);
+        }
+        benchmark::DoNotOptimize(Cloud.X.data());
+    }
+    State.SetItemsProcessed(State.iterations() * Cloud.Num());
+}
+BENCHMARK(BM_TransformToLocal);
+
+// Misses dropped, a 40 m by 40 m box around the sensor and a voxel grid of the given size in
+// cm, reporting the fraction of the points kept
+void BM_PointFilter(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    FLidarPointCloud Cloud = Fixture.Cloud;
+    const int32_t NumBeams = Fixture.Pattern.Num();
+    FLidarPointFilterSettings Settings;
+    Settings.bDropMisses = true;
+    Settings.bCropToRegion = true;
+    Settings.RegionExtent = FLidarVector3(2000.f, 2000.f, 500.f);
+    Settings.VoxelSize = (float)State.range(0);
+    FLidarPointFilter Filter(Settings, Cloud.Num());
+    int32_t NumKept = 0;
+    for (auto _ : State) {
+        // Each pass is a new revolution of the same points
+        Cloud.Flags = Fixture.Cloud.Flags;
+        Cloud.Revolution++;
+        NumKept = 0;
+        for (int32_t Column = 0; Column < ColumnsPerRevolution; Column++) {
+            NumKept += Filter.Apply(Cloud, Column * NumBeams, NumBeams,
+                                    GetColumnFrame(Fixture.Pattern, Column).Head);
+        }
+        benchmark::DoNotOptimize(Cloud.Flags.data());
+    }
+    State.SetItemsProcessed(State.iterations() * Cloud.Num());
+    State.counters["kept"] = (double)NumKept / Cloud.Num();
+}
+BENCHMARK(BM_PointFilter)->Arg(10)->Arg(50);
+
+void BM_SerializeCsv(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    FLidarVectorByteSink Sink;
+    for (auto _ : State) {
+        Sink.Bytes.clear();
+        FLidarCloudSerializers::AppendCsv(Fixture.Cloud, 0, Fixture.Cloud.Num(), "\n", Sink);
+        benchmark::DoNotOptimize(Sink.Bytes.data());
+    }
+    State.SetItemsProcessed(State.iterations() * Fixture.Cloud.Num());
+    State.SetBytesProcessed(State.iterations() * Sink.Bytes.size());
+}
+BENCHMARK(BM_SerializeCsv);
+
+// The same rows as BM_SerializeCsv, byte for byte at the default precision, and with the
+// shortest text that round-trips
+void BM_CsvWriter(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    const int32_t Decimals = (int32_t)State.range(0);
+    FLidarCsvWriter Writer(Decimals == FLidarCsvWriter::ShortestRoundTrip ? Decimals : 9,
+                           Decimals);
+    FLidarVectorByteSink Sink;
+    for (auto _ : State) {
+        Sink.Bytes.clear();
+        Writer.Append(Fixture.Cloud, 0, Fixture.Cloud.Num(), "\n", Sink);
+        benchmark::DoNotOptimize(Sink.Bytes.data());
+    }
+    State.SetItemsProcessed(State.iterations() * Fixture.Cloud.Num());
+    State.SetBytesProcessed(State.iterations() * Sink.Bytes.size());
+}
+BENCHMARK(BM_CsvWriter)->Arg(6)->Arg(FLidarCsvWriter::ShortestRoundTrip);
+
+template <void (*Serialize)(const FLidarPointCloud &, FLidarByteSink &)>
+void BM_SerializeBinary(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    FLidarVectorByteSink Sink;
+    for (auto _ : State) {
+        Sink.Bytes.clear();
+        Serialize(Fixture.Cloud, Sink);
+        benchmark::DoNotOptimize(Sink.Bytes.data());
+    }
+    State.SetItemsProcessed(State.iterations() * Fixture.Cloud.Num());
+    State.SetBytesProcessed(State.iterations() * Sink.Bytes.size());
+}
+BENCHMARK_TEMPLATE(BM_SerializeBinary, &FLidarCloudSerializers::AppendPcdBinary)
+        ->Name("BM_SerializePcdBinary");
+BENCHMARK_TEMPLATE(BM_SerializeBinary, &FLidarCloudSerializers::AppendPlyBinary)
+        ->Name("BM_SerializePlyBinary");
+BENCHMARK_TEMPLATE(BM_SerializeBinary, &FLidarCloudSerializers::AppendKittiBin)
+        ->Name("BM_SerializeKittiBin");
+
+void BM_VelodynePcap(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    const int32_t NumBeams = Fixture.Pattern.Num();
+    FLidarVelodynePacketEncoder Encoder;
+    FLidarVectorByteSink Sink;
+    for (auto _ : State) {
+        Sink.Bytes.clear();
+        for (int32_t Column = 0; Column < ColumnsPerRevolution; Column++) {
+            if (Encoder.AddColumn(Fixture.Cloud, Column * NumBeams, NumBeams,
+                                  Column * AngularResolution)) {
+                std::memcpy(Sink.Append(FLidarVelodynePacketEncoder::PcapRecordSize),
+                            Encoder.GetPcapRecord(), FLidarVelodynePacketEncoder::PcapRecordSize);
+            }
+        }
+        benchmark::DoNotOptimize(Sink.Bytes.data());
+    }
+    State.SetItemsProcessed(State.iterations() * Fixture.Cloud.Num());
+    State.SetBytesProcessed(State.iterations() * Sink.Bytes.size());
+}
+BENCHMARK(BM_VelodynePcap);
+
+// Quantizing a revolution into a range image frame, before compression
+void BM_RangeImage(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    FLidarRangeImageEncoder Encoder(Fixture.Pattern.Num(), ColumnsPerRevolution, 0.5f);
+    FLidarVectorByteSink Sink;
+    for (auto _ : State) {
+        Sink.Bytes.clear();
+        const std::vector<uint8_t> &Image = Encoder.BuildImage(Fixture.Cloud);
+        Encoder.AppendFrame(Fixture.Cloud.Revolution, Fixture.Cloud.Time[0],
+                            ELidarRangeImageCompression::None, Image.data(),
+                            (uint32_t)Image.size(), Sink);
+        benchmark::DoNotOptimize(Sink.Bytes.data());
+    }
+    State.SetItemsProcessed(State.iterations() * Fixture.Cloud.Num());
+    State.SetBytesProcessed(State.iterations() * Sink.Bytes.size());
+}
+BENCHMARK(BM_RangeImage);
+
+// Appending a revolution to a recording as a frame, every beam of it
+void BM_RecordingFrame(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    FLidarRecordingEncoder Encoder(Fixture.Pattern.Num(), Fixture.Pattern.Num(),
+                                   ColumnsPerRevolution, false);
+    FLidarVectorByteSink Sink;
+    for (auto _ : State) {
+        Sink.Bytes.clear();
+        Encoder.AppendFrame(Fixture.Cloud, Sink);
+        benchmark::DoNotOptimize(Sink.Bytes.data());
+    }
+    State.SetItemsProcessed(State.iterations() * Fixture.Cloud.Num());
+    State.SetBytesProcessed(State.iterations() * Sink.Bytes.size());
+}
+BENCHMARK(BM_RecordingFrame);
+
+// Every stage the actor runs for a revolution, from tracing to a PCD file in memory
+void BM_EndToEndRevolution(benchmark::State &State) {
+    const FRevolutionFixture &Fixture = FRevolutionFixture::Get();
+    const FLidarScanPattern &Pattern = Fixture.Pattern;
+    const FLidarSensorModel &Model = Fixture.Model;
+    const int32_t NumBeams = Pattern.Num();
+    FLidarPointCloudPool Pool;
+    FLidarVectorByteSink Sink;
+    uint32_t Revolution = 0;
+    for (auto _ : State) {
+        FLidarPointCloud* Cloud = Pool.Acquire(ColumnsPerRevolution * NumBeams);
+        for (int32_t Column = 0; Column < ColumnsPerRevolution; Column++) {
+            TraceColumn(Pattern, Model, Fixture.Scene, Column, *Cloud);
+            const FColumnFrame Frame = GetColumnFrame(Pattern, Column);
+            const int32_t FirstPoint = Column * NumBeams;
+            Model.ApplyDropout(*Cloud, FirstPoint, NumBeams, Revolution, Column);
+            Model.ApplyRangeNoise(*Cloud, FirstPoint, NumBeams, Frame.BeamStart, Revolution,
+                                  Column);
+            Model.ApplyIntensity(*Cloud, FirstPoint, NumBeams);
+            FLidarSensorModel::TransformToOutputFrame(*Cloud, FirstPoint, NumBeams, Frame.Head,
+                                                      true);
+        }
+        Sink.Bytes.clear();
+        FLidarCloudSerializers::AppendPcdBinary(*Cloud, Sink);
+        benchmark::DoNotOptimize(Sink.Bytes.data());
+        Pool.Release(Cloud);
+        Revolution++;
+    }
+    State.SetItemsProcessed(State.iterations() * ColumnsPerRevolution * NumBeams);
+}
+BENCHMARK(BM_EndToEndRevolution)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
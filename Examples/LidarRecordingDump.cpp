@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// An example reader of the sensor's recording output: maps a .lrec file and prints a summary
+// of one frame, or of every frame, read in place.
+//
+//   LidarRecordingDump <recording.lrec> [frame | @seconds]
+//
+// A frame is picked by its index in the recording, or with @ by the time it was recorded at.
+
+#include "LidarRecording.h"
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+void PrintFrame(const FLidarRecordingReader &Reader, int32_t FrameIndex) {
+    FLidarRecordingFrameView View;
+    if (!Reader.GetFrame(FrameIndex, View)) {
+        std::printf("Frame %d: damaged\n", FrameIndex);
+        return;
+    }
+
+    int32_t NumReturns = 0;
+    float NearestRange = 0.f;
+    for (int32_t i = 0; i < View.NumPoints; i++) {
+        if (!View.HasReturn(i)) continue;
+        if (NumReturns == 0 || View.Range[i] < NearestRange) NearestRange = View.Range[i];
+        NumReturns++;
+    }
+    const FLidarVector3 &Position = View.Header->SensorPose.Origin;
+    std::printf("Frame %llu, revolution %d: %.6f to %.6f s, sensor at (%.1f, %.1f, %.1f), "
+                "%d points, %d returns, nearest %.1f cm\n",
+                (unsigned long long)View.Header->Sequence, View.Header->Revolution,
+                View.Header->StartTime, View.Header->EndTime, Position.X, Position.Y,
+                Position.Z, View.NumPoints, NumReturns, NearestRange);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::printf("Usage: LidarRecordingDump <recording.lrec> [frame | @seconds]\n");
+        return 1;
+    }
+
+    FLidarRecordingReader Reader;
+    if (!Reader.Open(argv[1])) {
+        std::printf("%s is not a lidar recording\n", argv[1]);
+        return 1;
+    }
+    const FLidarRecordingFileHeader &Header = Reader.GetFileHeader();
+    std::printf("%d frames of %u columns of %u beams%s\n", Reader.GetNumFrames(),
+                Header.ColumnsPerRevolution, Header.NumBeams,
+                Reader.IsRecovered() ? ", recovered without an index" : "");
+
+    if (argc > 2) {
+        const int32_t FrameIndex = argv[2][0] == '@' ? Reader.FindFrame(std::atof(argv[2] + 1))
+                                                     : std::atoi(argv[2]);
+        PrintFrame(Reader, FrameIndex);
+    } else {
+        for (int32_t i = 0; i < Reader.GetNumFrames(); i++) PrintFrame(Reader, i);
+    }
+    return 0;
+}
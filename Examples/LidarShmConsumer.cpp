@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// An example consumer of the sensor's shared-memory ring: waits for the sensor to create the
+// ring, then prints a summary of every revolution as it comes in, read in place.
+//
+//   LidarShmConsumer [ring name] [revolutions]
+//
+// The ring name defaults to the sensor's default, SpinningLidar, and the consumer runs until
+// it is stopped unless a number of revolutions is given.
+
+#include "LidarShmRing.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+int main(int argc, char** argv) {
+    const char* RingName = argc > 1 ? argv[1] : "SpinningLidar";
+    const long MaxRevolutions = argc > 2 ? std::atol(argv[2]) : 0;
+
+    FLidarShmRingReader Reader;
+    std::printf("Waiting for lidar ring %s\n", RingName);
+    while (!Reader.Open(RingName)) std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+    uint64_t LastSequence = 0;
+    long NumRevolutions = 0;
+    long NumTornReads = 0;
+    while (MaxRevolutions == 0 || NumRevolutions < MaxRevolutions) {
+        // Poll for the next revolution. A real consumer would do its own work in between.
+        if (Reader.GetLatestSequence() == LastSequence) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        FLidarShmRevolutionView View;
+        if (!Reader.AcquireLatest(View)) continue;
+
+        // Work on the points where they are, then check the writer didn't overwrite them
+        int32_t NumReturns = 0;
+        float NearestRange = 0.f;
+        for (int32_t i = 0; i < View.NumPoints; i++) {
+            if (!View.HasReturn(i)) continue;
+            if (NumReturns == 0 || View.Range[i] < NearestRange) NearestRange = View.Range[i];
+            NumReturns++;
+        }
+        if (!Reader.IsValid(View)) {
+            NumTornReads++;
+            continue;
+        }
+
+        if (LastSequence != 0 && View.Sequence > LastSequence + 1) {
+            std::printf("Skipped %llu revolutions\n",
+                        (unsigned long long)(View.Sequence - LastSequence - 1));
+        }
+        LastSequence = View.Sequence;
+        NumRevolutions++;
+        std::printf("Revolution %d: %d points, %d returns, nearest %.1f cm, %ld torn reads\n",
+                    View.Revolution, View.NumPoints, NumReturns, NearestRange, NumTornReads);
+    }
+    return 0;
+}
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarAnalyticScene.h"
+
+void FLidarAnalyticScene::AddPlane(const FLidarVector3 &Point, const FLidarVector3 &Normal) {
+    const FLidarVector3 UnitNormal = Normal.GetSafeNormal();
+    Planes.push_back({UnitNormal, FLidarVector3::Dot(UnitNormal, Point)});
+}
+
+void FLidarAnalyticScene::AddSphere(const FLidarVector3 &Center, float Radius) {
+    Spheres.push_back({Center, Radius});
+}
+
+FLidarAnalyticScene FLidarAnalyticScene::MakeStreetScene() {
+    FLidarAnalyticScene Scene;
+    Scene.AddPlane(FLidarVector3(0.f, 0.f, 0.f), FLidarVector3(0.f, 0.f, 1.f));
+
+    // Building fronts 30 m away on every side, facing the sensor
+    const float WallDistance = 3000.f;
+    Scene.AddPlane(FLidarVector3(WallDistance, 0.f, 0.f), FLidarVector3(-1.f, 0.f, 0.f));
+    Scene.AddPlane(FLidarVector3(-WallDistance, 0.f, 0.f), FLidarVector3(1.f, 0.f, 0.f));
+    Scene.AddPlane(FLidarVector3(0.f, WallDistance, 0.f), FLidarVector3(0.f, -1.f, 0.f));
+    Scene.AddPlane(FLidarVector3(0.f, -WallDistance, 0.f), FLidarVector3(0.f, 1.f, 0.f));
+
+    // Cars and pedestrians, as a ring of spheres 15 m out
+    const int32_t NumSpheres = 12;
+    for (int32_t i = 0; i < NumSpheres; i++) {
+        const float Angle = 2.f * 3.14159265358979323846f * i / NumSpheres;
+        Scene.AddSphere(FLidarVector3(1500.f * std::cos(Angle), 1500.f * std::sin(Angle), 100.f),
+                        (i % 3 == 0) ? 40.f : 150.f);
+    }
+    return Scene;
+}
+
+FLidarAnalyticHit FLidarAnalyticScene::Trace(const FLidarVector3 &Start,
+                                             const FLidarVector3 &End) const {
+    // Points along the beam are Start + Delta * T, for T from 0 to 1
+    const FLidarVector3 Delta = End - Start;
+    float NearestT = 1.f;
+    FLidarVector3 NearestNormal;
+    bool bHit = false;
+
+    for (const FPlane &Plane : Planes) {
+        const float Denominator = FLidarVector3::Dot(Plane.Normal, Delta);
+        // Parallel to the plane, or approaching its back side
+        if (Denominator >= 0.f) continue;
+        const float T = (Plane.Offset - FLidarVector3::Dot(Plane.Normal, Start)) / Denominator;
+        if (T >= 0.f && T < NearestT) {
+            NearestT = T;
+            NearestNormal = Plane.Normal;
+            bHit = true;
+        }
+    }
+
+    const float A = FLidarVector3::Dot(Delta, Delta);
+    for (const FSphere &Sphere : Spheres) {
+        // Solve |Start + Delta * T - Center| = Radius for the nearer root
+        const FLidarVector3 Offset = Start - Sphere.Center;
+        const float B = FLidarVector3::Dot(Offset, Delta);
+        const float C = FLidarVector3::Dot(Offset, Offset) - Sphere.Radius * Sphere.Radius;
+        const float Discriminant = B * B - A * C;
+        if (Discriminant < 0.f) continue;
+        const float T = (-B - std::sqrt(Discriminant)) / A;
+        if (T >= 0.f && T < NearestT) {
+            NearestT = T;
+            NearestNormal = (Offset + Delta * T) * (1.f / Sphere.Radius);
+            bHit = true;
+        }
+    }
+
+    FLidarAnalyticHit Hit;
+    Hit.bBlockingHit = bHit;
+    if (bHit) {
+        Hit.ImpactPoint = Start + Delta * NearestT;
+        Hit.ImpactNormal = NearestNormal;
+        Hit.Distance = std::sqrt(A) * NearestT;
+    }
+    return Hit;
+}
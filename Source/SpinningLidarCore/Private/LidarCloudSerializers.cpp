@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarCloudSerializers.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// The binary formats are written with the platform's own byte order
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Lidar binary output assumes a little-endian platform"
+#endif
+
+void FLidarCloudSerializers::AppendCsv(const FLidarPointCloud &Cloud, int32_t FirstPoint,
+                                       int32_t NumPoints, const char* LineTerminator,
+                                       FLidarByteSink &Out) {
+    // Timestamps are written to the nanosecond, which the beams' firing times resolve
+    char Line[512];
+    for (int32_t i = FirstPoint; i < FirstPoint + NumPoints; i++) {
+        if (!Cloud.HasBeamRow(i)) continue;
+
+        // The return index and label columns, where the cloud has them
+        char Extra[64];
+        int ExtraLength = 0;
+        Extra[0] = '\0';
+        if (Cloud.bMultiReturn) {
+            ExtraLength += std::snprintf(Extra, sizeof(Extra), ",%d", Cloud.GetReturnIndex(i));
+        }
+        if (Cloud.bLabeled) {
+            std::snprintf(Extra + ExtraLength, sizeof(Extra) - ExtraLength, ",%u,%u",
+                          (unsigned)Cloud.InstanceId[i], (unsigned)Cloud.ClassId[i]);
+        }
+        const int Length = std::snprintf(Line, sizeof(Line), "%.9f,%f,%f,%f,%f%s%s",
+                                         Cloud.Time[i], Cloud.X[i], Cloud.Y[i], Cloud.Z[i],
+                                         Cloud.Intensity[i], Extra, LineTerminator);
+        if (Length > 0) AppendText(Line, std::min((size_t)Length, sizeof(Line) - 1), Out);
+    }
+}
+
+void FLidarCloudSerializers::AppendPcdBinary(const FLidarPointCloud &Cloud,
+                                             FLidarByteSink &Out) {
+    const int32_t NumReturns = Cloud.CountReturns();
+
+    // PCD v0.7 header for an unorganized cloud, with the data section as raw records
+    const bool bReturnIndex = Cloud.bMultiReturn;
+    const bool bLabels = Cloud.bLabeled;
+    char Header[512];
+    const int Length = std::snprintf(Header, sizeof(Header),
+                                     "# .PCD v0.7 - Point Cloud Data file format\n"
+                                     "VERSION 0.7\n"
+                                     "FIELDS x y z intensity timestamp%s%s\n"
+                                     "SIZE 4 4 4 4 8%s%s\n"
+                                     "TYPE F F F F F%s%s\n"
+                                     "COUNT 1 1 1 1 1%s%s\n"
+                                     "WIDTH %d\n"
+                                     "HEIGHT 1\n"
+                                     "VIEWPOINT 0 0 0 1 0 0 0\n"
+                                     "POINTS %d\n"
+                                     "DATA binary\n",
+                                     bReturnIndex ? " return_index" : "",
+                                     bLabels ? " instance_id class_id" : "",
+                                     bReturnIndex ? " 1" : "", bLabels ? " 4 2" : "",
+                                     bReturnIndex ? " U" : "", bLabels ? " U U" : "",
+                                     bReturnIndex ? " 1" : "", bLabels ? " 1 1" : "",
+                                     NumReturns, NumReturns);
+    AppendText(Header, Length, Out);
+    AppendPointRecords(Cloud, NumReturns, Out);
+}
+
+void FLidarCloudSerializers::AppendPlyBinary(const FLidarPointCloud &Cloud,
+                                             FLidarByteSink &Out) {
+    const int32_t NumReturns = Cloud.CountReturns();
+
+    char Header[512];
+    const int Length = std::snprintf(Header, sizeof(Header),
+                                     "ply\n"
+                                     "format binary_little_endian 1.0\n"
+                                     "element vertex %d\n"
+                                     "property float x\n"
+                                     "property float y\n"
+                                     "property float z\n"
+                                     "property float intensity\n"
+                                     "property double timestamp\n"
+                                     "%s%s"
+                                     "end_header\n",
+                                     NumReturns,
+                                     Cloud.bMultiReturn ? "property uchar return_index\n" : "",
+                                     Cloud.bLabeled ? "property uint instance_id\n"
+                                                      "property ushort class_id\n" : "");
+    AppendText(Header, Length, Out);
+    AppendPointRecords(Cloud, NumReturns, Out);
+}
+
+void FLidarCloudSerializers::AppendKittiBin(const FLidarPointCloud &Cloud, FLidarByteSink &Out) {
+    // Convert each point in place in the output buffer, so there is no intermediate array
+    const int32_t NumReturns = Cloud.CountReturns();
+    FLidarKittiPoint* KittiPoint =
+            (FLidarKittiPoint*)Out.Append(NumReturns * sizeof(FLidarKittiPoint));
+    for (int32_t i = 0; i < Cloud.Num(); i++) {
+        if (!Cloud.HasReturn(i)) continue;
+        KittiPoint->X = Cloud.X[i] * 0.01f;
+        KittiPoint->Y = -Cloud.Y[i] * 0.01f;
+        KittiPoint->Z = Cloud.Z[i] * 0.01f;
+        KittiPoint->Reflectance = Cloud.Intensity[i] / 255.f;
+        KittiPoint++;
+    }
+}
+
+void FLidarCloudSerializers::AppendKittiLabels(const FLidarPointCloud &Cloud,
+                                               FLidarByteSink &Out) {
+    const int32_t NumReturns = Cloud.CountReturns();
+    uint32_t* Label = (uint32_t*)Out.Append(NumReturns * sizeof(uint32_t));
+    for (int32_t i = 0; i < Cloud.Num(); i++) {
+        if (!Cloud.HasReturn(i)) continue;
+        *Label++ = (Cloud.InstanceId[i] << 16) | Cloud.ClassId[i];
+    }
+}
+
+void FLidarCloudSerializers::AppendText(const char* Text, size_t Length, FLidarByteSink &Out) {
+    std::memcpy(Out.Append(Length), Text, Length);
+}
+
+// Pack every point that returned into a record, directly in the output buffer.
+// Multi-return clouds follow each record with a byte for the return index, and labeled clouds
+// with the uint32 instance id and uint16 class id.
+void FLidarCloudSerializers::AppendPointRecords(const FLidarPointCloud &Cloud,
+                                                int32_t NumReturns, FLidarByteSink &Out) {
+    if (Cloud.bMultiReturn || Cloud.bLabeled) {
+        const size_t RecordSize = sizeof(FLidarPointRecord) + (Cloud.bMultiReturn ? 1 : 0) +
+                                  (Cloud.bLabeled ? sizeof(uint32_t) + sizeof(uint16_t) : 0);
+        uint8_t* Record = Out.Append(NumReturns * RecordSize);
+        for (int32_t i = 0; i < Cloud.Num(); i++) {
+            if (!Cloud.HasReturn(i)) continue;
+            const FLidarPointRecord Point = {Cloud.X[i], Cloud.Y[i], Cloud.Z[i],
+                                             Cloud.Intensity[i], Cloud.Time[i]};
+            std::memcpy(Record, &Point, sizeof(Point));
+            uint8_t* Extra = Record + sizeof(Point);
+            if (Cloud.bMultiReturn) *Extra++ = (uint8_t)Cloud.GetReturnIndex(i);
+            if (Cloud.bLabeled) {
+                std::memcpy(Extra, &Cloud.InstanceId[i], sizeof(uint32_t));
+                std::memcpy(Extra + sizeof(uint32_t), &Cloud.ClassId[i], sizeof(uint16_t));
+            }
+            Record += RecordSize;
+        }
+        return;
+    }
+
+    FLidarPointRecord* Record =
+            (FLidarPointRecord*)Out.Append(NumReturns * sizeof(FLidarPointRecord));
+    for (int32_t i = 0; i < Cloud.Num(); i++) {
+        if (!Cloud.HasReturn(i)) continue;
+        Record->X = Cloud.X[i];
+        Record->Y = Cloud.Y[i];
+        Record->Z = Cloud.Z[i];
+        Record->Intensity = Cloud.Intensity[i];
+        Record->Timestamp = Cloud.Time[i];
+        Record++;
+    }
+}
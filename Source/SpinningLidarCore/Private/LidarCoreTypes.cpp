@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarCoreTypes.h"
+
+FLidarRigidTransform FLidarRigidTransform::FromRotator(float Pitch, float Yaw, float Roll,
+                                                       const FLidarVector3 &Location) {
+    const float SP = std::sin(Pitch * LidarDegreesToRadians);
+    const float CP = std::cos(Pitch * LidarDegreesToRadians);
+    const float SY = std::sin(Yaw * LidarDegreesToRadians);
+    const float CY = std::cos(Yaw * LidarDegreesToRadians);
+    const float SR = std::sin(Roll * LidarDegreesToRadians);
+    const float CR = std::cos(Roll * LidarDegreesToRadians);
+
+    // The rows of FRotationMatrix
+    FLidarRigidTransform Transform;
+    Transform.AxisX = FLidarVector3(CP * CY, CP * SY, SP);
+    Transform.AxisY = FLidarVector3(SR * SP * CY - CR * SY, SR * SP * SY + CR * CY, -SR * CP);
+    Transform.AxisZ = FLidarVector3(-(CR * SP * CY + SR * SY), CY * SR - CR * SP * SY, CR * CP);
+    Transform.Origin = Location;
+    return Transform;
+}
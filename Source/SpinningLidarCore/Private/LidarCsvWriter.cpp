@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarCsvWriter.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define LIDAR_FLOAT_TO_CHARS 1
+#else
+#define LIDAR_FLOAT_TO_CHARS 0
+#endif
+
+namespace {
+
+// The longest text of a number with the given decimals: a sign, every digit of the largest
+// value of the type, the point and the decimals, or an exponent in the shortest form
+template <typename T>
+constexpr size_t MaxNumberLength(int32_t Decimals) {
+    return 3 + std::numeric_limits<T>::max_exponent10 + std::max(Decimals, 0) +
+           std::numeric_limits<T>::max_digits10;
+}
+
+// Fixed decimals up to this many are formatted with integer arithmetic, for values below 2^32
+constexpr int32_t MaxIntegerDecimals = 9;
+constexpr uint64_t Pow10[MaxIntegerDecimals + 1] = {
+        1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+struct FUint128 {
+    uint64_t Hi;
+    uint64_t Lo;
+};
+
+FUint128 Multiply(uint64_t A, uint64_t B) {
+    const uint64_t LoLo = (A & 0xffffffffu) * (B & 0xffffffffu);
+    const uint64_t HiLo = (A >> 32) * (B & 0xffffffffu);
+    const uint64_t LoHi = (A & 0xffffffffu) * (B >> 32);
+    const uint64_t HiHi = (A >> 32) * (B >> 32);
+    const uint64_t Cross = (LoLo >> 32) + (HiLo & 0xffffffffu) + LoHi;
+    return {HiHi + (HiLo >> 32) + (Cross >> 32), (Cross << 32) | (LoLo & 0xffffffffu)};
+}
+
+// The significand and power of two of a finite, non-negative value, which is exactly
+// Significand * 2^Exponent
+void Decompose(float Value, uint64_t &OutSignificand, int32_t &OutExponent) {
+    uint32_t Bits;
+    std::memcpy(&Bits, &Value, sizeof(Bits));
+    const int32_t BiasedExponent = (Bits >> 23) & 0xff;
+    OutSignificand = Bits & 0x7fffff;
+    OutExponent = BiasedExponent == 0 ? -149 : BiasedExponent - 150;
+    if (BiasedExponent != 0) OutSignificand |= 0x800000;
+}
+
+void Decompose(double Value, uint64_t &OutSignificand, int32_t &OutExponent) {
+    uint64_t Bits;
+    std::memcpy(&Bits, &Value, sizeof(Bits));
+    const int32_t BiasedExponent = (Bits >> 52) & 0x7ff;
+    OutSignificand = Bits & ((1ull << 52) - 1);
+    OutExponent = BiasedExponent == 0 ? -1074 : BiasedExponent - 1075;
+    if (BiasedExponent != 0) OutSignificand |= 1ull << 52;
+}
+
+/*Write Value with Decimals decimals, rounded to nearest with ties to even like printf.
+ * The value times 10^Decimals is worked out exactly in 128 bits, then shifted down by the
+ * value's power of two, so this is exact for every value below 2^32 in magnitude. Returns
+ * null for anything else, which is left to the general formatting.*/
+template <typename T>
+char* WriteFixed(char* First, T Value, int32_t Decimals) {
+    if (!(std::fabs(Value) < (T)4294967296.0) || Decimals > MaxIntegerDecimals) return nullptr;
+    if (std::signbit(Value)) *First++ = '-';
+
+    uint64_t Significand;
+    int32_t Exponent;
+    Decompose(std::fabs(Value), Significand, Exponent);
+    uint64_t Scaled;
+    if (Exponent >= 0) {
+        Scaled = (Significand << Exponent) * Pow10[Decimals];
+    } else {
+        // Everything below the shift is the remainder, rounded against half of 2^Shift
+        const FUint128 Product = Multiply(Significand, Pow10[Decimals]);
+        const int32_t Shift = -Exponent;
+        if (Shift >= 128) {
+            Scaled = 0;
+        } else {
+            FUint128 Remainder;
+            FUint128 Half;
+            if (Shift < 64) {
+                Scaled = (Product.Hi << (64 - Shift)) | (Product.Lo >> Shift);
+                Remainder = {0, Product.Lo & ((1ull << Shift) - 1)};
+            } else {
+                Scaled = Product.Hi >> (Shift - 64);
+                Remainder = {Product.Hi & ((1ull << (Shift - 64)) - 1), Product.Lo};
+            }
+            Half = Shift - 1 < 64 ? FUint128{0, 1ull << (Shift - 1)}
+                                  : FUint128{1ull << (Shift - 65), 0};
+            const bool bAboveHalf = Remainder.Hi != Half.Hi ? Remainder.Hi > Half.Hi
+                                                            : Remainder.Lo > Half.Lo;
+            const bool bHalf = Remainder.Hi == Half.Hi && Remainder.Lo == Half.Lo;
+            if (bAboveHalf || (bHalf && (Scaled & 1))) Scaled++;
+        }
+    }
+
+    uint64_t Whole = Scaled / Pow10[Decimals];
+    uint64_t Fraction = Scaled % Pow10[Decimals];
+    char Digits[20];
+    int32_t NumDigits = 0;
+    do {
+        Digits[NumDigits++] = (char)('0' + Whole % 10);
+        Whole /= 10;
+    } while (Whole > 0);
+    while (NumDigits > 0) *First++ = Digits[--NumDigits];
+    if (Decimals > 0) {
+        *First++ = '.';
+        for (int32_t i = Decimals - 1; i >= 0; i--) {
+            First[i] = (char)('0' + Fraction % 10);
+            Fraction /= 10;
+        }
+        First += Decimals;
+    }
+    return First;
+}
+
+template <typename T>
+char* WriteNumber(char* First, char* Last, T Value, int32_t Decimals) {
+    if (Decimals != FLidarCsvWriter::ShortestRoundTrip) {
+        if (char* End = WriteFixed(First, Value, Decimals)) return End;
+    }
+#if LIDAR_FLOAT_TO_CHARS
+    return (Decimals == FLidarCsvWriter::ShortestRoundTrip)
+            ? std::to_chars(First, Last, Value).ptr
+            : std::to_chars(First, Last, Value, std::chars_format::fixed, Decimals).ptr;
+#else
+    const int Length = (Decimals == FLidarCsvWriter::ShortestRoundTrip)
+            ? std::snprintf(First, Last - First, "%.*g", std::numeric_limits<T>::max_digits10,
+                            (double)Value)
+            : std::snprintf(First, Last - First, "%.*f", Decimals, (double)Value);
+    return First + std::max(Length, 0);
+#endif
+}
+
+}  // namespace
+
+FLidarCsvWriter::FLidarCsvWriter(int32_t InTimestampDecimals, int32_t InValueDecimals)
+    : TimestampDecimals(std::clamp(InTimestampDecimals, ShortestRoundTrip, MaxDecimals)),
+      ValueDecimals(std::clamp(InValueDecimals, ShortestRoundTrip, MaxDecimals)) {}
+
+void FLidarCsvWriter::Append(const FLidarPointCloud &Cloud, int32_t FirstPoint,
+                             int32_t NumPoints, const char* LineTerminator,
+                             FLidarByteSink &Out) {
+    const size_t TerminatorLength = std::strlen(LineTerminator);
+    const size_t MaxRowLength = MaxNumberLength<double>(TimestampDecimals) +
+                                4 * (1 + MaxNumberLength<float>(ValueDecimals)) + 2 +
+                                2 * (1 + std::numeric_limits<uint32_t>::digits10 + 1) +
+                                TerminatorLength;
+
+    size_t Length = 0;
+    for (int32_t i = FirstPoint; i < FirstPoint + NumPoints; i++) {
+        if (!Cloud.HasBeamRow(i)) continue;
+        if (Buffer.size() < Length + MaxRowLength) {
+            Buffer.resize(std::max(2 * Buffer.size(), Length + MaxRowLength));
+        }
+
+        char* Row = Buffer.data() + Length;
+        char* const Last = Buffer.data() + Buffer.size();
+        Row = WriteNumber(Row, Last, Cloud.Time[i], TimestampDecimals);
+        *Row++ = ',';
+        Row = WriteNumber(Row, Last, Cloud.X[i], ValueDecimals);
+        *Row++ = ',';
+        Row = WriteNumber(Row, Last, Cloud.Y[i], ValueDecimals);
+        *Row++ = ',';
+        Row = WriteNumber(Row, Last, Cloud.Z[i], ValueDecimals);
+        *Row++ = ',';
+        Row = WriteNumber(Row, Last, Cloud.Intensity[i], ValueDecimals);
+        if (Cloud.bMultiReturn) {
+            *Row++ = ',';
+            *Row++ = (char)('0' + Cloud.GetReturnIndex(i));
+        }
+        if (Cloud.bLabeled) {
+            *Row++ = ',';
+            Row = std::to_chars(Row, Last, Cloud.InstanceId[i]).ptr;
+            *Row++ = ',';
+            Row = std::to_chars(Row, Last, Cloud.ClassId[i]).ptr;
+        }
+        std::memcpy(Row, LineTerminator, TerminatorLength);
+        Length = Row + TerminatorLength - Buffer.data();
+    }
+
+    if (Length > 0) std::memcpy(Out.Append(Length), Buffer.data(), Length);
+}
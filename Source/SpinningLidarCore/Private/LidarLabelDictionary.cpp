@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarLabelDictionary.h"
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+uint16_t FLidarLabelDictionary::FindOrAddClass(const std::string &Name) {
+    if (Name.empty()) return 0;
+    const auto Found = ClassIds.find(Name);
+    if (Found != ClassIds.end()) return Found->second;
+    if (ClassNames.size() >= std::numeric_limits<uint16_t>::max()) return 0;
+
+    ClassNames.push_back(Name);
+    const uint16_t ClassId = (uint16_t)ClassNames.size();
+    ClassIds.emplace(Name, ClassId);
+    return ClassId;
+}
+
+uint32_t FLidarLabelDictionary::AddInstance(const std::string &Name, uint16_t ClassId) {
+    if (Instances.size() >= std::numeric_limits<uint32_t>::max()) return 0;
+    Instances.push_back(FInstance{Name, ClassId});
+    return (uint32_t)Instances.size();
+}
+
+void FLidarLabelDictionary::AppendHeader(const char* LineTerminator, FLidarByteSink &Out) {
+    static const char Header[] = "kind,id,name,class id";
+    const size_t TerminatorLength = std::strlen(LineTerminator);
+    uint8_t* Row = Out.Append(sizeof(Header) - 1 + TerminatorLength);
+    std::memcpy(Row, Header, sizeof(Header) - 1);
+    std::memcpy(Row + sizeof(Header) - 1, LineTerminator, TerminatorLength);
+}
+
+void FLidarLabelDictionary::AppendNewEntries(const char* LineTerminator, FLidarByteSink &Out) {
+    // Classes come first, so every instance's class is defined before it
+    for (; NumClassesWritten < ClassNames.size(); NumClassesWritten++) {
+        AppendRow("class", (uint32_t)NumClassesWritten + 1, ClassNames[NumClassesWritten], "",
+                  LineTerminator, Out);
+    }
+    for (; NumInstancesWritten < Instances.size(); NumInstancesWritten++) {
+        const FInstance &Instance = Instances[NumInstancesWritten];
+        char ClassColumn[8];
+        std::snprintf(ClassColumn, sizeof(ClassColumn), "%u", (unsigned)Instance.ClassId);
+        AppendRow("instance", (uint32_t)NumInstancesWritten + 1, Instance.Name, ClassColumn,
+                  LineTerminator, Out);
+    }
+}
+
+void FLidarLabelDictionary::AppendRow(const char* Kind, uint32_t Id, const std::string &Name,
+                                      const char* ClassColumn, const char* LineTerminator,
+                                      FLidarByteSink &Out) {
+    std::string Row = Kind;
+    Row += ',';
+    Row += std::to_string(Id);
+    Row += ',';
+    if (Name.find_first_of(",\"\r\n") == std::string::npos) {
+        Row += Name;
+    } else {
+        // Quoted, with any quotes doubled
+        Row += '"';
+        for (const char Character : Name) {
+            if (Character == '"') Row += '"';
+            Row += Character;
+        }
+        Row += '"';
+    }
+    Row += ',';
+    Row += ClassColumn;
+    Row += LineTerminator;
+    std::memcpy(Out.Append(Row.size()), Row.data(), Row.size());
+}
@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarNoiseRng.h"
+#include <cmath>
+
+// Multipliers and key schedule constants from Salmon et al., "Parallel Random Numbers:
+// As Easy as 1, 2, 3" (SC11)
+static constexpr uint32_t PhiloxM0 = 0xD2511F53;
+static constexpr uint32_t PhiloxM1 = 0xCD9E8D57;
+static constexpr uint32_t PhiloxW0 = 0x9E3779B9;
+static constexpr uint32_t PhiloxW1 = 0xBB67AE85;
+static constexpr int32_t PhiloxRounds = 10;
+
+// Each uniform is built from the top 24 bits of a word, the precision of a float mantissa
+static constexpr float UniformScale = 1.f / 16777216.f;
+
+FLidarNoiseRng::FLidarNoiseRng(uint32_t Seed, uint32_t SensorId) {
+    Key[0] = Seed;
+    Key[1] = SensorId;
+}
+
+void FLidarNoiseRng::FillUniform(EStream Stream, uint32_t Revolution, uint32_t Column,
+                                 float* OutValues, int32_t FirstBeam, int32_t NumBeams) const {
+    uint32_t Bits[4];
+    float Values[4];
+    for (int32_t Beam = 0; Beam < NumBeams; Beam += 4) {
+        GenerateGroup(Stream, Revolution, Column, (FirstBeam + Beam) / 4, Bits);
+        UniformFromBits(Bits, Values);
+        for (int32_t Lane = 0; Lane < 4 && Beam + Lane < NumBeams; Lane++) {
+            OutValues[Beam + Lane] = Values[Lane];
+        }
+    }
+}
+
+void FLidarNoiseRng::FillGaussian(EStream Stream, uint32_t Revolution, uint32_t Column,
+                                  float* OutValues, int32_t FirstBeam, int32_t NumBeams) const {
+    uint32_t Bits[4];
+    float Values[4];
+    for (int32_t Beam = 0; Beam < NumBeams; Beam += 4) {
+        GenerateGroup(Stream, Revolution, Column, (FirstBeam + Beam) / 4, Bits);
+        GaussianFromBits(Bits, Values);
+        for (int32_t Lane = 0; Lane < 4 && Beam + Lane < NumBeams; Lane++) {
+            OutValues[Beam + Lane] = Values[Lane];
+        }
+    }
+}
+
+float FLidarNoiseRng::Uniform(EStream Stream, uint32_t Revolution, uint32_t Column,
+                              uint32_t Beam) const {
+    uint32_t Bits[4];
+    float Values[4];
+    GenerateGroup(Stream, Revolution, Column, Beam / 4, Bits);
+    UniformFromBits(Bits, Values);
+    return Values[Beam % 4];
+}
+
+float FLidarNoiseRng::Gaussian(EStream Stream, uint32_t Revolution, uint32_t Column,
+                               uint32_t Beam) const {
+    uint32_t Bits[4];
+    float Values[4];
+    GenerateGroup(Stream, Revolution, Column, Beam / 4, Bits);
+    GaussianFromBits(Bits, Values);
+    return Values[Beam % 4];
+}
+
+void FLidarNoiseRng::Philox4x32(const uint32_t Counter[4], const uint32_t InKey[2],
+                                uint32_t OutBits[4]) {
+    uint32_t C0 = Counter[0], C1 = Counter[1], C2 = Counter[2], C3 = Counter[3];
+    uint32_t K0 = InKey[0], K1 = InKey[1];
+
+    for (int32_t Round = 0; Round < PhiloxRounds; Round++) {
+        if (Round > 0) {
+            K0 += PhiloxW0;
+            K1 += PhiloxW1;
+        }
+        const uint64_t Product0 = (uint64_t)PhiloxM0 * C0;
+        const uint64_t Product1 = (uint64_t)PhiloxM1 * C2;
+        const uint32_t Hi0 = (uint32_t)(Product0 >> 32), Lo0 = (uint32_t)Product0;
+        const uint32_t Hi1 = (uint32_t)(Product1 >> 32), Lo1 = (uint32_t)Product1;
+        C0 = Hi1 ^ C1 ^ K0;
+        C1 = Lo1;
+        C2 = Hi0 ^ C3 ^ K1;
+        C3 = Lo0;
+    }
+
+    OutBits[0] = C0;
+    OutBits[1] = C1;
+    OutBits[2] = C2;
+    OutBits[3] = C3;
+}
+
+void FLidarNoiseRng::GenerateGroup(EStream Stream, uint32_t Revolution, uint32_t Column,
+                                   uint32_t Group, uint32_t OutBits[4]) const {
+    const uint32_t Counter[4] = {Group, Column, Revolution, (uint32_t)Stream};
+    Philox4x32(Counter, Key, OutBits);
+}
+
+void FLidarNoiseRng::UniformFromBits(const uint32_t Bits[4], float OutValues[4]) {
+    for (int32_t Lane = 0; Lane < 4; Lane++) {
+        OutValues[Lane] = (Bits[Lane] >> 8) * UniformScale;
+    }
+}
+
+// Box-Muller transform: each pair of uniforms gives a pair of independent standard normals
+void FLidarNoiseRng::GaussianFromBits(const uint32_t Bits[4], float OutValues[4]) {
+    for (int32_t Pair = 0; Pair < 2; Pair++) {
+        // Shifted into (0, 1] so that the logarithm is always finite
+        const float U1 = ((Bits[2 * Pair] >> 8) + 1) * UniformScale;
+        const float U2 = (Bits[2 * Pair + 1] >> 8) * UniformScale;
+        const float Radius = std::sqrt(-2.f * std::log(U1));
+        const float Angle = 2.f * 3.14159265358979323846f * U2;
+        OutValues[2 * Pair] = Radius * std::cos(Angle);
+        OutValues[2 * Pair + 1] = Radius * std::sin(Angle);
+    }
+}
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarPointCloud.h"
+
+int32_t FLidarPointCloud::CountReturns() const {
+    int32_t NumReturns = 0;
+    for (const uint8_t PointFlags : Flags) {
+        NumReturns += PointFlags & PointReturned;
+    }
+    return NumReturns;
+}
+
+int32_t FLidarPointCloud::AddUninitialized(int32_t Count) {
+    // The arrays only grow within the capacity reserved by Reset, so this never reallocates
+    // once a cloud has been through the pool
+    const int32_t FirstIndex = Num();
+    const size_t NewNum = (size_t)FirstIndex + Count;
+    X.resize(NewNum);
+    Y.resize(NewNum);
+    Z.resize(NewNum);
+    Range.resize(NewNum);
+    CosIncidence.resize(NewNum);
+    Intensity.resize(NewNum);
+    Time.resize(NewNum);
+    Beam.resize(NewNum);
+    Column.resize(NewNum);
+    Flags.resize(NewNum);
+    InstanceId.resize(NewNum);
+    ClassId.resize(NewNum);
+    return FirstIndex;
+}
+
+void FLidarPointCloud::Reset(int32_t Count) {
+    bMultiReturn = false;
+    bLabeled = false;
+    SensorPose = FLidarRigidTransform();
+    X.clear();
+    Y.clear();
+    Z.clear();
+    Range.clear();
+    CosIncidence.clear();
+    Intensity.clear();
+    Time.clear();
+    Beam.clear();
+    Column.clear();
+    Flags.clear();
+    InstanceId.clear();
+    ClassId.clear();
+    X.reserve(Count);
+    Y.reserve(Count);
+    Z.reserve(Count);
+    Range.reserve(Count);
+    CosIncidence.reserve(Count);
+    Intensity.reserve(Count);
+    Time.reserve(Count);
+    Beam.reserve(Count);
+    Column.reserve(Count);
+    Flags.reserve(Count);
+    InstanceId.reserve(Count);
+    ClassId.reserve(Count);
+}
+
+FLidarPointCloud* FLidarPointCloudPool::Acquire(int32_t Capacity) {
+    FLidarPointCloud* Cloud;
+    if (!FreeClouds.empty()) {
+        Cloud = FreeClouds.back();
+        FreeClouds.pop_back();
+    } else {
+        Clouds.push_back(std::make_unique<FLidarPointCloud>());
+        Cloud = Clouds.back().get();
+    }
+    Cloud->Reset(Capacity);
+    return Cloud;
+}
+
+void FLidarPointCloudPool::Release(FLidarPointCloud* Cloud) {
+    if (Cloud) FreeClouds.push_back(Cloud);
+}
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarPointFilter.h"
+#include <algorithm>
+#include <cmath>
+
+FLidarPointFilter::FLidarPointFilter(const FLidarPointFilterSettings &InSettings,
+                                     int32_t MaxPointsPerRevolution)
+    : Settings(InSettings) {
+    if (Settings.VoxelSize > 0.f) {
+        // Never more than half full, so that probes stay short
+        InverseVoxelSize = 1.f / Settings.VoxelSize;
+        MaxVoxels = std::max(MaxPointsPerRevolution, 1);
+        uint32_t NumSlots = 16;
+        while (NumSlots < 2 * (uint32_t)MaxVoxels) NumSlots *= 2;
+        Voxels.assign(NumSlots, FVoxelSlot{0, 0, 0, 0});
+        VoxelMask = NumSlots - 1;
+    }
+}
+
+int32_t FLidarPointFilter::Apply(FLidarPointCloud &Cloud, int32_t FirstPoint, int32_t NumPoints,
+                                 const FLidarRigidTransform &Sensor) {
+    if (!Voxels.empty() && Cloud.Revolution != Revolution) {
+        // Every voxel of the last generation now reads as empty
+        Revolution = Cloud.Revolution;
+        NumVoxels = 0;
+        if (++Generation == 0) {
+            for (FVoxelSlot &Voxel : Voxels) Voxel.Generation = 0;
+            Generation = 1;
+        }
+    }
+
+    int32_t NumReturns = 0;
+    for (int32_t PointIndex = FirstPoint; PointIndex < FirstPoint + NumPoints; PointIndex++) {
+        bool bKeep = true;
+        if (!Cloud.HasReturn(PointIndex)) {
+            bKeep = !Settings.bDropMisses;
+        } else {
+            const FLidarVector3 Position = Cloud.GetPosition(PointIndex);
+            if (Settings.bCropToRegion) {
+                const FLidarVector3 InRegion = Settings.Region.InverseTransformPosition(
+                        Sensor.InverseTransformPosition(Position));
+                bKeep = std::fabs(InRegion.X) <= Settings.RegionExtent.X &&
+                        std::fabs(InRegion.Y) <= Settings.RegionExtent.Y &&
+                        std::fabs(InRegion.Z) <= Settings.RegionExtent.Z;
+            }
+            if (bKeep && !Voxels.empty()) bKeep = AddVoxel(Position);
+            NumReturns += bKeep;
+        }
+
+        if (!bKeep) {
+            Cloud.Flags[PointIndex] = (uint8_t)(
+                    (Cloud.Flags[PointIndex] & ~FLidarPointCloud::PointReturned) |
+                    FLidarPointCloud::PointFiltered);
+        }
+    }
+    return NumReturns;
+}
+
+bool FLidarPointFilter::AddVoxel(const FLidarVector3 &Position) {
+    // Clamped so that very distant points or very small voxels can't overflow the indices
+    const auto GetIndex = [this](float Coordinate) {
+        return (int32_t)std::floor(
+                std::min(std::max(Coordinate * InverseVoxelSize, -1.e9f), 1.e9f));
+    };
+    const int32_t X = GetIndex(Position.X);
+    const int32_t Y = GetIndex(Position.Y);
+    const int32_t Z = GetIndex(Position.Z);
+
+    uint64_t Hash = (uint64_t)(uint32_t)X * 0x9E3779B97F4A7C15ull ^
+                    (uint64_t)(uint32_t)Y * 0xC2B2AE3D27D4EB4Full ^
+                    (uint64_t)(uint32_t)Z * 0x165667B19E3779F9ull;
+    Hash ^= Hash >> 32;
+    for (uint32_t Slot = (uint32_t)Hash & VoxelMask;; Slot = (Slot + 1) & VoxelMask) {
+        FVoxelSlot &Voxel = Voxels[Slot];
+        if (Voxel.Generation != Generation) {
+            // A revolution with more returns than the grid was sized for keeps the rest
+            if (NumVoxels >= MaxVoxels) return true;
+            Voxel = FVoxelSlot{X, Y, Z, Generation};
+            NumVoxels++;
+            return true;
+        }
+        if (Voxel.X == X && Voxel.Y == Y && Voxel.Z == Z) return false;
+    }
+}
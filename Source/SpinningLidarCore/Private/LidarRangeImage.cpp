@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarRangeImage.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+FLidarRangeImageEncoder::FLidarRangeImageEncoder(int32_t InNumRows, int32_t InNumColumns,
+                                                 float InRangeUnitCm)
+    : NumRows(std::max(InNumRows, 1)), NumColumns(std::max(InNumColumns, 1)),
+      RangeUnitCm(InRangeUnitCm > 0.f ? InRangeUnitCm : 1.f) {
+    Image.resize((size_t)NumRows * NumColumns * (sizeof(uint16_t) + sizeof(uint8_t)));
+}
+
+void FLidarRangeImageEncoder::AppendFileHeader(FLidarByteSink &Out) {
+    FLidarRangeImageFileHeader Header;
+    Header.Magic = FLidarRangeImageFileHeader::ExpectedMagic;
+    Header.Version = FLidarRangeImageFileHeader::CurrentVersion;
+    Header.NumRows = (uint32_t)NumRows;
+    Header.NumColumns = (uint32_t)NumColumns;
+    Header.RangeUnitCm = RangeUnitCm;
+    Header.Reserved = 0;
+    std::memcpy(Append(sizeof(Header), Out), &Header, sizeof(Header));
+}
+
+const std::vector<uint8_t> &FLidarRangeImageEncoder::BuildImage(const FLidarPointCloud &Cloud) {
+    const size_t NumCells = (size_t)NumRows * NumColumns;
+    uint16_t* RangePlane = reinterpret_cast<uint16_t*>(Image.data());
+    uint8_t* IntensityPlane = Image.data() + NumCells * sizeof(uint16_t);
+    std::memset(Image.data(), 0, Image.size());
+
+    // Range 0 is kept for no return, so returns closer than one unit are rounded up to it.
+    // A beam has one cell, so dual-return mode only fills it with the first return.
+    const float UnitsPerCm = 1.f / RangeUnitCm;
+    for (int32_t i = 0; i < Cloud.Num(); i++) {
+        if (!Cloud.HasReturn(i) || (Cloud.Flags[i] & FLidarPointCloud::PointSecondReturn) ||
+            Cloud.Beam[i] >= NumRows || Cloud.Column[i] >= NumColumns) {
+            continue;
+        }
+        const size_t Cell = (size_t)Cloud.Beam[i] * NumColumns + Cloud.Column[i];
+        const long Range = std::lround(Cloud.Range[i] * UnitsPerCm);
+        RangePlane[Cell] = (uint16_t)std::min(std::max(Range, 1L), 65535L);
+        IntensityPlane[Cell] = (uint8_t)std::lround(
+                std::min(std::max(Cloud.Intensity[i], 0.f), 255.f));
+    }
+    return Image;
+}
+
+void FLidarRangeImageEncoder::AppendFrame(int32_t Revolution, double StartTime,
+                                          ELidarRangeImageCompression Compression,
+                                          const uint8_t* Stored, uint32_t Size,
+                                          FLidarByteSink &Out) {
+    FLidarRangeImageIndexEntry Entry;
+    Entry.Offset = FileOffset;
+    Entry.Revolution = Revolution;
+    Entry.StoredSize = Size;
+    Entry.StartTime = StartTime;
+    Index.push_back(Entry);
+
+    FLidarRangeImageFrameHeader Header;
+    Header.Magic = FLidarRangeImageFrameHeader::ExpectedMagic;
+    Header.Revolution = Revolution;
+    Header.StartTime = StartTime;
+    Header.Compression = (uint32_t)Compression;
+    Header.StoredSize = Size;
+    Header.ImageSize = (uint32_t)Image.size();
+    Header.Reserved = 0;
+    uint8_t* Chunk = Append(sizeof(Header) + Size, Out);
+    std::memcpy(Chunk, &Header, sizeof(Header));
+    if (Size > 0) std::memcpy(Chunk + sizeof(Header), Stored, Size);
+}
+
+void FLidarRangeImageEncoder::AppendIndex(FLidarByteSink &Out) {
+    FLidarRangeImageFooter Footer;
+    Footer.IndexOffset = FileOffset;
+    Footer.NumFrames = (uint32_t)Index.size();
+    Footer.Magic = FLidarRangeImageFooter::ExpectedMagic;
+
+    const size_t IndexSize = Index.size() * sizeof(FLidarRangeImageIndexEntry);
+    uint8_t* Tail = Append(IndexSize + sizeof(Footer), Out);
+    if (IndexSize > 0) std::memcpy(Tail, Index.data(), IndexSize);
+    std::memcpy(Tail + IndexSize, &Footer, sizeof(Footer));
+    Index.clear();
+}
+
+uint8_t* FLidarRangeImageEncoder::Append(size_t Count, FLidarByteSink &Out) {
+    FileOffset += Count;
+    return Out.Append(Count);
+}
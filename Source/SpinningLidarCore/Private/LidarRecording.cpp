@@ -0,0 +1,348 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarRecording.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32) && defined(PLATFORM_WINDOWS)
+// In the engine build, windows.h has to come through the engine's wrapper
+#include "Windows/WindowsHWrapper.h"
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Chunks and the arrays in them start on 8-byte boundaries, so doubles can be read in place
+constexpr uint64_t Alignment = 8;
+
+uint64_t Align(uint64_t Bytes) {
+    return (Bytes + Alignment - 1) & ~(Alignment - 1);
+}
+
+}  // namespace
+
+FLidarRecordingEncoder::FLidarRecordingEncoder(int32_t InNumBeams, int32_t InPointsPerColumn,
+                                               int32_t InColumnsPerRevolution,
+                                               bool bInLocalCoordinates) {
+    FileHeader.Magic = FLidarRecordingFileHeader::ExpectedMagic;
+    FileHeader.Version = FLidarRecordingFileHeader::CurrentVersion;
+    FileHeader.Flags = bInLocalCoordinates ? (uint32_t)RecordingLocalCoordinates : 0u;
+    FileHeader.NumBeams = (uint32_t)std::max(InNumBeams, 0);
+    FileHeader.PointsPerColumn = (uint32_t)std::max(InPointsPerColumn, 0);
+    FileHeader.ColumnsPerRevolution = (uint32_t)std::max(InColumnsPerRevolution, 0);
+    FileHeader.Reserved = 0;
+}
+
+void FLidarRecordingEncoder::AppendFileHeader(FLidarByteSink &Out) {
+    std::memcpy(Append(sizeof(FileHeader), Out), &FileHeader, sizeof(FileHeader));
+}
+
+void FLidarRecordingEncoder::AppendFrame(const FLidarPointCloud &Cloud, FLidarByteSink &Out) {
+    const uint32_t NumPoints = (uint32_t)Cloud.Num();
+
+    FLidarRecordingFrameHeader Header;
+    Header.Magic = FLidarRecordingFrameHeader::ExpectedMagic;
+    Header.Layout = (Cloud.bMultiReturn ? (uint32_t)RecordingMultiReturn : 0u) |
+                    (Cloud.bLabeled ? (uint32_t)RecordingLabeled : 0u);
+    Header.Sequence = Index.size();
+    Header.Revolution = Cloud.Revolution;
+    Header.NumPoints = NumPoints;
+    Header.StartTime = NumPoints > 0 ? Cloud.Time.front() : 0.0;
+    Header.EndTime = NumPoints > 0 ? Cloud.Time.back() : 0.0;
+    Header.SensorPose = Cloud.SensorPose;
+    Header.Reserved = 0;
+
+    // Lay the arrays out one after another behind the header
+    uint64_t ChunkSize = sizeof(Header);
+    const auto Place = [&ChunkSize, NumPoints](uint32_t &OutOffset, size_t ElementSize) {
+        OutOffset = (uint32_t)ChunkSize;
+        ChunkSize += Align(NumPoints * ElementSize);
+    };
+    Place(Header.X, sizeof(float));
+    Place(Header.Y, sizeof(float));
+    Place(Header.Z, sizeof(float));
+    Place(Header.Range, sizeof(float));
+    Place(Header.Intensity, sizeof(float));
+    Place(Header.Time, sizeof(double));
+    Place(Header.Beam, sizeof(uint16_t));
+    Place(Header.Column, sizeof(uint16_t));
+    Place(Header.Flags, sizeof(uint8_t));
+    Header.InstanceId = 0;
+    Header.ClassId = 0;
+    if (Cloud.bLabeled) {
+        Place(Header.InstanceId, sizeof(uint32_t));
+        Place(Header.ClassId, sizeof(uint16_t));
+    }
+    Header.ChunkSize = ChunkSize;
+
+    FLidarRecordingIndexEntry Entry;
+    Entry.Offset = FileOffset;
+    Entry.Revolution = Header.Revolution;
+    Entry.NumPoints = NumPoints;
+    Entry.StartTime = Header.StartTime;
+    Index.push_back(Entry);
+
+    // The padding after each array is zeroed, so the same revolution always writes the same
+    // bytes
+    uint8_t* Chunk = Append(ChunkSize, Out);
+    std::memcpy(Chunk, &Header, sizeof(Header));
+    const auto Copy = [Chunk, NumPoints](uint32_t Offset, const void* Source,
+                                         size_t ElementSize) {
+        const size_t Size = NumPoints * ElementSize;
+        if (Size > 0) std::memcpy(Chunk + Offset, Source, Size);
+        std::memset(Chunk + Offset + Size, 0, Align(Size) - Size);
+    };
+    Copy(Header.X, Cloud.X.data(), sizeof(float));
+    Copy(Header.Y, Cloud.Y.data(), sizeof(float));
+    Copy(Header.Z, Cloud.Z.data(), sizeof(float));
+    Copy(Header.Range, Cloud.Range.data(), sizeof(float));
+    Copy(Header.Intensity, Cloud.Intensity.data(), sizeof(float));
+    Copy(Header.Time, Cloud.Time.data(), sizeof(double));
+    Copy(Header.Beam, Cloud.Beam.data(), sizeof(uint16_t));
+    Copy(Header.Column, Cloud.Column.data(), sizeof(uint16_t));
+    Copy(Header.Flags, Cloud.Flags.data(), sizeof(uint8_t));
+    if (Cloud.bLabeled) {
+        Copy(Header.InstanceId, Cloud.InstanceId.data(), sizeof(uint32_t));
+        Copy(Header.ClassId, Cloud.ClassId.data(), sizeof(uint16_t));
+    }
+}
+
+void FLidarRecordingEncoder::AppendIndex(FLidarByteSink &Out) {
+    FLidarRecordingFooter Footer;
+    Footer.IndexOffset = FileOffset;
+    Footer.NumFrames = (uint32_t)Index.size();
+    Footer.Magic = FLidarRecordingFooter::ExpectedMagic;
+
+    const size_t IndexSize = Index.size() * sizeof(FLidarRecordingIndexEntry);
+    uint8_t* Tail = Append(IndexSize + sizeof(Footer), Out);
+    if (IndexSize > 0) std::memcpy(Tail, Index.data(), IndexSize);
+    std::memcpy(Tail + IndexSize, &Footer, sizeof(Footer));
+    Index.clear();
+}
+
+uint8_t* FLidarRecordingEncoder::Append(size_t Count, FLidarByteSink &Out) {
+    FileOffset += Count;
+    return Out.Append(Count);
+}
+
+FLidarMappedFile::~FLidarMappedFile() {
+    Close();
+}
+
+bool FLidarMappedFile::Open(const char* Path) {
+    Close();
+#if defined(_WIN32)
+    // The sensor may still be writing the file
+    File = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (File == INVALID_HANDLE_VALUE) {
+        File = nullptr;
+        return false;
+    }
+    LARGE_INTEGER FileSize;
+    if (GetFileSizeEx(File, &FileSize) && FileSize.QuadPart > 0) {
+        Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    if (Mapping) Data = (uint8_t*)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!Data) {
+        if (Mapping) CloseHandle(Mapping);
+        CloseHandle(File);
+        Mapping = nullptr;
+        File = nullptr;
+        return false;
+    }
+    Size = (size_t)FileSize.QuadPart;
+#else
+    const int File = open(Path, O_RDONLY);
+    if (File < 0) return false;
+    struct stat Status;
+    if (fstat(File, &Status) != 0 || Status.st_size <= 0) {
+        close(File);
+        return false;
+    }
+    void* Mapped = mmap(nullptr, (size_t)Status.st_size, PROT_READ, MAP_SHARED, File, 0);
+    close(File);
+    if (Mapped == MAP_FAILED) return false;
+    Data = (uint8_t*)Mapped;
+    Size = (size_t)Status.st_size;
+#endif
+    return true;
+}
+
+void FLidarMappedFile::Close() {
+    if (!Data) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(Data);
+    CloseHandle(Mapping);
+    CloseHandle(File);
+    Mapping = nullptr;
+    File = nullptr;
+#else
+    munmap(Data, Size);
+#endif
+    Data = nullptr;
+    Size = 0;
+}
+
+bool FLidarRecordingReader::Open(const char* Path) {
+    Close();
+    if (!File.Open(Path)) return false;
+
+    const uint8_t* Data = File.GetData();
+    const size_t Size = File.GetSize();
+    const FLidarRecordingFileHeader* Header = (const FLidarRecordingFileHeader*)Data;
+    if (Size < sizeof(FLidarRecordingFileHeader) ||
+        Header->Magic != FLidarRecordingFileHeader::ExpectedMagic ||
+        Header->Version != FLidarRecordingFileHeader::CurrentVersion) {
+        File.Close();
+        return false;
+    }
+    FileHeader = Header;
+
+    // Use the index at the end if it is all there, and fall back to the chunks otherwise
+    FLidarRecordingFooter Footer;
+    if (Size >= sizeof(FLidarRecordingFileHeader) + sizeof(Footer)) {
+        std::memcpy(&Footer, Data + Size - sizeof(Footer), sizeof(Footer));
+        const uint64_t IndexEnd = Size - sizeof(Footer);
+        if (Footer.Magic == FLidarRecordingFooter::ExpectedMagic &&
+            Footer.IndexOffset >= sizeof(FLidarRecordingFileHeader) &&
+            Footer.IndexOffset % Alignment == 0 && Footer.IndexOffset <= IndexEnd &&
+            IndexEnd - Footer.IndexOffset ==
+                    (uint64_t)Footer.NumFrames * sizeof(FLidarRecordingIndexEntry)) {
+            Index = (const FLidarRecordingIndexEntry*)(Data + Footer.IndexOffset);
+            NumFrames = Footer.NumFrames;
+            return true;
+        }
+    }
+    RecoverIndex();
+    return true;
+}
+
+void FLidarRecordingReader::Close() {
+    File.Close();
+    FileHeader = nullptr;
+    Index = nullptr;
+    NumFrames = 0;
+    RecoveredIndex.clear();
+    bRecovered = false;
+}
+
+void FLidarRecordingReader::RecoverIndex() {
+    const uint8_t* Data = File.GetData();
+    const uint64_t Size = File.GetSize();
+    uint64_t Offset = sizeof(FLidarRecordingFileHeader);
+    while (Offset + sizeof(FLidarRecordingFrameHeader) <= Size) {
+        // Stop at the index, or at a chunk that was never finished
+        const FLidarRecordingFrameHeader* Header =
+                (const FLidarRecordingFrameHeader*)(Data + Offset);
+        if (Header->Magic != FLidarRecordingFrameHeader::ExpectedMagic ||
+            Header->ChunkSize < sizeof(FLidarRecordingFrameHeader) ||
+            Header->ChunkSize % Alignment != 0 || Header->ChunkSize > Size - Offset) {
+            break;
+        }
+
+        FLidarRecordingIndexEntry Entry;
+        Entry.Offset = Offset;
+        Entry.Revolution = Header->Revolution;
+        Entry.NumPoints = Header->NumPoints;
+        Entry.StartTime = Header->StartTime;
+        RecoveredIndex.push_back(Entry);
+        Offset += Header->ChunkSize;
+    }
+    Index = RecoveredIndex.data();
+    NumFrames = RecoveredIndex.size();
+    bRecovered = true;
+}
+
+bool FLidarRecordingReader::GetFrame(int32_t FrameIndex, FLidarRecordingFrameView &OutView) const {
+    if (FrameIndex < 0 || (size_t)FrameIndex >= NumFrames) return false;
+
+    const uint64_t Size = File.GetSize();
+    const uint64_t Offset = Index[FrameIndex].Offset;
+    if (Offset % Alignment != 0 || Size < sizeof(FLidarRecordingFrameHeader) ||
+        Offset > Size - sizeof(FLidarRecordingFrameHeader)) {
+        return false;
+    }
+    const uint8_t* Chunk = File.GetData() + Offset;
+    const FLidarRecordingFrameHeader* Header = (const FLidarRecordingFrameHeader*)Chunk;
+    if (Header->Magic != FLidarRecordingFrameHeader::ExpectedMagic ||
+        Header->ChunkSize > Size - Offset) {
+        return false;
+    }
+
+    // Every array has to be inside the chunk
+    const uint64_t NumPoints = Header->NumPoints;
+    bool bValid = true;
+    const auto Locate = [Chunk, Header, NumPoints, &bValid](uint32_t ArrayOffset,
+                                                            size_t ElementSize) {
+        if (ArrayOffset < sizeof(FLidarRecordingFrameHeader) || ArrayOffset % Alignment != 0 ||
+            ArrayOffset + NumPoints * ElementSize > Header->ChunkSize) {
+            bValid = false;
+            return (const void*)nullptr;
+        }
+        return (const void*)(Chunk + ArrayOffset);
+    };
+    OutView.Header = Header;
+    OutView.NumPoints = (int32_t)Header->NumPoints;
+    OutView.X = (const float*)Locate(Header->X, sizeof(float));
+    OutView.Y = (const float*)Locate(Header->Y, sizeof(float));
+    OutView.Z = (const float*)Locate(Header->Z, sizeof(float));
+    OutView.Range = (const float*)Locate(Header->Range, sizeof(float));
+    OutView.Intensity = (const float*)Locate(Header->Intensity, sizeof(float));
+    OutView.Time = (const double*)Locate(Header->Time, sizeof(double));
+    OutView.Beam = (const uint16_t*)Locate(Header->Beam, sizeof(uint16_t));
+    OutView.Column = (const uint16_t*)Locate(Header->Column, sizeof(uint16_t));
+    OutView.Flags = (const uint8_t*)Locate(Header->Flags, sizeof(uint8_t));
+    OutView.InstanceId = nullptr;
+    OutView.ClassId = nullptr;
+    if (Header->Layout & RecordingLabeled) {
+        OutView.InstanceId = (const uint32_t*)Locate(Header->InstanceId, sizeof(uint32_t));
+        OutView.ClassId = (const uint16_t*)Locate(Header->ClassId, sizeof(uint16_t));
+    }
+    return bValid;
+}
+
+int32_t FLidarRecordingReader::FindFrame(double Time) const {
+    if (NumFrames == 0) return -1;
+    const FLidarRecordingIndexEntry* After = std::upper_bound(
+            Index, Index + NumFrames, Time,
+            [](double Value, const FLidarRecordingIndexEntry &Entry) {
+                return Value < Entry.StartTime;
+            });
+    return (int32_t)std::max<ptrdiff_t>(After - Index - 1, 0);
+}
+
+bool FLidarRecordingReader::ReadFrame(int32_t FrameIndex, FLidarPointCloud &OutCloud) const {
+    FLidarRecordingFrameView View;
+    if (!GetFrame(FrameIndex, View)) return false;
+
+    const int32_t NumPoints = View.NumPoints;
+    OutCloud.Reset(NumPoints);
+    OutCloud.AddUninitialized(NumPoints);
+    OutCloud.Revolution = View.Header->Revolution;
+    OutCloud.bMultiReturn = (View.Header->Layout & RecordingMultiReturn) != 0;
+    OutCloud.bLabeled = (View.Header->Layout & RecordingLabeled) != 0;
+    OutCloud.SensorPose = View.Header->SensorPose;
+    std::memcpy(OutCloud.X.data(), View.X, NumPoints * sizeof(float));
+    std::memcpy(OutCloud.Y.data(), View.Y, NumPoints * sizeof(float));
+    std::memcpy(OutCloud.Z.data(), View.Z, NumPoints * sizeof(float));
+    std::memcpy(OutCloud.Range.data(), View.Range, NumPoints * sizeof(float));
+    std::memcpy(OutCloud.Intensity.data(), View.Intensity, NumPoints * sizeof(float));
+    std::memcpy(OutCloud.Time.data(), View.Time, NumPoints * sizeof(double));
+    std::memcpy(OutCloud.Beam.data(), View.Beam, NumPoints * sizeof(uint16_t));
+    std::memcpy(OutCloud.Column.data(), View.Column, NumPoints * sizeof(uint16_t));
+    std::memcpy(OutCloud.Flags.data(), View.Flags, NumPoints * sizeof(uint8_t));
+    if (OutCloud.bLabeled) {
+        std::memcpy(OutCloud.InstanceId.data(), View.InstanceId, NumPoints * sizeof(uint32_t));
+        std::memcpy(OutCloud.ClassId.data(), View.ClassId, NumPoints * sizeof(uint16_t));
+    }
+    return true;
+}
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarScanPattern.h"
+#include <algorithm>
+
+// Velodyne HDL-32E vertical angles by laser ID, from the HDL-32E user manual.
+// The lasers interleave the lower and upper halves of the field of view.
+static constexpr FLidarBeamAngles VelodyneHDL32ETable[] = {
+    {-30.67f, 0.f}, {-9.33f, 0.f}, {-29.33f, 0.f}, {-8.00f, 0.f},
+    {-28.00f, 0.f}, {-6.67f, 0.f}, {-26.67f, 0.f}, {-5.33f, 0.f},
+    {-25.33f, 0.f}, {-4.00f, 0.f}, {-24.00f, 0.f}, {-2.67f, 0.f},
+    {-22.67f, 0.f}, {-1.33f, 0.f}, {-21.33f, 0.f}, {0.00f, 0.f},
+    {-20.00f, 0.f}, {1.33f, 0.f}, {-18.67f, 0.f}, {2.67f, 0.f},
+    {-17.33f, 0.f}, {4.00f, 0.f}, {-16.00f, 0.f}, {5.33f, 0.f},
+    {-14.67f, 0.f}, {6.67f, 0.f}, {-13.33f, 0.f}, {8.00f, 0.f},
+    {-12.00f, 0.f}, {9.33f, 0.f}, {-10.67f, 0.f}, {10.67f, 0.f},
+};
+
+// Velodyne VLP-16 vertical angles by laser ID, from the VLP-16 user manual
+static constexpr FLidarBeamAngles VelodyneVLP16Table[] = {
+    {-15.f, 0.f}, {1.f, 0.f}, {-13.f, 0.f}, {3.f, 0.f},
+    {-11.f, 0.f}, {5.f, 0.f}, {-9.f, 0.f}, {7.f, 0.f},
+    {-7.f, 0.f}, {9.f, 0.f}, {-5.f, 0.f}, {11.f, 0.f},
+    {-3.f, 0.f}, {13.f, 0.f}, {-1.f, 0.f}, {15.f, 0.f},
+};
+
+// Ouster OS1-64 nominal beam intrinsics (beam_altitude_angles and beam_azimuth_angles),
+// top beam first. Each group of four beams is staggered across four azimuth offsets.
+static constexpr FLidarBeamAngles OusterOS1_64Table[] = {
+    {16.611f, 3.164f}, {16.084f, 1.055f}, {15.557f, -1.055f}, {15.029f, -3.164f},
+    {14.502f, 3.164f}, {13.975f, 1.055f}, {13.447f, -1.055f}, {12.920f, -3.164f},
+    {12.393f, 3.164f}, {11.865f, 1.055f}, {11.338f, -1.055f}, {10.811f, -3.164f},
+    {10.283f, 3.164f}, {9.756f, 1.055f}, {9.229f, -1.055f}, {8.701f, -3.164f},
+    {8.174f, 3.164f}, {7.646f, 1.055f}, {7.119f, -1.055f}, {6.592f, -3.164f},
+    {6.064f, 3.164f}, {5.537f, 1.055f}, {5.010f, -1.055f}, {4.482f, -3.164f},
+    {3.955f, 3.164f}, {3.428f, 1.055f}, {2.900f, -1.055f}, {2.373f, -3.164f},
+    {1.846f, 3.164f}, {1.318f, 1.055f}, {0.791f, -1.055f}, {0.264f, -3.164f},
+    {-0.264f, 3.164f}, {-0.791f, 1.055f}, {-1.318f, -1.055f}, {-1.846f, -3.164f},
+    {-2.373f, 3.164f}, {-2.900f, 1.055f}, {-3.428f, -1.055f}, {-3.955f, -3.164f},
+    {-4.482f, 3.164f}, {-5.010f, 1.055f}, {-5.537f, -1.055f}, {-6.064f, -3.164f},
+    {-6.592f, 3.164f}, {-7.119f, 1.055f}, {-7.646f, -1.055f}, {-8.174f, -3.164f},
+    {-8.701f, 3.164f}, {-9.229f, 1.055f}, {-9.756f, -1.055f}, {-10.283f, -3.164f},
+    {-10.811f, 3.164f}, {-11.338f, 1.055f}, {-11.865f, -1.055f}, {-12.393f, -3.164f},
+    {-12.920f, 3.164f}, {-13.447f, 1.055f}, {-13.975f, -1.055f}, {-14.502f, -3.164f},
+    {-15.029f, 3.164f}, {-15.557f, 1.055f}, {-16.084f, -1.055f}, {-16.611f, -3.164f},
+};
+
+template <int32_t N>
+static FLidarBeamTable MakeBeamTable(const FLidarBeamAngles (&Beams)[N]) {
+    return {Beams, N};
+}
+
+FLidarBeamTable FLidarBeamTables::VelodyneHDL32E() { return MakeBeamTable(VelodyneHDL32ETable); }
+FLidarBeamTable FLidarBeamTables::VelodyneVLP16() { return MakeBeamTable(VelodyneVLP16Table); }
+FLidarBeamTable FLidarBeamTables::OusterOS1_64() { return MakeBeamTable(OusterOS1_64Table); }
+
+FLidarScanPattern::FLidarScanPattern(const FLidarBeamTable &Table)
+    : Beams(Table.Beams, Table.Beams + Table.Num) {
+    BuildDirections();
+}
+
+FLidarScanPattern::FLidarScanPattern(int32_t NumBeams, float InMinElevation,
+                                     float InMaxElevation) {
+    // ASSUMPTION: The beams are evenly spaced in elevation.
+    // The difference in elevation between adjacent lidar beams
+    const float BeamSpacing = (InMaxElevation - InMinElevation) / std::max(NumBeams - 1, 1);
+    for (int32_t i = 0; i < NumBeams; i++) {
+        // The max elevation beam is set directly so that max elevation is as precise
+        // as possible, without rounding errors
+        const float BeamElevation = (i == NumBeams - 1) ? InMaxElevation
+                                                        : InMinElevation + BeamSpacing * i;
+        Beams.push_back({BeamElevation, 0.f});
+    }
+    BuildDirections();
+}
+
+// Unit vectors in the sensor head's frame at zero azimuth.
+// Positive elevation pitches the beam up, and the azimuth offset yaws it about the head,
+// the same as FRotator(Elevation, AzimuthOffset, 0).Vector().
+void FLidarScanPattern::BuildDirections() {
+    Directions.clear();
+    Directions.reserve(Beams.size());
+    for (const FLidarBeamAngles &Beam : Beams) {
+        const float Pitch = Beam.Elevation * LidarDegreesToRadians;
+        const float Yaw = Beam.AzimuthOffset * LidarDegreesToRadians;
+        Directions.emplace_back(std::cos(Pitch) * std::cos(Yaw), std::cos(Pitch) * std::sin(Yaw),
+                                std::sin(Pitch));
+    }
+
+    MinElevation = Beams.empty() ? 0.f : Beams[0].Elevation;
+    MaxElevation = MinElevation;
+    for (const FLidarBeamAngles &Beam : Beams) {
+        MinElevation = std::min(MinElevation, Beam.Elevation);
+        MaxElevation = std::max(MaxElevation, Beam.Elevation);
+    }
+}
@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarSensorModel.h"
+#include <algorithm>
+
+// The most beams in a column that are given random numbers on the stack.
+// Longer columns are processed in chunks of this size.
+static constexpr int32_t MaxChunkBeams = 128;
+
+FLidarSensorModel::FLidarSensorModel(const FLidarSensorModelSettings &InSettings)
+    : Settings(InSettings), NoiseRng(InSettings.NoiseSeed, InSettings.SensorId) {}
+
+void FLidarSensorModel::StoreReturn(FLidarPointCloud &Cloud, int32_t PointIndex,
+                                    const FLidarVector3 &BeamStart,
+                                    const FLidarVector3 &ImpactPoint,
+                                    const FLidarVector3 &ImpactNormal, float Distance) const {
+    // The cosine of the angle of incidence is kept for the noise and intensity models
+    const FLidarVector3 BeamUnitVector = (ImpactPoint - BeamStart).GetSafeNormal();
+    Cloud.SetPosition(PointIndex, ImpactPoint);
+    Cloud.Range[PointIndex] = Distance;
+    Cloud.CosIncidence[PointIndex] = FLidarVector3::Dot(-BeamUnitVector, ImpactNormal);
+    Cloud.Intensity[PointIndex] = 0.f;
+    Cloud.Flags[PointIndex] = FLidarPointCloud::PointReturned;
+}
+
+void FLidarSensorModel::StoreMiss(FLidarPointCloud &Cloud, int32_t PointIndex,
+                                  const FLidarVector3 &TraceEnd) const {
+    Cloud.SetPosition(PointIndex, TraceEnd);
+    Cloud.Range[PointIndex] = Settings.LidarRange;
+    Cloud.CosIncidence[PointIndex] = 0.f;
+    Cloud.Intensity[PointIndex] = 0.f;
+    Cloud.Flags[PointIndex] = 0;
+}
+
+int32_t FLidarSensorModel::ApplyDropout(FLidarPointCloud &Cloud, int32_t FirstPoint,
+                                        int32_t NumPoints, uint32_t Revolution,
+                                        uint32_t Column) const {
+    int32_t NumReturns = 0;
+    float Uniforms[MaxChunkBeams];
+    for (int32_t ChunkStart = 0; ChunkStart < NumPoints; ChunkStart += MaxChunkBeams) {
+        const int32_t ChunkBeams = std::min(NumPoints - ChunkStart, MaxChunkBeams);
+        // Draws for beams ChunkStart onwards, which start on a group boundary of four beams
+        NoiseRng.FillUniform(FLidarNoiseRng::EStream::Dropout, Revolution, Column, Uniforms,
+                             ChunkStart, ChunkBeams);
+        for (int32_t i = 0; i < ChunkBeams; i++) {
+            const int32_t PointIndex = FirstPoint + ChunkStart + i;
+            if (!Cloud.HasReturn(PointIndex)) continue;
+
+            // If the hit does not return due to this probability, its point becomes a miss
+            if (Settings.FalloffStdDev > 0.f &&
+                Uniforms[i] < GetNoReturnProbability(Cloud.Range[PointIndex])) {
+                Cloud.Flags[PointIndex] &= ~FLidarPointCloud::PointReturned;
+            } else {
+                NumReturns++;
+            }
+        }
+    }
+    return NumReturns;
+}
+
+void FLidarSensorModel::ApplyRangeNoise(FLidarPointCloud &Cloud, int32_t FirstPoint,
+                                        int32_t NumPoints, const FLidarVector3 &BeamStart,
+                                        uint32_t Revolution, uint32_t Column) const {
+    float StandardNormals[MaxChunkBeams];
+    for (int32_t ChunkStart = 0; ChunkStart < NumPoints; ChunkStart += MaxChunkBeams) {
+        const int32_t ChunkBeams = std::min(NumPoints - ChunkStart, MaxChunkBeams);
+        NoiseRng.FillGaussian(FLidarNoiseRng::EStream::RangeNoise, Revolution, Column,
+                              StandardNormals, ChunkStart, ChunkBeams);
+        for (int32_t i = 0; i < ChunkBeams; i++) {
+            const int32_t PointIndex = FirstPoint + ChunkStart + i;
+            if (!Cloud.HasReturn(PointIndex)) continue;
+
+            // Determine the random amount by which to change the range of the hit,
+            // and add a vector of this length to the hit's position, parallel to the beam
+            const FLidarVector3 LidarPoint = Cloud.GetPosition(PointIndex);
+            const FLidarVector3 BeamUnitVector = (LidarPoint - BeamStart).GetSafeNormal();
+            const float RangeNoiseScalar =
+                    StandardNormals[i] * GetRangeNoiseStdDev(Cloud.CosIncidence[PointIndex]);
+            Cloud.SetPosition(PointIndex, LidarPoint + BeamUnitVector * RangeNoiseScalar);
+            Cloud.Range[PointIndex] += RangeNoiseScalar;
+        }
+    }
+}
+
+void FLidarSensorModel::ApplyIntensity(FLidarPointCloud &Cloud, int32_t FirstPoint,
+                                       int32_t NumPoints) const {
+    for (int32_t PointIndex = FirstPoint; PointIndex < FirstPoint + NumPoints; PointIndex++) {
+        if (!Cloud.HasReturn(PointIndex)) continue;
+        Cloud.Intensity[PointIndex] = GetIntensity(Cloud.Intensity[PointIndex],
+                                                   std::max(0.f, Cloud.CosIncidence[PointIndex]));
+    }
+}
+
+void FLidarSensorModel::TransformToOutputFrame(FLidarPointCloud &Cloud, int32_t FirstPoint,
+                                               int32_t NumPoints,
+                                               const FLidarRigidTransform &Sensor,
+                                               bool bLocalCoordinates) {
+    for (int32_t PointIndex = FirstPoint; PointIndex < FirstPoint + NumPoints; PointIndex++) {
+        if (!Cloud.HasReturn(PointIndex)) {
+            Cloud.SetPosition(PointIndex, FLidarVector3());
+        } else if (bLocalCoordinates) {
+            Cloud.SetPosition(PointIndex,
+                              Sensor.InverseTransformPosition(Cloud.GetPosition(PointIndex)));
+        }
+    }
+}
+
+void FLidarSensorModel::GetReturnStrengths(const FLidarBeamSurface* Surfaces,
+                                           int32_t NumSurfaces, const FLidarVector3 &BeamStart,
+                                           float* OutStrengths) const {
+    float Energy = 1.f;
+    for (int32_t i = 0; i < NumSurfaces; i++) {
+        const FLidarBeamSurface &Surface = Surfaces[i];
+        const FLidarVector3 BeamUnitVector = (Surface.ImpactPoint - BeamStart).GetSafeNormal();
+        const float CosIncidence = FLidarVector3::Dot(-BeamUnitVector, Surface.ImpactNormal);
+        OutStrengths[i] = GetIntensity(
+                Energy * (1.f - Surface.Transmittance) * Surface.Reflectivity,
+                std::max(0.f, CosIncidence));
+        Energy *= Surface.Transmittance;
+    }
+}
+
+// Use a gaussian function centered at the max distance
+float FLidarSensorModel::GetNoReturnProbability(float Range) const {
+    if (Settings.FalloffStdDev <= 0.f) return 0.f;
+    const float Falloff = (Range - Settings.LidarRange) / Settings.FalloffStdDev;
+    return Settings.MaxRangeNoReturnProbability * std::exp(-0.5f * Falloff * Falloff);
+}
+
+// ASSUMPTION: the range noise is greatest when the angle of incidence is closest
+// to parallel with the surface.
+// This function should be adjusted to match real data, but it has a standard deviation
+// based on the range accuracy from the spec sheet which is minimized when the beam is
+// perpendicular to the surface and maximized as the beam approaches parallel to the surface.
+float FLidarSensorModel::GetRangeNoiseStdDev(float CosIncidence) const {
+    return Settings.RangeAccuracy * (1.f - CosIncidence);
+}
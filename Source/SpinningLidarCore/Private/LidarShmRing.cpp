@@ -0,0 +1,301 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarShmRing.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32) && defined(PLATFORM_WINDOWS)
+// In the engine build, windows.h has to come through the engine's wrapper
+#include "Windows/WindowsHWrapper.h"
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// The ring header, each slot header and each array start on their own cache line
+constexpr size_t Alignment = 64;
+constexpr size_t RingHeaderBytes = Alignment;
+constexpr size_t SlotHeaderBytes = Alignment;
+static_assert(sizeof(FLidarShmRingHeader) <= RingHeaderBytes, "Ring header too large");
+static_assert(sizeof(FLidarShmSlotHeader) <= SlotHeaderBytes, "Slot header too large");
+
+// A copied revolution is given up on after this many torn reads in a row
+constexpr int32_t MaxReadAttempts = 16;
+
+size_t Align(size_t Bytes) {
+    return (Bytes + Alignment - 1) & ~(Alignment - 1);
+}
+
+#if !defined(_WIN32)
+// POSIX shared-memory names start with a single slash
+std::string GetPosixName(const char* Name) {
+    return Name[0] == '/' ? std::string(Name) : std::string("/") + Name;
+}
+#endif
+
+}  // namespace
+
+FLidarShmSlotLayout FLidarShmSlotLayout::Make(uint32_t SlotCapacity) {
+    FLidarShmSlotLayout Layout;
+    size_t Offset = SlotHeaderBytes;
+    auto Place = [&Offset, SlotCapacity](size_t &OutOffset, size_t ElementSize) {
+        OutOffset = Offset;
+        Offset += Align(SlotCapacity * ElementSize);
+    };
+    Place(Layout.X, sizeof(float));
+    Place(Layout.Y, sizeof(float));
+    Place(Layout.Z, sizeof(float));
+    Place(Layout.Range, sizeof(float));
+    Place(Layout.Intensity, sizeof(float));
+    Place(Layout.Time, sizeof(double));
+    Place(Layout.Beam, sizeof(uint16_t));
+    Place(Layout.Column, sizeof(uint16_t));
+    Place(Layout.Flags, sizeof(uint8_t));
+    Layout.Stride = Offset;
+    return Layout;
+}
+
+FLidarSharedMemory::~FLidarSharedMemory() {
+    Close();
+}
+
+bool FLidarSharedMemory::Create(const char* Name, size_t InSize) {
+    Close();
+#if defined(_WIN32)
+    Mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                 (DWORD)((uint64_t)InSize >> 32), (DWORD)InSize, Name);
+    if (!Mapping) return false;
+    Data = (uint8_t*)MapViewOfFile(Mapping, FILE_MAP_WRITE, 0, 0, InSize);
+    if (!Data) {
+        CloseHandle(Mapping);
+        Mapping = nullptr;
+        return false;
+    }
+#else
+    // Replace a segment left behind by a sensor that didn't shut down cleanly
+    const std::string PosixName = GetPosixName(Name);
+    shm_unlink(PosixName.c_str());
+    const int File = shm_open(PosixName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (File < 0) return false;
+    if (ftruncate(File, (off_t)InSize) != 0) {
+        close(File);
+        shm_unlink(PosixName.c_str());
+        return false;
+    }
+    void* Mapped = mmap(nullptr, InSize, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+    close(File);
+    if (Mapped == MAP_FAILED) {
+        shm_unlink(PosixName.c_str());
+        return false;
+    }
+    Data = (uint8_t*)Mapped;
+    SegmentName = PosixName;
+#endif
+    Size = InSize;
+    bOwner = true;
+    return true;
+}
+
+bool FLidarSharedMemory::Open(const char* Name) {
+    Close();
+#if defined(_WIN32)
+    Mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, Name);
+    if (!Mapping) return false;
+    Data = (uint8_t*)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!Data) {
+        CloseHandle(Mapping);
+        Mapping = nullptr;
+        return false;
+    }
+    MEMORY_BASIC_INFORMATION Info;
+    Size = VirtualQuery(Data, &Info, sizeof(Info)) ? Info.RegionSize : 0;
+#else
+    const int File = shm_open(GetPosixName(Name).c_str(), O_RDONLY, 0);
+    if (File < 0) return false;
+    struct stat Status;
+    if (fstat(File, &Status) != 0 || Status.st_size <= 0) {
+        close(File);
+        return false;
+    }
+    void* Mapped = mmap(nullptr, (size_t)Status.st_size, PROT_READ, MAP_SHARED, File, 0);
+    close(File);
+    if (Mapped == MAP_FAILED) return false;
+    Data = (uint8_t*)Mapped;
+    Size = (size_t)Status.st_size;
+#endif
+    bOwner = false;
+    return true;
+}
+
+void FLidarSharedMemory::Close() {
+    if (!Data) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(Data);
+    CloseHandle(Mapping);
+    Mapping = nullptr;
+#else
+    munmap(Data, Size);
+    if (bOwner) shm_unlink(SegmentName.c_str());
+#endif
+    Data = nullptr;
+    Size = 0;
+    bOwner = false;
+    SegmentName.clear();
+}
+
+bool FLidarShmRingWriter::Create(const char* Name, uint32_t NumSlots, uint32_t SlotCapacity) {
+    Close();
+    if (NumSlots == 0) return false;
+
+    Layout = FLidarShmSlotLayout::Make(SlotCapacity);
+    if (!Memory.Create(Name, RingHeaderBytes + NumSlots * Layout.Stride)) return false;
+
+    // A fresh segment is zero filled, so every slot starts out empty with an even Lock
+    Header = new (Memory.GetData()) FLidarShmRingHeader();
+    Header->NumSlots = NumSlots;
+    Header->SlotCapacity = SlotCapacity;
+    Header->SlotStride = Layout.Stride;
+    Header->LatestSequence.store(0, std::memory_order_relaxed);
+    Header->Version = FLidarShmRingHeader::CurrentVersion;
+    // Readers check the magic number last of all
+    std::atomic_thread_fence(std::memory_order_release);
+    Header->Magic = FLidarShmRingHeader::ExpectedMagic;
+    return true;
+}
+
+void FLidarShmRingWriter::Close() {
+    Memory.Close();
+    Header = nullptr;
+}
+
+void FLidarShmRingWriter::Publish(const FLidarPointCloud &Cloud) {
+    if (!Header) return;
+
+    const uint64_t Sequence = Header->LatestSequence.load(std::memory_order_relaxed) + 1;
+    uint8_t* SlotData = Memory.GetData() + RingHeaderBytes +
+            ((Sequence - 1) % Header->NumSlots) * Layout.Stride;
+    FLidarShmSlotHeader* Slot = (FLidarShmSlotHeader*)SlotData;
+
+    // Mark the slot as being written before touching any of it
+    Slot->Lock.store(2 * Sequence - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const int32_t NumPoints = std::min(Cloud.Num(), (int32_t)Header->SlotCapacity);
+    Slot->Sequence = Sequence;
+    Slot->Revolution = Cloud.Revolution;
+    Slot->NumPoints = NumPoints;
+    std::memcpy(SlotData + Layout.X, Cloud.X.data(), NumPoints * sizeof(float));
+    std::memcpy(SlotData + Layout.Y, Cloud.Y.data(), NumPoints * sizeof(float));
+    std::memcpy(SlotData + Layout.Z, Cloud.Z.data(), NumPoints * sizeof(float));
+    std::memcpy(SlotData + Layout.Range, Cloud.Range.data(), NumPoints * sizeof(float));
+    std::memcpy(SlotData + Layout.Intensity, Cloud.Intensity.data(), NumPoints * sizeof(float));
+    std::memcpy(SlotData + Layout.Time, Cloud.Time.data(), NumPoints * sizeof(double));
+    std::memcpy(SlotData + Layout.Beam, Cloud.Beam.data(), NumPoints * sizeof(uint16_t));
+    std::memcpy(SlotData + Layout.Column, Cloud.Column.data(), NumPoints * sizeof(uint16_t));
+    std::memcpy(SlotData + Layout.Flags, Cloud.Flags.data(), NumPoints * sizeof(uint8_t));
+
+    Slot->Lock.store(2 * Sequence, std::memory_order_release);
+    Header->LatestSequence.store(Sequence, std::memory_order_release);
+}
+
+bool FLidarShmRingReader::Open(const char* Name) {
+    Close();
+    if (!Memory.Open(Name) || Memory.GetSize() < RingHeaderBytes) return false;
+
+    const FLidarShmRingHeader* Candidate = (const FLidarShmRingHeader*)Memory.GetData();
+    const bool bIsRing = Candidate->Magic == FLidarShmRingHeader::ExpectedMagic &&
+            Candidate->Version == FLidarShmRingHeader::CurrentVersion;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (bIsRing) Layout = FLidarShmSlotLayout::Make(Candidate->SlotCapacity);
+    if (!bIsRing || Candidate->NumSlots == 0 || Layout.Stride != Candidate->SlotStride ||
+        Memory.GetSize() < RingHeaderBytes + Candidate->NumSlots * Layout.Stride) {
+        Memory.Close();
+        return false;
+    }
+    Header = Candidate;
+    return true;
+}
+
+void FLidarShmRingReader::Close() {
+    Memory.Close();
+    Header = nullptr;
+}
+
+uint64_t FLidarShmRingReader::GetLatestSequence() const {
+    return Header ? Header->LatestSequence.load(std::memory_order_acquire) : 0;
+}
+
+bool FLidarShmRingReader::AcquireLatest(FLidarShmRevolutionView &OutView) const {
+    const uint64_t Sequence = GetLatestSequence();
+    if (Sequence == 0) return false;
+
+    const uint8_t* SlotData = Memory.GetData() + RingHeaderBytes +
+            ((Sequence - 1) % Header->NumSlots) * Layout.Stride;
+    const FLidarShmSlotHeader* Slot = (const FLidarShmSlotHeader*)SlotData;
+
+    // The writer may already have lapped the ring and be rewriting this slot
+    const uint64_t Lock = Slot->Lock.load(std::memory_order_acquire);
+    if (Lock != 2 * Sequence) return false;
+
+    OutView.Slot = Slot;
+    OutView.Lock = Lock;
+    OutView.Sequence = Sequence;
+    OutView.Revolution = Slot->Revolution;
+    OutView.NumPoints = std::min(std::max(Slot->NumPoints, 0), (int32_t)Header->SlotCapacity);
+    OutView.X = (const float*)(SlotData + Layout.X);
+    OutView.Y = (const float*)(SlotData + Layout.Y);
+    OutView.Z = (const float*)(SlotData + Layout.Z);
+    OutView.Range = (const float*)(SlotData + Layout.Range);
+    OutView.Intensity = (const float*)(SlotData + Layout.Intensity);
+    OutView.Time = (const double*)(SlotData + Layout.Time);
+    OutView.Beam = (const uint16_t*)(SlotData + Layout.Beam);
+    OutView.Column = (const uint16_t*)(SlotData + Layout.Column);
+    OutView.Flags = SlotData + Layout.Flags;
+    return true;
+}
+
+bool FLidarShmRingReader::IsValid(const FLidarShmRevolutionView &View) const {
+    if (!View.Slot) return false;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return View.Slot->Lock.load(std::memory_order_relaxed) == View.Lock;
+}
+
+bool FLidarShmRingReader::ReadLatest(FLidarPointCloud &OutCloud, uint64_t &OutSequence) const {
+    for (int32_t Attempt = 0; Attempt < MaxReadAttempts; Attempt++) {
+        FLidarShmRevolutionView View;
+        if (!AcquireLatest(View)) {
+            if (GetLatestSequence() == 0) return false;
+            continue;
+        }
+
+        // The incidence angles aren't shared, and are left at 0
+        const int32_t NumPoints = View.NumPoints;
+        OutCloud.Reset(NumPoints);
+        OutCloud.AddUninitialized(NumPoints);
+        OutCloud.Revolution = View.Revolution;
+        std::memcpy(OutCloud.X.data(), View.X, NumPoints * sizeof(float));
+        std::memcpy(OutCloud.Y.data(), View.Y, NumPoints * sizeof(float));
+        std::memcpy(OutCloud.Z.data(), View.Z, NumPoints * sizeof(float));
+        std::memcpy(OutCloud.Range.data(), View.Range, NumPoints * sizeof(float));
+        std::memcpy(OutCloud.Intensity.data(), View.Intensity, NumPoints * sizeof(float));
+        std::memcpy(OutCloud.Time.data(), View.Time, NumPoints * sizeof(double));
+        std::memcpy(OutCloud.Beam.data(), View.Beam, NumPoints * sizeof(uint16_t));
+        std::memcpy(OutCloud.Column.data(), View.Column, NumPoints * sizeof(uint16_t));
+        std::memcpy(OutCloud.Flags.data(), View.Flags, NumPoints * sizeof(uint8_t));
+
+        if (IsValid(View)) {
+            OutSequence = View.Sequence;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,475 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarTriangleBvh.h"
+#include <algorithm>
+#include <cfloat>
+
+// Every x86-64 compiler targets SSE2, which is all the packet traversal needs
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIDAR_BVH_SSE 1
+#include <emmintrin.h>
+#else
+#define LIDAR_BVH_SSE 0
+#endif
+
+namespace {
+
+constexpr int32_t NumBins = 16;
+// Nodes with this many triangles or fewer are not split any further
+constexpr int32_t MaxLeafTriangles = 4;
+// Deep enough for any tree worth building; nodes below it become leaves regardless of size
+constexpr int32_t MaxDepth = 60;
+constexpr int32_t MaxStackDepth = MaxDepth + 4;
+
+FLidarVector3 Cross(const FLidarVector3 &A, const FLidarVector3 &B) {
+    return FLidarVector3(A.Y * B.Z - A.Z * B.Y, A.Z * B.X - A.X * B.Z, A.X * B.Y - A.Y * B.X);
+}
+
+float Component(const FLidarVector3 &Vector, int32_t Axis) {
+    return Axis == 0 ? Vector.X : (Axis == 1 ? Vector.Y : Vector.Z);
+}
+
+struct FBounds {
+    FLidarVector3 Min = FLidarVector3(FLT_MAX, FLT_MAX, FLT_MAX);
+    FLidarVector3 Max = FLidarVector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    void Add(const FLidarVector3 &Point) {
+        Min = FLidarVector3(std::min(Min.X, Point.X), std::min(Min.Y, Point.Y),
+                            std::min(Min.Z, Point.Z));
+        Max = FLidarVector3(std::max(Max.X, Point.X), std::max(Max.Y, Point.Y),
+                            std::max(Max.Z, Point.Z));
+    }
+
+    void Add(const FBounds &Other) {
+        if (Other.IsEmpty()) return;
+        Add(Other.Min);
+        Add(Other.Max);
+    }
+
+    bool IsEmpty() const { return Max.X < Min.X; }
+
+    // Half the surface area, which is all the surface area heuristic needs
+    float HalfArea() const {
+        if (IsEmpty()) return 0.f;
+        const FLidarVector3 Size = Max - Min;
+        return Size.X * Size.Y + Size.Y * Size.Z + Size.Z * Size.X;
+    }
+};
+
+// The reciprocal of a direction, with huge finite values for axes the beam is parallel to
+// so that the slab test never multiplies zero by infinity
+FLidarVector3 SafeInverse(const FLidarVector3 &Direction) {
+    auto Inverse = [](float Value) {
+        return std::abs(Value) > 1.e-12f ? 1.f / Value : std::copysign(1.e30f, Value);
+    };
+    return FLidarVector3(Inverse(Direction.X), Inverse(Direction.Y), Inverse(Direction.Z));
+}
+
+// Where the beam enters the box, if it does before Closest
+bool IntersectBox(const float* Min, const float* Max, const FLidarVector3 &Start,
+                  const FLidarVector3 &InverseDirection, float Closest, float &OutEntry) {
+    float Near = 0.f;
+    float Far = Closest;
+    const float Origin[3] = {Start.X, Start.Y, Start.Z};
+    const float Inverse[3] = {InverseDirection.X, InverseDirection.Y, InverseDirection.Z};
+    for (int32_t Axis = 0; Axis < 3; Axis++) {
+        const float T1 = (Min[Axis] - Origin[Axis]) * Inverse[Axis];
+        const float T2 = (Max[Axis] - Origin[Axis]) * Inverse[Axis];
+        Near = std::max(Near, std::min(T1, T2));
+        Far = std::min(Far, std::max(T1, T2));
+    }
+    OutEntry = Near;
+    return Near <= Far;
+}
+
+#if LIDAR_BVH_SSE
+__m128 Select(__m128 Mask, __m128 IfSet, __m128 IfClear) {
+    return _mm_or_ps(_mm_and_ps(Mask, IfSet), _mm_andnot_ps(Mask, IfClear));
+}
+
+// Where the first of the beams of a packet that hit the box enters it, if any do
+bool IntersectBox4(const float* Min, const float* Max, const __m128 Origin[3],
+                   const __m128 InverseDirection[3], __m128 Closest, float &OutEntry) {
+    __m128 Near = _mm_setzero_ps();
+    __m128 Far = Closest;
+    for (int32_t Axis = 0; Axis < 3; Axis++) {
+        const __m128 T1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(Min[Axis]), Origin[Axis]),
+                                     InverseDirection[Axis]);
+        const __m128 T2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(Max[Axis]), Origin[Axis]),
+                                     InverseDirection[Axis]);
+        Near = _mm_max_ps(Near, _mm_min_ps(T1, T2));
+        Far = _mm_min_ps(Far, _mm_max_ps(T1, T2));
+    }
+    const __m128 Hit = _mm_cmple_ps(Near, Far);
+    if (_mm_movemask_ps(Hit) == 0) return false;
+
+    __m128 Entry = Select(Hit, Near, _mm_set1_ps(FLT_MAX));
+    Entry = _mm_min_ps(Entry, _mm_shuffle_ps(Entry, Entry, _MM_SHUFFLE(2, 3, 0, 1)));
+    Entry = _mm_min_ps(Entry, _mm_shuffle_ps(Entry, Entry, _MM_SHUFFLE(1, 0, 3, 2)));
+    OutEntry = _mm_cvtss_f32(Entry);
+    return true;
+}
+#endif
+
+struct FStackEntry {
+    uint32_t Node;
+    // Where the nearest beam enters the node, so it can be skipped once every beam has hit
+    // something closer
+    float Entry;
+};
+
+}  // namespace
+
+void FLidarTriangleBvh::AddMesh(const FLidarVector3* Vertices, const uint32_t* Indices,
+                                int32_t NumTriangles, int32_t ObjectIndex) {
+    Nodes.clear();
+    Triangles.reserve(Triangles.size() + NumTriangles);
+    for (int32_t i = 0; i < NumTriangles; i++) {
+        FTriangle Triangle;
+        Triangle.Vertex = Vertices[Indices[3 * i]];
+        Triangle.Edge1 = Vertices[Indices[3 * i + 1]] - Triangle.Vertex;
+        Triangle.Edge2 = Vertices[Indices[3 * i + 2]] - Triangle.Vertex;
+        // Degenerate triangles can't be hit, so they aren't worth a place in the tree
+        const FLidarVector3 Normal = Cross(Triangle.Edge1, Triangle.Edge2).GetSafeNormal();
+        if (FLidarVector3::Dot(Normal, Normal) == 0.f) continue;
+        Triangles.push_back(Triangle);
+        Normals.push_back(Normal);
+        ObjectIndices.push_back(ObjectIndex);
+    }
+}
+
+void FLidarTriangleBvh::Reset() {
+    Nodes.clear();
+    Triangles.clear();
+    Normals.clear();
+    ObjectIndices.clear();
+}
+
+void FLidarTriangleBvh::Build() {
+    Nodes.clear();
+    const int32_t NumTriangles = (int32_t)Triangles.size();
+    if (NumTriangles == 0) return;
+
+    std::vector<FBounds> TriangleBounds(NumTriangles);
+    std::vector<FLidarVector3> Centroids(NumTriangles);
+    std::vector<int32_t> Order(NumTriangles);
+    for (int32_t i = 0; i < NumTriangles; i++) {
+        const FTriangle &Triangle = Triangles[i];
+        TriangleBounds[i].Add(Triangle.Vertex);
+        TriangleBounds[i].Add(Triangle.Vertex + Triangle.Edge1);
+        TriangleBounds[i].Add(Triangle.Vertex + Triangle.Edge2);
+        Centroids[i] = (TriangleBounds[i].Min + TriangleBounds[i].Max) * 0.5f;
+        Order[i] = i;
+    }
+
+    struct FPending {
+        uint32_t Node;
+        int32_t First;
+        int32_t Count;
+        int32_t Depth;
+    };
+    std::vector<FPending> Pending;
+    Pending.push_back({0, 0, NumTriangles, 0});
+    Nodes.reserve(2 * (size_t)NumTriangles);
+    Nodes.push_back(FNode());
+
+    while (!Pending.empty()) {
+        const FPending Item = Pending.back();
+        Pending.pop_back();
+
+        FBounds Bounds;
+        FBounds CentroidBounds;
+        for (int32_t k = Item.First; k < Item.First + Item.Count; k++) {
+            Bounds.Add(TriangleBounds[Order[k]]);
+            CentroidBounds.Add(Centroids[Order[k]]);
+        }
+        FNode &Node = Nodes[Item.Node];
+        Node.Min[0] = Bounds.Min.X;
+        Node.Min[1] = Bounds.Min.Y;
+        Node.Min[2] = Bounds.Min.Z;
+        Node.Max[0] = Bounds.Max.X;
+        Node.Max[1] = Bounds.Max.Y;
+        Node.Max[2] = Bounds.Max.Z;
+        Node.FirstIndex = (uint32_t)Item.First;
+        Node.NumTriangles = (uint32_t)Item.Count;
+        if (Item.Count <= MaxLeafTriangles || Item.Depth >= MaxDepth) continue;
+
+        // Bin the centroids along each axis and take the split with the least surface area
+        // weighted by triangle count
+        int32_t BestAxis = -1;
+        int32_t BestBin = 0;
+        float BestCost = FLT_MAX;
+        for (int32_t Axis = 0; Axis < 3; Axis++) {
+            const float Low = Component(CentroidBounds.Min, Axis);
+            const float Extent = Component(CentroidBounds.Max, Axis) - Low;
+            if (Extent <= 0.f) continue;
+            const float Scale = NumBins / Extent;
+
+            FBounds BinBounds[NumBins];
+            int32_t BinCounts[NumBins] = {};
+            for (int32_t k = Item.First; k < Item.First + Item.Count; k++) {
+                const float Offset = Component(Centroids[Order[k]], Axis) - Low;
+                const int32_t Bin = std::min(NumBins - 1, (int32_t)(Offset * Scale));
+                BinBounds[Bin].Add(TriangleBounds[Order[k]]);
+                BinCounts[Bin]++;
+            }
+
+            float RightCost[NumBins] = {};
+            FBounds Right;
+            int32_t RightCount = 0;
+            for (int32_t Bin = NumBins - 1; Bin > 0; Bin--) {
+                Right.Add(BinBounds[Bin]);
+                RightCount += BinCounts[Bin];
+                RightCost[Bin] = RightCount > 0 ? RightCount * Right.HalfArea() : -1.f;
+            }
+            FBounds Left;
+            int32_t LeftCount = 0;
+            for (int32_t Bin = 1; Bin < NumBins; Bin++) {
+                Left.Add(BinBounds[Bin - 1]);
+                LeftCount += BinCounts[Bin - 1];
+                if (LeftCount == 0 || RightCost[Bin] < 0.f) continue;
+                const float Cost = LeftCount * Left.HalfArea() + RightCost[Bin];
+                if (Cost < BestCost) {
+                    BestCost = Cost;
+                    BestAxis = Axis;
+                    BestBin = Bin;
+                }
+            }
+        }
+        // Every centroid is in the same place, so there is nothing to split
+        if (BestAxis < 0) continue;
+
+        const float Low = Component(CentroidBounds.Min, BestAxis);
+        const float Scale = NumBins / (Component(CentroidBounds.Max, BestAxis) - Low);
+        const auto Middle = std::partition(
+                Order.begin() + Item.First, Order.begin() + Item.First + Item.Count,
+                [&](int32_t Triangle) {
+                    const float Offset = Component(Centroids[Triangle], BestAxis) - Low;
+                    return std::min(NumBins - 1, (int32_t)(Offset * Scale)) < BestBin;
+                });
+        const int32_t LeftCount = (int32_t)(Middle - Order.begin()) - Item.First;
+
+        const uint32_t FirstChild = (uint32_t)Nodes.size();
+        Node.FirstIndex = FirstChild;
+        Node.NumTriangles = 0;
+        Nodes.push_back(FNode());
+        Nodes.push_back(FNode());
+        Pending.push_back({FirstChild, Item.First, LeftCount, Item.Depth + 1});
+        Pending.push_back({FirstChild + 1, Item.First + LeftCount, Item.Count - LeftCount,
+                           Item.Depth + 1});
+    }
+
+    // Store the triangles in leaf order
+    std::vector<FTriangle> SortedTriangles(NumTriangles);
+    std::vector<FLidarVector3> SortedNormals(NumTriangles);
+    std::vector<int32_t> SortedObjectIndices(NumTriangles);
+    for (int32_t i = 0; i < NumTriangles; i++) {
+        SortedTriangles[i] = Triangles[Order[i]];
+        SortedNormals[i] = Normals[Order[i]];
+        SortedObjectIndices[i] = ObjectIndices[Order[i]];
+    }
+    Triangles.swap(SortedTriangles);
+    Normals.swap(SortedNormals);
+    ObjectIndices.swap(SortedObjectIndices);
+}
+
+FLidarBvhHit FLidarTriangleBvh::Trace(const FLidarVector3 &Start,
+                                      const FLidarVector3 &End) const {
+    FLidarBvhHit Hit;
+    const FLidarVector3 Delta = End - Start;
+    const float Length = Delta.Size();
+    if (Nodes.empty() || Length <= 0.f) return Hit;
+    const FLidarVector3 Direction = Delta * (1.f / Length);
+    const FLidarVector3 InverseDirection = SafeInverse(Direction);
+
+    float Closest = Length;
+    int32_t HitTriangle = -1;
+    FStackEntry Stack[MaxStackDepth];
+    int32_t StackSize = 0;
+    float RootEntry;
+    if (IntersectBox(Nodes[0].Min, Nodes[0].Max, Start, InverseDirection, Closest, RootEntry)) {
+        Stack[StackSize++] = {0, RootEntry};
+    }
+
+    while (StackSize > 0) {
+        const FStackEntry Entry = Stack[--StackSize];
+        if (Entry.Entry > Closest) continue;
+        const FNode &Node = Nodes[Entry.Node];
+
+        if (Node.NumTriangles > 0) {
+            for (uint32_t i = Node.FirstIndex; i < Node.FirstIndex + Node.NumTriangles; i++) {
+                const FTriangle &Triangle = Triangles[i];
+                const FLidarVector3 P = Cross(Direction, Triangle.Edge2);
+                const float Determinant = FLidarVector3::Dot(Triangle.Edge1, P);
+                if (std::abs(Determinant) < 1.e-12f) continue;
+                const float InverseDeterminant = 1.f / Determinant;
+                const FLidarVector3 T = Start - Triangle.Vertex;
+                const float U = FLidarVector3::Dot(T, P) * InverseDeterminant;
+                if (U < 0.f || U > 1.f) continue;
+                const FLidarVector3 Q = Cross(T, Triangle.Edge1);
+                const float V = FLidarVector3::Dot(Direction, Q) * InverseDeterminant;
+                if (V < 0.f || U + V > 1.f) continue;
+                const float Distance = FLidarVector3::Dot(Triangle.Edge2, Q) * InverseDeterminant;
+                if (Distance > 0.f && Distance < Closest) {
+                    Closest = Distance;
+                    HitTriangle = (int32_t)i;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first, so the farther one can often be skipped
+        float Entries[2] = {FLT_MAX, FLT_MAX};
+        bool bHits[2];
+        for (int32_t Child = 0; Child < 2; Child++) {
+            const FNode &ChildNode = Nodes[Node.FirstIndex + Child];
+            bHits[Child] = IntersectBox(ChildNode.Min, ChildNode.Max, Start, InverseDirection,
+                                        Closest, Entries[Child]);
+        }
+        const int32_t Near = Entries[1] < Entries[0] ? 1 : 0;
+        if (bHits[1 - Near]) Stack[StackSize++] = {Node.FirstIndex + 1 - Near, Entries[1 - Near]};
+        if (bHits[Near]) Stack[StackSize++] = {Node.FirstIndex + Near, Entries[Near]};
+    }
+
+    if (HitTriangle >= 0) MakeHit(Start, Direction, Closest, HitTriangle, Hit);
+    return Hit;
+}
+
+void FLidarTriangleBvh::TraceFan(const FLidarVector3 &Start, const FLidarVector3* Ends,
+                                 int32_t NumRays, FLidarBvhHit* OutHits) const {
+    for (int32_t First = 0; First < NumRays; First += 4) {
+        TracePacket(Start, Ends + First, std::min(NumRays - First, 4), OutHits + First);
+    }
+}
+
+#if LIDAR_BVH_SSE
+void FLidarTriangleBvh::TracePacket(const FLidarVector3 &Start, const FLidarVector3* Ends,
+                                    int32_t NumRays, FLidarBvhHit* OutHits) const {
+    // Short packets are padded with copies of their first beam, whose results are dropped
+    FLidarVector3 Directions[4];
+    alignas(16) float Lengths[4];
+    alignas(16) float Components[6][4];
+    for (int32_t i = 0; i < 4; i++) {
+        const FLidarVector3 Delta = Ends[i < NumRays ? i : 0] - Start;
+        Lengths[i] = Delta.Size();
+        Directions[i] = Lengths[i] > 0.f ? Delta * (1.f / Lengths[i]) : FLidarVector3();
+        const FLidarVector3 InverseDirection = SafeInverse(Directions[i]);
+        Components[0][i] = Directions[i].X;
+        Components[1][i] = Directions[i].Y;
+        Components[2][i] = Directions[i].Z;
+        Components[3][i] = InverseDirection.X;
+        Components[4][i] = InverseDirection.Y;
+        Components[5][i] = InverseDirection.Z;
+    }
+    for (int32_t i = 0; i < NumRays; i++) OutHits[i] = FLidarBvhHit();
+    if (Nodes.empty()) return;
+
+    const __m128 Origin[3] = {_mm_set1_ps(Start.X), _mm_set1_ps(Start.Y), _mm_set1_ps(Start.Z)};
+    const __m128 Dx = _mm_load_ps(Components[0]);
+    const __m128 Dy = _mm_load_ps(Components[1]);
+    const __m128 Dz = _mm_load_ps(Components[2]);
+    const __m128 InverseDirection[3] = {_mm_load_ps(Components[3]), _mm_load_ps(Components[4]),
+                                        _mm_load_ps(Components[5])};
+    const __m128 Zero = _mm_setzero_ps();
+    const __m128 One = _mm_set1_ps(1.f);
+    const __m128 SignMask = _mm_set1_ps(-0.f);
+    const __m128 MinDeterminant = _mm_set1_ps(1.e-12f);
+
+    __m128 Closest = _mm_load_ps(Lengths);
+    __m128i HitTriangle = _mm_set1_epi32(-1);
+    FStackEntry Stack[MaxStackDepth];
+    int32_t StackSize = 0;
+    float RootEntry;
+    if (IntersectBox4(Nodes[0].Min, Nodes[0].Max, Origin, InverseDirection, Closest,
+                      RootEntry)) {
+        Stack[StackSize++] = {0, RootEntry};
+    }
+
+    while (StackSize > 0) {
+        const FStackEntry Entry = Stack[--StackSize];
+        if (_mm_movemask_ps(_mm_cmple_ps(_mm_set1_ps(Entry.Entry), Closest)) == 0) continue;
+        const FNode &Node = Nodes[Entry.Node];
+
+        if (Node.NumTriangles > 0) {
+            for (uint32_t i = Node.FirstIndex; i < Node.FirstIndex + Node.NumTriangles; i++) {
+                const FTriangle &Triangle = Triangles[i];
+                // The beams share their start, so T, Q and the distance numerator are
+                // worked out once for the whole packet
+                const FLidarVector3 T = Start - Triangle.Vertex;
+                const FLidarVector3 Q = Cross(T, Triangle.Edge1);
+                const float DistanceNumerator = FLidarVector3::Dot(Triangle.Edge2, Q);
+
+                const __m128 E2x = _mm_set1_ps(Triangle.Edge2.X);
+                const __m128 E2y = _mm_set1_ps(Triangle.Edge2.Y);
+                const __m128 E2z = _mm_set1_ps(Triangle.Edge2.Z);
+                const __m128 Px = _mm_sub_ps(_mm_mul_ps(Dy, E2z), _mm_mul_ps(Dz, E2y));
+                const __m128 Py = _mm_sub_ps(_mm_mul_ps(Dz, E2x), _mm_mul_ps(Dx, E2z));
+                const __m128 Pz = _mm_sub_ps(_mm_mul_ps(Dx, E2y), _mm_mul_ps(Dy, E2x));
+                const __m128 Determinant = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(Triangle.Edge1.X), Px),
+                                   _mm_mul_ps(_mm_set1_ps(Triangle.Edge1.Y), Py)),
+                        _mm_mul_ps(_mm_set1_ps(Triangle.Edge1.Z), Pz));
+                const __m128 InverseDeterminant = _mm_div_ps(One, Determinant);
+                const __m128 U = _mm_mul_ps(
+                        _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(T.X), Px),
+                                              _mm_mul_ps(_mm_set1_ps(T.Y), Py)),
+                                   _mm_mul_ps(_mm_set1_ps(T.Z), Pz)),
+                        InverseDeterminant);
+                const __m128 V = _mm_mul_ps(
+                        _mm_add_ps(_mm_add_ps(_mm_mul_ps(Dx, _mm_set1_ps(Q.X)),
+                                              _mm_mul_ps(Dy, _mm_set1_ps(Q.Y))),
+                                   _mm_mul_ps(Dz, _mm_set1_ps(Q.Z))),
+                        InverseDeterminant);
+                const __m128 Distance =
+                        _mm_mul_ps(_mm_set1_ps(DistanceNumerator), InverseDeterminant);
+
+                __m128 Hit = _mm_cmpge_ps(_mm_andnot_ps(SignMask, Determinant), MinDeterminant);
+                Hit = _mm_and_ps(Hit, _mm_cmpge_ps(U, Zero));
+                Hit = _mm_and_ps(Hit, _mm_cmpge_ps(V, Zero));
+                Hit = _mm_and_ps(Hit, _mm_cmple_ps(_mm_add_ps(U, V), One));
+                Hit = _mm_and_ps(Hit, _mm_cmpgt_ps(Distance, Zero));
+                Hit = _mm_and_ps(Hit, _mm_cmplt_ps(Distance, Closest));
+                if (_mm_movemask_ps(Hit) == 0) continue;
+                Closest = Select(Hit, Distance, Closest);
+                HitTriangle = _mm_castps_si128(Select(Hit, _mm_castsi128_ps(_mm_set1_epi32(i)),
+                                                      _mm_castsi128_ps(HitTriangle)));
+            }
+            continue;
+        }
+
+        float Entries[2] = {FLT_MAX, FLT_MAX};
+        bool bHits[2];
+        for (int32_t Child = 0; Child < 2; Child++) {
+            const FNode &ChildNode = Nodes[Node.FirstIndex + Child];
+            bHits[Child] = IntersectBox4(ChildNode.Min, ChildNode.Max, Origin, InverseDirection,
+                                         Closest, Entries[Child]);
+        }
+        const int32_t Near = Entries[1] < Entries[0] ? 1 : 0;
+        if (bHits[1 - Near]) Stack[StackSize++] = {Node.FirstIndex + 1 - Near, Entries[1 - Near]};
+        if (bHits[Near]) Stack[StackSize++] = {Node.FirstIndex + Near, Entries[Near]};
+    }
+
+    alignas(16) float Distances[4];
+    alignas(16) int32_t Hits[4];
+    _mm_store_ps(Distances, Closest);
+    _mm_store_si128(reinterpret_cast<__m128i*>(Hits), HitTriangle);
+    for (int32_t i = 0; i < NumRays; i++) {
+        if (Hits[i] >= 0) MakeHit(Start, Directions[i], Distances[i], Hits[i], OutHits[i]);
+    }
+}
+#else
+void FLidarTriangleBvh::TracePacket(const FLidarVector3 &Start, const FLidarVector3* Ends,
+                                    int32_t NumRays, FLidarBvhHit* OutHits) const {
+    for (int32_t i = 0; i < NumRays; i++) OutHits[i] = Trace(Start, Ends[i]);
+}
+#endif
+
+void FLidarTriangleBvh::MakeHit(const FLidarVector3 &Start, const FLidarVector3 &Direction,
+                                float Distance, int32_t Triangle, FLidarBvhHit &OutHit) const {
+    const FLidarVector3 &Normal = Normals[Triangle];
+    OutHit.bBlockingHit = true;
+    OutHit.Distance = Distance;
+    OutHit.ImpactPoint = Start + Direction * Distance;
+    OutHit.ImpactNormal = FLidarVector3::Dot(Normal, Direction) > 0.f ? -Normal : Normal;
+    OutHit.ObjectIndex = ObjectIndices[Triangle];
+}
@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarVelodynePackets.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Offsets of the framing inside the pcap record
+constexpr int32_t EthernetOffset = FLidarVelodynePacketEncoder::PcapRecordHeaderSize;
+constexpr int32_t IpOffset = EthernetOffset + 14;
+constexpr int32_t UdpOffset = IpOffset + 20;
+constexpr int32_t PayloadOffset = UdpOffset + 8;
+
+// Payload bytes after the firing blocks: the timestamp, then the factory bytes
+constexpr int32_t TimestampOffset =
+        PayloadOffset + FLidarVelodynePacketEncoder::BlocksPerPacket *
+                                FLidarVelodynePacketEncoder::BlockSize;
+
+// The sensor's defaults: strongest return mode from an HDL-32E at 192.168.1.201, broadcast
+constexpr uint8_t ReturnModeStrongest = 0x37;
+constexpr uint8_t ProductIdHdl32E = 0x21;
+constexpr uint8_t SensorMac[6] = {0x60, 0x76, 0x88, 0x00, 0x00, 0x01};
+constexpr uint8_t SensorIp[4] = {192, 168, 1, 201};
+constexpr uint8_t BroadcastIp[4] = {255, 255, 255, 255};
+
+// Packet headers are in network byte order, the payload and pcap headers are little-endian
+void WriteBigEndian16(uint8_t* Out, uint16_t Value) {
+    Out[0] = (uint8_t)(Value >> 8);
+    Out[1] = (uint8_t)Value;
+}
+
+void WriteLittleEndian16(uint8_t* Out, uint16_t Value) {
+    Out[0] = (uint8_t)Value;
+    Out[1] = (uint8_t)(Value >> 8);
+}
+
+void WriteLittleEndian32(uint8_t* Out, uint32_t Value) {
+    Out[0] = (uint8_t)Value;
+    Out[1] = (uint8_t)(Value >> 8);
+    Out[2] = (uint8_t)(Value >> 16);
+    Out[3] = (uint8_t)(Value >> 24);
+}
+
+uint16_t GetIpChecksum(const uint8_t* Header) {
+    uint32_t Sum = 0;
+    for (int32_t i = 0; i < 20; i += 2) Sum += ((uint32_t)Header[i] << 8) | Header[i + 1];
+    while (Sum >> 16) Sum = (Sum & 0xFFFF) + (Sum >> 16);
+    return (uint16_t)~Sum;
+}
+
+// Hundredths of a degree in [0, 36000)
+uint16_t GetPacketAzimuth(float AzimuthDegrees) {
+    float Wrapped = std::fmod(AzimuthDegrees, 360.f);
+    if (Wrapped < 0.f) Wrapped += 360.f;
+    return (uint16_t)(std::lround(Wrapped * 100.f) % 36000);
+}
+
+}  // namespace
+
+FLidarVelodynePacketEncoder::FLidarVelodynePacketEncoder() {
+    std::memset(Record, 0, sizeof(Record));
+    WriteLittleEndian32(Record + 8, FrameSize);
+    WriteLittleEndian32(Record + 12, FrameSize);
+
+    uint8_t* Ethernet = Record + EthernetOffset;
+    std::memset(Ethernet, 0xFF, 6);
+    std::memcpy(Ethernet + 6, SensorMac, sizeof(SensorMac));
+    WriteBigEndian16(Ethernet + 12, 0x0800);
+
+    uint8_t* Ip = Record + IpOffset;
+    Ip[0] = 0x45;
+    WriteBigEndian16(Ip + 2, 20 + 8 + PayloadSize);
+    // Don't fragment, 64 hops, UDP
+    WriteBigEndian16(Ip + 6, 0x4000);
+    Ip[8] = 64;
+    Ip[9] = 17;
+    std::memcpy(Ip + 12, SensorIp, sizeof(SensorIp));
+    std::memcpy(Ip + 16, BroadcastIp, sizeof(BroadcastIp));
+
+    // The UDP checksum is optional over IPv4 and left 0, as the sensor does
+    uint8_t* Udp = Record + UdpOffset;
+    WriteBigEndian16(Udp, DataPort);
+    WriteBigEndian16(Udp + 2, DataPort);
+    WriteBigEndian16(Udp + 4, 8 + PayloadSize);
+
+    Record[TimestampOffset + 4] = ReturnModeStrongest;
+    Record[TimestampOffset + 5] = ProductIdHdl32E;
+}
+
+void FLidarVelodynePacketEncoder::AppendPcapFileHeader(FLidarByteSink &Out) {
+    uint8_t* Header = Out.Append(PcapFileHeaderSize);
+    std::memset(Header, 0, PcapFileHeaderSize);
+    WriteLittleEndian32(Header, 0xA1B2C3D4);
+    WriteLittleEndian16(Header + 4, 2);
+    WriteLittleEndian16(Header + 6, 4);
+    WriteLittleEndian32(Header + 16, 65535);
+    // LINKTYPE_ETHERNET
+    WriteLittleEndian32(Header + 20, 1);
+}
+
+bool FLidarVelodynePacketEncoder::AddColumn(const FLidarPointCloud &Cloud, int32_t FirstPoint,
+                                            int32_t NumPoints, float AzimuthDegrees) {
+    if (NumBlocks == 0 && NumPoints > 0) PacketTime = Cloud.Time[FirstPoint];
+
+    uint8_t* Block = Record + PayloadOffset + NumBlocks * BlockSize;
+    LastAzimuth = GetPacketAzimuth(AzimuthDegrees);
+    WriteLittleEndian16(Block, 0xEEFF);
+    WriteLittleEndian16(Block + 2, LastAzimuth);
+
+    // Channel records of distance in 2 mm units and reflectivity, 0 for no return
+    uint8_t* Channel = Block + 4;
+    const int32_t NumChannels = std::min(NumPoints, ChannelsPerBlock);
+    for (int32_t i = FirstPoint; i < FirstPoint + NumChannels; i++) {
+        uint16_t Distance = 0;
+        uint8_t Reflectivity = 0;
+        if (Cloud.HasReturn(i)) {
+            Distance = (uint16_t)std::min(std::lround(Cloud.Range[i] * 5.f), 65535L);
+            Reflectivity = (uint8_t)std::min(std::max(Cloud.Intensity[i], 0.f), 255.f);
+        }
+        WriteLittleEndian16(Channel, Distance);
+        Channel[2] = Reflectivity;
+        Channel += 3;
+    }
+    std::memset(Channel, 0, (ChannelsPerBlock - NumChannels) * 3);
+
+    if (++NumBlocks < BlocksPerPacket) return false;
+    FinishPacket();
+    return true;
+}
+
+bool FLidarVelodynePacketEncoder::Flush() {
+    if (NumBlocks == 0) return false;
+    for (; NumBlocks < BlocksPerPacket; NumBlocks++) {
+        uint8_t* Block = Record + PayloadOffset + NumBlocks * BlockSize;
+        WriteLittleEndian16(Block, 0xEEFF);
+        WriteLittleEndian16(Block + 2, LastAzimuth);
+        std::memset(Block + 4, 0, ChannelsPerBlock * 3);
+    }
+    FinishPacket();
+    return true;
+}
+
+void FLidarVelodynePacketEncoder::FinishPacket() {
+    NumBlocks = 0;
+
+    const double Seconds = std::max(PacketTime, 0.0);
+    const uint64_t Microseconds = (uint64_t)std::llround(Seconds * 1e6);
+    WriteLittleEndian32(Record, (uint32_t)(Microseconds / 1000000));
+    WriteLittleEndian32(Record + 4, (uint32_t)(Microseconds % 1000000));
+    WriteLittleEndian32(Record + TimestampOffset, (uint32_t)(Microseconds % 3600000000ull));
+
+    uint8_t* Ip = Record + IpOffset;
+    WriteBigEndian16(Ip + 4, IpIdentification++);
+    WriteBigEndian16(Ip + 10, 0);
+    WriteBigEndian16(Ip + 10, GetIpChecksum(Ip));
+}
@@ -0,0 +1,7 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Modules/ModuleManager.h"
+
+// The core library is plain C++ with no module state. This file is only part of the engine
+// build; the standalone CMake build compiles everything else in this module.
+IMPLEMENT_MODULE(FDefaultModuleImpl, SpinningLidarCore);
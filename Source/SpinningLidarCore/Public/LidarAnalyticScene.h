@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCoreTypes.h"
+#include <vector>
+
+// The result of tracing one beam against a FLidarAnalyticScene
+struct FLidarAnalyticHit {
+    bool bBlockingHit = false;
+    // Distance in cm from the start of the beam to the impact point
+    float Distance = 0.f;
+    FLidarVector3 ImpactPoint;
+    FLidarVector3 ImpactNormal;
+};
+
+/*A stand-in for the physics scene made of planes and spheres, traced analytically.
+ * It lets the whole sensor pipeline run without the engine or a GPU, with results that are
+ * known exactly, for benchmarks and regression runs of end-to-end throughput.*/
+class SPINNINGLIDARCORE_API FLidarAnalyticScene {
+ public:
+    // An infinite plane through Point, facing along Normal. Beams only hit its front side.
+    void AddPlane(const FLidarVector3 &Point, const FLidarVector3 &Normal);
+
+    void AddSphere(const FLidarVector3 &Center, float Radius);
+
+    // A ground plane at z = 0 with a ring of spheres and four walls around the origin,
+    // roughly the clutter a sensor sees in a street scene
+    static FLidarAnalyticScene MakeStreetScene();
+
+    // The first surface along the beam from Start to End
+    FLidarAnalyticHit Trace(const FLidarVector3 &Start, const FLidarVector3 &End) const;
+
+ private:
+    struct FPlane {
+        FLidarVector3 Normal;
+        float Offset;
+    };
+    struct FSphere {
+        FLidarVector3 Center;
+        float Radius;
+    };
+
+    std::vector<FPlane> Planes;
+    std::vector<FSphere> Spheres;
+};
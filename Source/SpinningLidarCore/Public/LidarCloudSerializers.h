@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarPointCloud.h"
+#include <cstddef>
+#include <vector>
+
+/*A growable byte buffer the serializers append to.
+ * The engine implements it over the output writer's TArray buffers and the core over
+ * std::vector, so serialized bytes are written straight into the caller's buffer.*/
+class FLidarByteSink {
+ public:
+    virtual ~FLidarByteSink() = default;
+
+    // Add Count bytes at the end of the buffer, returning a pointer to the first for the
+    // caller to fill in
+    virtual uint8_t* Append(size_t Count) = 0;
+};
+
+class SPINNINGLIDARCORE_API FLidarVectorByteSink : public FLidarByteSink {
+ public:
+    uint8_t* Append(size_t Count) override {
+        const size_t FirstByte = Bytes.size();
+        Bytes.resize(FirstByte + Count);
+        return Bytes.data() + FirstByte;
+    }
+
+    std::vector<uint8_t> Bytes;
+};
+
+// One lidar return, laid out exactly as it is written to the PCD and PLY files.
+// Multi-return clouds add a uint8 return index after each record, then labeled clouds a
+// uint32 instance id and a uint16 class id.
+struct FLidarPointRecord {
+    float X;
+    float Y;
+    float Z;
+    float Intensity;
+    double Timestamp;
+};
+static_assert(sizeof(FLidarPointRecord) == 24, "FLidarPointRecord must be tightly packed");
+
+// One lidar return in the KITTI velodyne layout
+struct FLidarKittiPoint {
+    float X;
+    float Y;
+    float Z;
+    float Reflectance;
+};
+static_assert(sizeof(FLidarKittiPoint) == 16, "FLidarKittiPoint must be tightly packed");
+
+/*Serializers for the point cloud output formats.
+ * The binary formats each append a complete file for one revolution, packing the points that
+ * returned straight from the point cloud arrays into their binary records.
+ * CSV and the PCD and PLY files keep Unreal's units and frame: centimetres in a left-handed
+ * frame, intensity from 0 to 255 and the timestamp in seconds.
+ * KITTI files follow the KITTI convention instead: metres in a right-handed frame
+ * (x forward, y left, z up) and reflectance from 0 to 1.*/
+struct SPINNINGLIDARCORE_API FLidarCloudSerializers {
+    // One "timestamp,x,y,z,intensity" row for each of NumPoints points from FirstPoint,
+    // including beams with no return but not missing second returns or filtered points.
+    // Multi-return clouds add a return index column, and labeled clouds instance id and class
+    // id columns.
+    static void AppendCsv(const FLidarPointCloud &Cloud, int32_t FirstPoint, int32_t NumPoints,
+                          const char* LineTerminator, FLidarByteSink &Out);
+
+    static void AppendPcdBinary(const FLidarPointCloud &Cloud, FLidarByteSink &Out);
+    static void AppendPlyBinary(const FLidarPointCloud &Cloud, FLidarByteSink &Out);
+    static void AppendKittiBin(const FLidarPointCloud &Cloud, FLidarByteSink &Out);
+
+    // The SemanticKITTI .label file of a labeled cloud: a uint32 for each point of the
+    // KITTI bin, with the class id in the low 16 bits and the instance id in the high 16
+    static void AppendKittiLabels(const FLidarPointCloud &Cloud, FLidarByteSink &Out);
+
+ private:
+    static void AppendText(const char* Text, size_t Length, FLidarByteSink &Out);
+    static void AppendPointRecords(const FLidarPointCloud &Cloud, int32_t NumReturns,
+                                   FLidarByteSink &Out);
+};
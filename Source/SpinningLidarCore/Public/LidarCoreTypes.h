@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+/*Basic types for the lidar core library.
+ * The core is plain C++17 with no engine dependencies, so that the sensor model can be built,
+ * profiled and benchmarked outside of Unreal. Inside the engine it is compiled as its own
+ * module, which defines the export macro; everywhere else it is defined away here.*/
+#ifndef SPINNINGLIDARCORE_API
+#define SPINNINGLIDARCORE_API
+#endif
+
+// A position or direction in Unreal's units and frame: centimetres, x forward, y right, z up
+struct FLidarVector3 {
+    float X = 0.f;
+    float Y = 0.f;
+    float Z = 0.f;
+
+    FLidarVector3() = default;
+    FLidarVector3(float InX, float InY, float InZ) : X(InX), Y(InY), Z(InZ) {}
+
+    FLidarVector3 operator+(const FLidarVector3 &Other) const {
+        return FLidarVector3(X + Other.X, Y + Other.Y, Z + Other.Z);
+    }
+    FLidarVector3 operator-(const FLidarVector3 &Other) const {
+        return FLidarVector3(X - Other.X, Y - Other.Y, Z - Other.Z);
+    }
+    FLidarVector3 operator-() const { return FLidarVector3(-X, -Y, -Z); }
+    FLidarVector3 operator*(float Scale) const {
+        return FLidarVector3(X * Scale, Y * Scale, Z * Scale);
+    }
+
+    static float Dot(const FLidarVector3 &A, const FLidarVector3 &B) {
+        return A.X * B.X + A.Y * B.Y + A.Z * B.Z;
+    }
+
+    float Size() const { return std::sqrt(Dot(*this, *this)); }
+
+    // The unit vector in the same direction, or zero for a vector too short to normalize
+    FLidarVector3 GetSafeNormal() const {
+        const float SquaredSize = Dot(*this, *this);
+        if (SquaredSize < 1.e-8f) return FLidarVector3();
+        return *this * (1.f / std::sqrt(SquaredSize));
+    }
+};
+
+// An axis-aligned box, such as the bounds of something beams may hit
+struct FLidarBox {
+    FLidarVector3 Min;
+    FLidarVector3 Max;
+
+    FLidarBox() = default;
+    FLidarBox(const FLidarVector3 &InMin, const FLidarVector3 &InMax) : Min(InMin), Max(InMax) {}
+
+    // The part of the segment from Start to End inside the box, as fractions of the way along
+    // the segment. Returns false if the segment misses the box.
+    bool ClipSegment(const FLidarVector3 &Start, const FLidarVector3 &End, float &OutEnter,
+                     float &OutExit) const {
+        const float Starts[3] = {Start.X, Start.Y, Start.Z};
+        const float Deltas[3] = {End.X - Start.X, End.Y - Start.Y, End.Z - Start.Z};
+        const float Mins[3] = {Min.X, Min.Y, Min.Z};
+        const float Maxs[3] = {Max.X, Max.Y, Max.Z};
+        float Enter = 0.f;
+        float Exit = 1.f;
+        for (int32_t Axis = 0; Axis < 3; Axis++) {
+            // A segment parallel to a pair of faces is inside them all along, or never
+            if (Deltas[Axis] == 0.f) {
+                if (Starts[Axis] < Mins[Axis] || Starts[Axis] > Maxs[Axis]) return false;
+                continue;
+            }
+            const float InverseDelta = 1.f / Deltas[Axis];
+            float Near = (Mins[Axis] - Starts[Axis]) * InverseDelta;
+            float Far = (Maxs[Axis] - Starts[Axis]) * InverseDelta;
+            if (Near > Far) std::swap(Near, Far);
+            Enter = std::max(Enter, Near);
+            Exit = std::min(Exit, Far);
+            if (Enter > Exit) return false;
+        }
+        OutEnter = Enter;
+        OutExit = Exit;
+        return true;
+    }
+};
+
+/*A rotation and translation, stored as the three rotated unit axes and the origin.
+ * This is the transform of a sensor frame in world coordinates with no scale.*/
+struct FLidarRigidTransform {
+    FLidarVector3 AxisX = FLidarVector3(1.f, 0.f, 0.f);
+    FLidarVector3 AxisY = FLidarVector3(0.f, 1.f, 0.f);
+    FLidarVector3 AxisZ = FLidarVector3(0.f, 0.f, 1.f);
+    FLidarVector3 Origin;
+
+    // A direction from the local frame into world coordinates
+    FLidarVector3 TransformVector(const FLidarVector3 &Vector) const {
+        return AxisX * Vector.X + AxisY * Vector.Y + AxisZ * Vector.Z;
+    }
+
+    // A position from the local frame into world coordinates
+    FLidarVector3 TransformPosition(const FLidarVector3 &Position) const {
+        return Origin + TransformVector(Position);
+    }
+
+    // A position from world coordinates into the local frame
+    FLidarVector3 InverseTransformPosition(const FLidarVector3 &Position) const {
+        const FLidarVector3 Offset = Position - Origin;
+        return FLidarVector3(FLidarVector3::Dot(Offset, AxisX), FLidarVector3::Dot(Offset, AxisY),
+                             FLidarVector3::Dot(Offset, AxisZ));
+    }
+
+    // The frame rotated by yaw, pitch and roll in degrees and placed at Location,
+    // with the same conventions as Unreal's FRotator
+    static FLidarRigidTransform FromRotator(float Pitch, float Yaw, float Roll,
+                                            const FLidarVector3 &Location);
+};
+
+// Degrees to radians
+constexpr float LidarDegreesToRadians = 3.14159265358979323846f / 180.f;
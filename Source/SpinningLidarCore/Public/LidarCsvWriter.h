@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCloudSerializers.h"
+#include <vector>
+
+/*Writes the CSV rows of FLidarCloudSerializers::AppendCsv without going through printf.
+ * The rows of a batch are formatted into a buffer the writer keeps, which is appended to the
+ * output in one go, so nothing is allocated once the buffer has grown to the largest batch.
+ * Up to 9 fixed decimals of values below 2^32, which covers every position and timestamp in
+ * practice, are formatted exactly with integer arithmetic, and anything else with
+ * std::to_chars. Neither looks at the locale. With a fixed number of decimals the text is byte
+ * for byte that of printf's %.*f, so the defaults give the same file as AppendCsv. ShortestRoundTrip gives the shortest text that reads back as
+ * the same value instead.
+ * Where the standard library has no floating-point to_chars, it falls back to snprintf per
+ * number, and ShortestRoundTrip to enough significant digits to round-trip.*/
+class SPINNINGLIDARCORE_API FLidarCsvWriter {
+ public:
+    static constexpr int32_t ShortestRoundTrip = -1;
+    // The most decimals a column can have
+    static constexpr int32_t MaxDecimals = 17;
+
+    // Decimals of the timestamp, and of the position and intensity columns, from 0 to
+    // MaxDecimals, or ShortestRoundTrip
+    explicit FLidarCsvWriter(int32_t InTimestampDecimals = 9, int32_t InValueDecimals = 6);
+
+    // Append the rows of NumPoints points from FirstPoint, as AppendCsv does
+    void Append(const FLidarPointCloud &Cloud, int32_t FirstPoint, int32_t NumPoints,
+                const char* LineTerminator, FLidarByteSink &Out);
+
+ private:
+    int32_t TimestampDecimals;
+    int32_t ValueDecimals;
+    std::vector<char> Buffer;
+};
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCoreTypes.h"
+
+/*The sensor's own time base: an integer nanosecond clock that fires columns at a fixed rate,
+ * independent of the engine's frame rate.
+ * Each engine frame advances the clock by the frame's duration, and every firing whose time
+ * falls within the frame is due. Firing times are computed from the firing's index rather
+ * than by adding up a period, so they don't drift or lose precision however long the
+ * simulation runs, and the fractional remainder of a firing carries over between frames.*/
+class SPINNINGLIDARCORE_API FLidarFiringClock {
+ public:
+    static constexpr int64_t NanosecondsPerSecond = 1000000000;
+
+    FLidarFiringClock() = default;
+    explicit FLidarFiringClock(double InFiringRateHz);
+
+    // Advance the clock by one engine frame. Returns the number of firings due in the frame,
+    // which are the ones from GetNextFiring on.
+    int32_t Advance(double DeltaSeconds);
+
+    // Advance the clock to the next firing and make exactly that one due, for stepping the
+    // simulation one firing at a time
+    int32_t AdvanceOneFiring();
+
+    // The index of the next firing that hasn't been taken yet. Call TakeFiring for each
+    // firing due, in order.
+    int64_t GetNextFiring() const { return NextFiring; }
+    int64_t TakeFiring() { return NextFiring++; }
+
+    // When a firing happens, counting from the clock's start
+    int64_t GetFiringTimeNanoseconds(int64_t Firing) const;
+    double GetFiringTimeSeconds(int64_t Firing) const;
+
+    // The clock's current time, and its time at the start of the last frame
+    int64_t GetTimeNanoseconds() const { return TimeNanoseconds; }
+    int64_t GetFrameStartNanoseconds() const { return FrameStartNanoseconds; }
+
+    // How far through the last frame a firing happened, from 0 at its start to 1 at its end
+    float GetFrameAlpha(int64_t Firing) const;
+
+    double GetFiringRateHz() const { return FiringRateHz; }
+    double GetFiringPeriodSeconds() const { return 1.0 / FiringRateHz; }
+
+ private:
+    double FiringRateHz = 1.0;
+    int64_t TimeNanoseconds = 0;
+    int64_t FrameStartNanoseconds = 0;
+    int64_t NextFiring = 0;
+    // The first firing after the end of the last frame
+    int64_t EndFiring = 0;
+};
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCloudSerializers.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*The names behind the integer ground-truth labels of a recording.
+ * Each point carries the class id and instance id of what it hit. Ids are handed out in order
+ * from 1, and 0 stands for nothing, or nothing labeled. Every instance is of one class.
+ * Entries are written out as they are added, so each appears once in a recording's dictionary
+ * however many points carry it:
+ *
+ *   kind,id,name,class id
+ *   class,1,car,
+ *   instance,1,BP_Car_C_3,1
+ *
+ * Names with commas, quotes or line breaks are quoted as in RFC 4180.*/
+class SPINNINGLIDARCORE_API FLidarLabelDictionary {
+ public:
+    // The id of the class with the given name, added if it's new. An empty name, or a new
+    // name once every id is taken, is class 0.
+    uint16_t FindOrAddClass(const std::string &Name);
+
+    // A new instance of a class, whose id is 0 once every id is taken
+    uint32_t AddInstance(const std::string &Name, uint16_t ClassId);
+
+    // The class of an instance, 0 for instance 0
+    uint16_t GetInstanceClass(uint32_t InstanceId) const {
+        return InstanceId > 0 ? Instances[InstanceId - 1].ClassId : 0;
+    }
+
+    int32_t NumClasses() const { return (int32_t)ClassNames.size(); }
+    int32_t NumInstances() const { return (int32_t)Instances.size(); }
+
+    // Whether there are entries that AppendNewEntries hasn't written yet
+    bool HasNewEntries() const {
+        return NumClassesWritten < ClassNames.size() || NumInstancesWritten < Instances.size();
+    }
+
+    static void AppendHeader(const char* LineTerminator, FLidarByteSink &Out);
+
+    // Append a row for each class and instance added since the last call
+    void AppendNewEntries(const char* LineTerminator, FLidarByteSink &Out);
+
+ private:
+    struct FInstance {
+        std::string Name;
+        uint16_t ClassId;
+    };
+
+    static void AppendRow(const char* Kind, uint32_t Id, const std::string &Name,
+                          const char* ClassColumn, const char* LineTerminator,
+                          FLidarByteSink &Out);
+
+    std::unordered_map<std::string, uint16_t> ClassIds;
+    std::vector<std::string> ClassNames;
+    std::vector<FInstance> Instances;
+    size_t NumClassesWritten = 0;
+    size_t NumInstancesWritten = 0;
+};
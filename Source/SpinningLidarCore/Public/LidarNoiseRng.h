@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCoreTypes.h"
+
+/*Counter-based random numbers for the lidar noise and dropout models, using Philox4x32-10.
+ * Every value is a pure function of the sensor's seed and id (the key) and of the revolution,
+ * column, beam and stream it is drawn for (the counter), so there is no generator state.
+ * The same beam gets the same value no matter which thread asks for it or in what order,
+ * which makes noise reproducible run to run and identical between serial and parallel
+ * processing. Values are generated four beams at a time; FillUniform and FillGaussian
+ * produce a run of a column at once and match the single-beam functions exactly.*/
+class SPINNINGLIDARCORE_API FLidarNoiseRng {
+ public:
+    // Independent streams of numbers drawn for each beam
+    enum class EStream : uint32_t {
+        Dropout = 0,
+        RangeNoise = 1
+    };
+
+    explicit FLidarNoiseRng(uint32_t Seed = 0, uint32_t SensorId = 0);
+
+    // Uniformly distributed numbers in [0, 1), one for each of NumBeams beams of a column
+    // starting at FirstBeam, which must be a multiple of four
+    void FillUniform(EStream Stream, uint32_t Revolution, uint32_t Column,
+                     float* OutValues, int32_t FirstBeam, int32_t NumBeams) const;
+
+    // Standard normal numbers (mean 0, standard deviation 1), one per beam in the same way
+    void FillGaussian(EStream Stream, uint32_t Revolution, uint32_t Column,
+                      float* OutValues, int32_t FirstBeam, int32_t NumBeams) const;
+
+    float Uniform(EStream Stream, uint32_t Revolution, uint32_t Column, uint32_t Beam) const;
+    float Gaussian(EStream Stream, uint32_t Revolution, uint32_t Column, uint32_t Beam) const;
+
+    // The Philox4x32-10 bijection from a 128-bit counter and 64-bit key to 128 random bits
+    static void Philox4x32(const uint32_t Counter[4], const uint32_t Key[2], uint32_t OutBits[4]);
+
+ private:
+    // The random bits shared by a group of four adjacent beams
+    void GenerateGroup(EStream Stream, uint32_t Revolution, uint32_t Column, uint32_t Group,
+                       uint32_t OutBits[4]) const;
+    static void UniformFromBits(const uint32_t Bits[4], float OutValues[4]);
+    static void GaussianFromBits(const uint32_t Bits[4], float OutValues[4]);
+
+    uint32_t Key[2];
+};
@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCoreTypes.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/*The points of one revolution of the sensor, stored as a structure of arrays.
+ * Points are laid out column by column in firing order, NumBeams points per column,
+ * including beams that did not return. In dual-return mode each column has a second
+ * NumBeams points after the first, holding each beam's second return.
+ * The trace stage writes each point in place, and the return, noise, transform and output
+ * stages then run over the arrays without copying.
+ * Clouds are taken from a FLidarPointCloudPool and reserve a full revolution up front,
+ * so they are not reallocated while a revolution is being filled.*/
+struct SPINNINGLIDARCORE_API FLidarPointCloud {
+    // Bits of the Flags array
+    enum EPointFlags : uint8_t {
+        // The beam hit something and its return was received
+        PointReturned = 1 << 0,
+        // The point is its beam's second return, which may not exist
+        PointSecondReturn = 1 << 1,
+        // The next three bits hold which surface along the beam the point came from, with 0
+        // for the first
+        ReturnIndexShift = 2,
+        ReturnIndexMask = 7 << ReturnIndexShift,
+        // The filter stage removed the point, and cleared its PointReturned flag
+        PointFiltered = 1 << 5,
+    };
+
+    // The revolution of the sensor these points belong to
+    int32_t Revolution = 0;
+
+    // Whether the points come from a multi-return mode, so the outputs carry return indices
+    bool bMultiReturn = false;
+
+    // Whether the points carry ground-truth labels, so the outputs write them
+    bool bLabeled = false;
+
+    // The sensor's frame in world coordinates when the revolution's first column fired
+    FLidarRigidTransform SensorPose;
+
+    // Position in cm, in world coordinates until the transform stage has run
+    std::vector<float> X;
+    std::vector<float> Y;
+    std::vector<float> Z;
+    // Distance in cm from the beam start to the point
+    std::vector<float> Range;
+    // Cosine of the angle between the reversed beam and the surface normal at the point
+    std::vector<float> CosIncidence;
+    // Return intensity on a scale of 0 to 255
+    std::vector<float> Intensity;
+    // Time in seconds at which the beam fired
+    std::vector<double> Time;
+    // Index of the beam within its column, and of the column within the revolution
+    std::vector<uint16_t> Beam;
+    std::vector<uint16_t> Column;
+    std::vector<uint8_t> Flags;
+    // The ground-truth object and class of what each point hit, 0 for nothing or nothing
+    // labeled. A FLidarLabelDictionary has their names.
+    std::vector<uint32_t> InstanceId;
+    std::vector<uint16_t> ClassId;
+
+    int32_t Num() const { return (int32_t)Flags.size(); }
+
+    bool HasReturn(int32_t Index) const { return (Flags[Index] & PointReturned) != 0; }
+
+    // Whether the outputs that write every beam, returned or not, have a row for the point.
+    // Missing second returns and points the filter stage removed are left out.
+    bool HasBeamRow(int32_t Index) const {
+        return (Flags[Index] & PointFiltered) == 0 &&
+               (HasReturn(Index) || (Flags[Index] & PointSecondReturn) == 0);
+    }
+
+    int32_t GetReturnIndex(int32_t Index) const {
+        return (Flags[Index] & ReturnIndexMask) >> ReturnIndexShift;
+    }
+
+    // Surfaces past the eighth are all stored as the eighth
+    void SetReturnIndex(int32_t Index, int32_t ReturnIndex) {
+        Flags[Index] = (uint8_t)((Flags[Index] & ~ReturnIndexMask) |
+                                 (std::min(ReturnIndex, 7) << ReturnIndexShift));
+    }
+
+    FLidarVector3 GetPosition(int32_t Index) const {
+        return FLidarVector3(X[Index], Y[Index], Z[Index]);
+    }
+
+    void SetPosition(int32_t Index, const FLidarVector3 &Position) {
+        X[Index] = Position.X;
+        Y[Index] = Position.Y;
+        Z[Index] = Position.Z;
+    }
+
+    // Record when and by which beam of which column a point was fired
+    void SetFiring(int32_t Index, double FiringTime, int32_t BeamIndex, int32_t ColumnIndex) {
+        Time[Index] = FiringTime;
+        Beam[Index] = (uint16_t)BeamIndex;
+        Column[Index] = (uint16_t)ColumnIndex;
+    }
+
+    // The number of points whose beams returned
+    int32_t CountReturns() const;
+
+    // Add room for Count points at the end, returning the index of the first.
+    // The new points are for the trace stage to fill in.
+    int32_t AddUninitialized(int32_t Count);
+
+    // Make room for Count points without reallocating, and empty the cloud
+    void Reset(int32_t Count = 0);
+};
+
+/*Hands out point clouds and takes them back once their revolution has been written,
+ * so that after the first few revolutions no point storage is allocated.*/
+class SPINNINGLIDARCORE_API FLidarPointCloudPool {
+ public:
+    // An empty cloud with room for Capacity points
+    FLidarPointCloud* Acquire(int32_t Capacity);
+
+    // Give a cloud back to the pool. It must have come from Acquire.
+    void Release(FLidarPointCloud* Cloud);
+
+ private:
+    std::vector<std::unique_ptr<FLidarPointCloud>> Clouds;
+    std::vector<FLidarPointCloud*> FreeClouds;
+};
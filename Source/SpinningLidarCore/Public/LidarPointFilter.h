@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCoreTypes.h"
+#include "LidarPointCloud.h"
+#include <vector>
+
+// The parameters of the filter stage, with the same meaning and units as on the sensor actor
+struct FLidarPointFilterSettings {
+    // Remove the beams that didn't return, rather than writing them as 0, 0, 0
+    bool bDropMisses = false;
+    // Keep only the returns inside a box. Region is the frame of the box's centre relative to
+    // the sensor, and RegionExtent the box's half size along each of its axes, in cm.
+    bool bCropToRegion = false;
+    FLidarRigidTransform Region;
+    FLidarVector3 RegionExtent = FLidarVector3(1000.f, 1000.f, 1000.f);
+    // Keep one return per cube of this size in cm, on a grid aligned with the world axes.
+    // 0 keeps every return.
+    float VoxelSize = 0.f;
+};
+
+/*Thins out the points of each revolution between the return model and the outputs.
+ * Points are removed in place: their PointReturned flag is cleared and PointFiltered set, so
+ * the outputs that skip misses skip them too, and the CSV output writes no row for them. The
+ * cloud's layout of a column after another is left as it is.
+ * The voxel grid keeps the first return to reach each voxel in a revolution, so the points
+ * written are real returns with their own timestamps rather than averages. It is a hash grid
+ * sized for a full revolution when the filter is made, and every revolution starts a new
+ * generation of it instead of clearing it, so nothing is allocated or cleared as it runs.*/
+class SPINNINGLIDARCORE_API FLidarPointFilter {
+ public:
+    FLidarPointFilter() = default;
+    // MaxPointsPerRevolution sizes the voxel grid
+    FLidarPointFilter(const FLidarPointFilterSettings &InSettings,
+                      int32_t MaxPointsPerRevolution);
+
+    const FLidarPointFilterSettings &GetSettings() const { return Settings; }
+
+    // Whether the filter would remove anything
+    bool IsEnabled() const {
+        return Settings.bDropMisses || Settings.bCropToRegion || Settings.VoxelSize > 0.f;
+    }
+
+    // Filter a span of points still in world coordinates, fired from the sensor frame Sensor.
+    // Spans must come in firing order, as the voxel grid keeps the first return of each voxel
+    // and starts over whenever the cloud's revolution changes. Returns the number of returns
+    // left in the span.
+    int32_t Apply(FLidarPointCloud &Cloud, int32_t FirstPoint, int32_t NumPoints,
+                  const FLidarRigidTransform &Sensor);
+
+ private:
+    // A voxel of the grid, which is empty unless its generation is the current one
+    struct FVoxelSlot {
+        int32_t X;
+        int32_t Y;
+        int32_t Z;
+        uint32_t Generation;
+    };
+
+    // Add the voxel Position falls in, returning false if it was already in the grid
+    bool AddVoxel(const FLidarVector3 &Position);
+
+    FLidarPointFilterSettings Settings;
+    float InverseVoxelSize = 0.f;
+    std::vector<FVoxelSlot> Voxels;
+    uint32_t VoxelMask = 0;
+    uint32_t Generation = 0;
+    int32_t NumVoxels = 0;
+    int32_t MaxVoxels = 0;
+    // The revolution the grid holds, none to begin with
+    int32_t Revolution = -1;
+};
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCloudSerializers.h"
+#include "LidarPointCloud.h"
+#include <vector>
+
+/*Revolutions as range images, recorded one frame per revolution in a chunked container.
+ *
+ * A frame has one row per beam and one column per azimuth step. Each image is two planes:
+ * the uint16 range of every (beam, column) cell in units of RangeUnitCm, followed by the
+ * uint8 intensity of every cell, both row-major. A cell whose beam didn't return has range 0.
+ * Decompressed, a frame can be viewed as a [NumRows, NumColumns] tensor for each plane
+ * without copying.
+ *
+ * The file is a FLidarRangeImageFileHeader, then one chunk per frame, each a
+ * FLidarRangeImageFrameHeader followed by the frame's stored bytes, then the frame index and
+ * a FLidarRangeImageFooter at the very end. A reader seeks to any frame through the index,
+ * and a file cut short before its index can still be read chunk by chunk from the start.
+ * Everything is little-endian.
+ *
+ * The core leaves compressing the frames to the caller, and only records how each was
+ * stored.*/
+
+// How the bytes of a frame are stored
+enum class ELidarRangeImageCompression : uint32_t {
+    None = 0,
+    Zlib = 1
+};
+
+struct FLidarRangeImageFileHeader {
+    static constexpr uint32_t ExpectedMagic = 0x4D49524C;  // "LRIM"
+    static constexpr uint32_t CurrentVersion = 1;
+
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t NumRows;
+    uint32_t NumColumns;
+    // The range of one unit of the range plane, in cm
+    float RangeUnitCm;
+    uint32_t Reserved;
+};
+static_assert(sizeof(FLidarRangeImageFileHeader) == 24,
+              "FLidarRangeImageFileHeader must be tightly packed");
+
+struct FLidarRangeImageFrameHeader {
+    static constexpr uint32_t ExpectedMagic = 0x4649524C;  // "LRIF"
+
+    uint32_t Magic;
+    int32_t Revolution;
+    // When the first beam of the frame fired, in seconds
+    double StartTime;
+    // An ELidarRangeImageCompression
+    uint32_t Compression;
+    // The bytes that follow, and their size once decompressed
+    uint32_t StoredSize;
+    uint32_t ImageSize;
+    uint32_t Reserved;
+};
+static_assert(sizeof(FLidarRangeImageFrameHeader) == 32,
+              "FLidarRangeImageFrameHeader must be tightly packed");
+
+// One entry of the frame index for each frame, in the order they were written
+struct FLidarRangeImageIndexEntry {
+    // From the start of the file to the frame's FLidarRangeImageFrameHeader
+    uint64_t Offset;
+    int32_t Revolution;
+    uint32_t StoredSize;
+    double StartTime;
+};
+static_assert(sizeof(FLidarRangeImageIndexEntry) == 24,
+              "FLidarRangeImageIndexEntry must be tightly packed");
+
+// The last bytes of the file
+struct FLidarRangeImageFooter {
+    static constexpr uint32_t ExpectedMagic = 0x5849524C;  // "LRIX"
+
+    uint64_t IndexOffset;
+    uint32_t NumFrames;
+    uint32_t Magic;
+};
+static_assert(sizeof(FLidarRangeImageFooter) == 16,
+              "FLidarRangeImageFooter must be tightly packed");
+
+/*Builds the range images of revolutions and lays out the container around them.
+ * Every byte of the file goes through the encoder, which keeps track of the file offsets
+ * for the frame index.*/
+class SPINNINGLIDARCORE_API FLidarRangeImageEncoder {
+ public:
+    FLidarRangeImageEncoder() = default;
+    FLidarRangeImageEncoder(int32_t InNumRows, int32_t InNumColumns, float InRangeUnitCm);
+
+    int32_t GetNumRows() const { return NumRows; }
+    int32_t GetNumColumns() const { return NumColumns; }
+
+    // The size in bytes of a frame's image: both planes, before compression
+    size_t GetImageSize() const { return Image.size(); }
+
+    // Start the file
+    void AppendFileHeader(FLidarByteSink &Out);
+
+    // Quantize a revolution into the image, returning the image. Points whose beam or column
+    // is outside the image are left out, and so are cells of columns never fired.
+    const std::vector<uint8_t> &BuildImage(const FLidarPointCloud &Cloud);
+
+    // Add a frame chunk of Size stored bytes, and index it
+    void AppendFrame(int32_t Revolution, double StartTime,
+                     ELidarRangeImageCompression Compression, const uint8_t* Stored,
+                     uint32_t Size, FLidarByteSink &Out);
+
+    // Finish the file with the frame index and footer. Nothing is appended after this.
+    void AppendIndex(FLidarByteSink &Out);
+
+ private:
+    uint8_t* Append(size_t Count, FLidarByteSink &Out);
+
+    int32_t NumRows = 0;
+    int32_t NumColumns = 0;
+    float RangeUnitCm = 1.f;
+    std::vector<uint8_t> Image;
+    std::vector<FLidarRangeImageIndexEntry> Index;
+    // Bytes appended so far, which is where the next one goes in the file
+    uint64_t FileOffset = 0;
+};
@@ -0,0 +1,219 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCloudSerializers.h"
+#include "LidarCoreTypes.h"
+#include "LidarPointCloud.h"
+#include <cstddef>
+#include <vector>
+
+/*Whole revolutions recorded one frame after another in a seekable container.
+ *
+ * The file is a FLidarRecordingFileHeader, then one chunk per revolution, then the frame
+ * index and a FLidarRecordingFooter at the very end. Each chunk is a
+ * FLidarRecordingFrameHeader followed by the revolution's point arrays, every beam of it in
+ * the same structure-of-arrays layout as FLidarPointCloud. The header describes the frame
+ * on its own: its sequence number, when it started and ended, where the sensor was, and where
+ * each array starts in the chunk.
+ *
+ * Chunks, headers and arrays all start on 8-byte boundaries, so a reader that maps the file
+ * reads the arrays in place. A reader seeks to any frame through the index. A recording cut
+ * short before its index, such as by a crash, is read by stepping from each chunk to the next
+ * by its size, which only touches the chunk headers, and a last chunk written in part is
+ * left out. Everything is little-endian.*/
+
+// Bits of FLidarRecordingFileHeader::Flags
+enum ELidarRecordingFileFlags : uint32_t {
+    // The points are in the sensor's local frame rather than in world coordinates
+    RecordingLocalCoordinates = 1 << 0,
+};
+
+// Bits of FLidarRecordingFrameHeader::Layout, for the arrays only some frames have
+enum ELidarRecordingLayout : uint32_t {
+    // Points come from a multi-return mode, and carry return indices in their flags
+    RecordingMultiReturn = 1 << 0,
+    // The InstanceId and ClassId arrays are there
+    RecordingLabeled = 1 << 1,
+};
+
+struct FLidarRecordingFileHeader {
+    static constexpr uint32_t ExpectedMagic = 0x4345524C;  // "LREC"
+    static constexpr uint32_t CurrentVersion = 1;
+
+    uint32_t Magic;
+    uint32_t Version;
+    // An ELidarRecordingFileFlags set
+    uint32_t Flags;
+    uint32_t NumBeams;
+    // Points per column, twice NumBeams in dual-return mode
+    uint32_t PointsPerColumn;
+    uint32_t ColumnsPerRevolution;
+    uint64_t Reserved;
+};
+static_assert(sizeof(FLidarRecordingFileHeader) == 32,
+              "FLidarRecordingFileHeader must be tightly packed");
+
+struct FLidarRecordingFrameHeader {
+    static constexpr uint32_t ExpectedMagic = 0x4652524C;  // "LRRF"
+
+    uint32_t Magic;
+    // An ELidarRecordingLayout set
+    uint32_t Layout;
+    // The frame's place in the recording, counting from 0
+    uint64_t Sequence;
+    // From the start of this header to the next chunk
+    uint64_t ChunkSize;
+    int32_t Revolution;
+    uint32_t NumPoints;
+    // When the first and last beams of the frame fired, in seconds
+    double StartTime;
+    double EndTime;
+    // The sensor's frame in world coordinates when the revolution's first column fired
+    FLidarRigidTransform SensorPose;
+    // Where each array starts, in bytes from the start of this header. The arrays the frame
+    // doesn't have are at 0.
+    uint32_t X, Y, Z, Range, Intensity, Time, Beam, Column, Flags, InstanceId, ClassId;
+    uint32_t Reserved;
+};
+static_assert(sizeof(FLidarRecordingFrameHeader) == 144,
+              "FLidarRecordingFrameHeader must be tightly packed");
+
+// One entry of the frame index for each frame, in the order they were written
+struct FLidarRecordingIndexEntry {
+    // From the start of the file to the frame's FLidarRecordingFrameHeader
+    uint64_t Offset;
+    int32_t Revolution;
+    uint32_t NumPoints;
+    double StartTime;
+};
+static_assert(sizeof(FLidarRecordingIndexEntry) == 24,
+              "FLidarRecordingIndexEntry must be tightly packed");
+
+// The last bytes of the file
+struct FLidarRecordingFooter {
+    static constexpr uint32_t ExpectedMagic = 0x5852524C;  // "LRRX"
+
+    uint64_t IndexOffset;
+    uint32_t NumFrames;
+    uint32_t Magic;
+};
+static_assert(sizeof(FLidarRecordingFooter) == 16,
+              "FLidarRecordingFooter must be tightly packed");
+
+/*Lays out the container around the revolutions it is given.
+ * Every byte of the file goes through the encoder, which keeps track of the file offsets
+ * for the frame index.*/
+class SPINNINGLIDARCORE_API FLidarRecordingEncoder {
+ public:
+    FLidarRecordingEncoder() = default;
+    FLidarRecordingEncoder(int32_t InNumBeams, int32_t InPointsPerColumn,
+                           int32_t InColumnsPerRevolution, bool bInLocalCoordinates);
+
+    // Start the file
+    void AppendFileHeader(FLidarByteSink &Out);
+
+    // Add a chunk with every point of a revolution, and index it
+    void AppendFrame(const FLidarPointCloud &Cloud, FLidarByteSink &Out);
+
+    // Finish the file with the frame index and footer. Nothing is appended after this.
+    void AppendIndex(FLidarByteSink &Out);
+
+ private:
+    uint8_t* Append(size_t Count, FLidarByteSink &Out);
+
+    FLidarRecordingFileHeader FileHeader = {};
+    std::vector<FLidarRecordingIndexEntry> Index;
+    // Bytes appended so far, which is where the next one goes in the file
+    uint64_t FileOffset = 0;
+};
+
+// A read-only mapping of a whole file
+class SPINNINGLIDARCORE_API FLidarMappedFile {
+ public:
+    FLidarMappedFile() = default;
+    FLidarMappedFile(const FLidarMappedFile &) = delete;
+    FLidarMappedFile &operator=(const FLidarMappedFile &) = delete;
+    ~FLidarMappedFile();
+
+    // Map the file. Returns false if it can't be opened or is empty.
+    bool Open(const char* Path);
+
+    void Close();
+
+    const uint8_t* GetData() const { return Data; }
+    size_t GetSize() const { return Size; }
+
+ private:
+    uint8_t* Data = nullptr;
+    size_t Size = 0;
+#if defined(_WIN32)
+    void* File = nullptr;
+    void* Mapping = nullptr;
+#endif
+};
+
+// A frame read in place in the mapped file, valid until its reader is closed
+struct FLidarRecordingFrameView {
+    const FLidarRecordingFrameHeader* Header = nullptr;
+    int32_t NumPoints = 0;
+    const float* X = nullptr;
+    const float* Y = nullptr;
+    const float* Z = nullptr;
+    const float* Range = nullptr;
+    const float* Intensity = nullptr;
+    const double* Time = nullptr;
+    const uint16_t* Beam = nullptr;
+    const uint16_t* Column = nullptr;
+    const uint8_t* Flags = nullptr;
+    // Null unless the frame is labeled
+    const uint32_t* InstanceId = nullptr;
+    const uint16_t* ClassId = nullptr;
+
+    bool HasReturn(int32_t Index) const {
+        return (Flags[Index] & FLidarPointCloud::PointReturned) != 0;
+    }
+};
+
+/*Reads a recording by mapping it, so a frame is found in constant time through the index
+ * and its points are read where they are, without copying. Only the pages of the frames
+ * read are ever loaded, however long the recording.*/
+class SPINNINGLIDARCORE_API FLidarRecordingReader {
+ public:
+    // Map a recording. Returns false if it can't be opened or isn't a recording.
+    bool Open(const char* Path);
+
+    void Close();
+
+    bool IsOpen() const { return FileHeader != nullptr; }
+
+    const FLidarRecordingFileHeader &GetFileHeader() const { return *FileHeader; }
+
+    int32_t GetNumFrames() const { return (int32_t)NumFrames; }
+
+    // Whether the recording had no index, so its frames were found by stepping through the
+    // chunks when it was opened
+    bool IsRecovered() const { return bRecovered; }
+
+    // View a frame in place. Returns false if there is no such frame, or its chunk is damaged.
+    bool GetFrame(int32_t FrameIndex, FLidarRecordingFrameView &OutView) const;
+
+    // The last frame that started at or before Time, or the first frame if none did.
+    // -1 if the recording has no frames.
+    int32_t FindFrame(double Time) const;
+
+    // Copy a frame into a cloud, for the serializers and other code that works on clouds.
+    // The incidence angles aren't recorded, and are left at 0.
+    bool ReadFrame(int32_t FrameIndex, FLidarPointCloud &OutCloud) const;
+
+ private:
+    // Step through the chunks from the start of the file, to index a recording that has none
+    void RecoverIndex();
+
+    FLidarMappedFile File;
+    const FLidarRecordingFileHeader* FileHeader = nullptr;
+    // The index in the file, or the one recovered from the chunks
+    const FLidarRecordingIndexEntry* Index = nullptr;
+    size_t NumFrames = 0;
+    std::vector<FLidarRecordingIndexEntry> RecoveredIndex;
+    bool bRecovered = false;
+};
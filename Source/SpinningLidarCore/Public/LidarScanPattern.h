@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCoreTypes.h"
+#include <vector>
+
+// The direction of one beam relative to the sensor head, in degrees
+struct FLidarBeamAngles {
+    // Positive is up
+    float Elevation;
+    // Added to the head's azimuth when the beam fires. Positive is clockwise seen from above.
+    float AzimuthOffset;
+};
+
+// A read-only list of beams, such as one of the built-in laser tables
+struct FLidarBeamTable {
+    const FLidarBeamAngles* Beams = nullptr;
+    int32_t Num = 0;
+};
+
+/*Laser tables of real sensors.
+ * The tables list the beams in the order the real sensor numbers its lasers,
+ * which is the order in which they appear in each column of the output.*/
+struct SPINNINGLIDARCORE_API FLidarBeamTables {
+    // Velodyne HDL-32E: 32 lasers from -30.67 to +10.67 degrees
+    static FLidarBeamTable VelodyneHDL32E();
+    // Velodyne VLP-16 (Puck): 16 lasers from -15 to +15 degrees
+    static FLidarBeamTable VelodyneVLP16();
+    // Ouster OS1-64: 64 lasers from -16.6 to +16.6 degrees, staggered in azimuth
+    static FLidarBeamTable OusterOS1_64();
+};
+
+/*The beams of one column of the scan, and the unit direction of each relative to the sensor
+ * head at zero azimuth. The directions are worked out once, so that firing a column only
+ * takes one rotation per beam.*/
+class SPINNINGLIDARCORE_API FLidarScanPattern {
+ public:
+    FLidarScanPattern() = default;
+
+    // The beams of a laser table, in table order
+    explicit FLidarScanPattern(const FLidarBeamTable &Table);
+
+    // NumBeams beams evenly spaced in elevation from MinElevation to MaxElevation.
+    // If there is only one beam, it is at the max elevation angle.
+    FLidarScanPattern(int32_t NumBeams, float MinElevation, float MaxElevation);
+
+    int32_t Num() const { return (int32_t)Beams.size(); }
+    const std::vector<FLidarBeamAngles> &GetBeams() const { return Beams; }
+    const std::vector<FLidarVector3> &GetDirections() const { return Directions; }
+    float GetMinElevation() const { return MinElevation; }
+    float GetMaxElevation() const { return MaxElevation; }
+
+    // The start of every beam in a column, BeamStartHeight along the head's z axis,
+    // and the end of each beam at Range
+    FLidarVector3 GetBeamStart(const FLidarRigidTransform &Head, float BeamStartHeight) const {
+        return Head.Origin + Head.AxisZ * BeamStartHeight;
+    }
+    FLidarVector3 GetBeamEnd(const FLidarRigidTransform &Head, const FLidarVector3 &BeamStart,
+                             int32_t Beam, float Range) const {
+        return BeamStart + Head.TransformVector(Directions[Beam]) * Range;
+    }
+
+ private:
+    void BuildDirections();
+
+    std::vector<FLidarBeamAngles> Beams;
+    std::vector<FLidarVector3> Directions;
+    float MinElevation = 0.f;
+    float MaxElevation = 0.f;
+};
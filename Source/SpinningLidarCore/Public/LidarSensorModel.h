@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCoreTypes.h"
+#include "LidarNoiseRng.h"
+#include "LidarPointCloud.h"
+
+// The parameters of the return model, with the same meaning and units as on the sensor actor
+struct FLidarSensorModelSettings {
+    // Max range of the raycast, in cm
+    float LidarRange = 10000.f;
+    // Range accuracy from the spec sheet, in cm
+    float RangeAccuracy = 2.f;
+    // Probability of no return for a hit at max range
+    float MaxRangeNoReturnProbability = 0.f;
+    // Standard deviation in cm of the falloff of the return probability towards max range
+    float FalloffStdDev = 0.f;
+    // How much the angle of incidence affects intensity, from 0 (not at all) to 1
+    float IntensityAffectedByAngle = 0.f;
+    // Seed and sensor id of the counter-based noise generator
+    uint32_t NoiseSeed = 0;
+    uint32_t SensorId = 0;
+};
+
+// A surface a beam reached, for working out how strong its return is
+struct FLidarBeamSurface {
+    FLidarVector3 ImpactPoint;
+    FLidarVector3 ImpactNormal;
+    // The fraction of the beam's energy that carries on through the surface, 0 if it's opaque
+    float Transmittance = 0.f;
+    // The fraction of the energy that reaches the surface and isn't let through that it
+    // reflects back
+    float Reflectivity = 1.f;
+};
+
+/*The lidar return model: how a traced beam becomes a point, whether its return is received,
+ * how much range noise it has, how bright it is and which frame it is written in.
+ * Every stage works on a span of points of one column in a FLidarPointCloud and draws its
+ * random numbers from the counter-based generator, so columns can be processed on any thread
+ * in any order with the same result.*/
+class SPINNINGLIDARCORE_API FLidarSensorModel {
+ public:
+    FLidarSensorModel() = default;
+    explicit FLidarSensorModel(const FLidarSensorModelSettings &InSettings);
+
+    const FLidarSensorModelSettings &GetSettings() const { return Settings; }
+
+    // Store a beam that hit a surface at ImpactPoint with the given normal
+    void StoreReturn(FLidarPointCloud &Cloud, int32_t PointIndex, const FLidarVector3 &BeamStart,
+                     const FLidarVector3 &ImpactPoint, const FLidarVector3 &ImpactNormal,
+                     float Distance) const;
+
+    // Store a beam that hit nothing before TraceEnd
+    void StoreMiss(FLidarPointCloud &Cloud, int32_t PointIndex,
+                   const FLidarVector3 &TraceEnd) const;
+
+    // Simulate the probability that there will be no return signal received for some hits,
+    // especially near max range. Returns the number of points in the span still returned.
+    int32_t ApplyDropout(FLidarPointCloud &Cloud, int32_t FirstPoint, int32_t NumPoints,
+                         uint32_t Revolution, uint32_t Column) const;
+
+    // Add Gaussian range noise based on angle of incidence to every return in the span
+    void ApplyRangeNoise(FLidarPointCloud &Cloud, int32_t FirstPoint, int32_t NumPoints,
+                         const FLidarVector3 &BeamStart, uint32_t Revolution,
+                         uint32_t Column) const;
+
+    // Scale the base intensity stored with each return in the span by its angle of incidence
+    void ApplyIntensity(FLidarPointCloud &Cloud, int32_t FirstPoint, int32_t NumPoints) const;
+
+    // Move the points of a span into the frame they are written in: the sensor frame if
+    // bLocalCoordinates, otherwise world coordinates. Points with no return become 0, 0, 0.
+    static void TransformToOutputFrame(FLidarPointCloud &Cloud, int32_t FirstPoint,
+                                       int32_t NumPoints, const FLidarRigidTransform &Sensor,
+                                       bool bLocalCoordinates);
+
+    // The relative strength of the return from each of NumSurfaces surfaces along one beam,
+    // in the order the beam reached them. Each surface reflects the part of the beam's
+    // energy that it doesn't let through, times its reflectivity, scaled by the angle of
+    // incidence like intensity.
+    void GetReturnStrengths(const FLidarBeamSurface* Surfaces, int32_t NumSurfaces,
+                            const FLidarVector3 &BeamStart, float* OutStrengths) const;
+
+    // The probability that a hit at Range is not received
+    float GetNoReturnProbability(float Range) const;
+
+    // The standard deviation of the range noise for a hit with the given angle of incidence
+    float GetRangeNoiseStdDev(float CosIncidence) const;
+
+    // Intensity from 0 to 255 of a return from a surface of the given base intensity,
+    // brightest when the beam is perpendicular to the surface
+    float GetIntensity(float BaseIntensity, float CosIncidence) const {
+        return BaseIntensity * (Settings.IntensityAffectedByAngle * CosIncidence +
+                                (1.f - Settings.IntensityAffectedByAngle));
+    }
+
+ private:
+    FLidarSensorModelSettings Settings;
+    FLidarNoiseRng NoiseRng;
+};
@@ -0,0 +1,169 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarPointCloud.h"
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+/*Revolutions handed to other processes on the same host through a shared-memory ring.
+ *
+ * The segment starts with a FLidarShmRingHeader, followed by NumSlots slots of SlotStride
+ * bytes. Each slot is a FLidarShmSlotHeader followed by the point arrays of one revolution,
+ * in the same structure-of-arrays layout as FLidarPointCloud, each array 64-byte aligned.
+ * The writer copies each revolution's arrays into the next slot in turn. Nothing is
+ * serialized, and readers read the arrays in place.
+ *
+ * There are no locks. Each slot is guarded by a sequence lock: the writer makes the slot's
+ * Lock odd while it writes and even again when it is done, so a reader that sees the same
+ * even Lock before and after reading knows nothing changed underneath it. A reader that is
+ * too slow gets a torn read reported and moves on to the latest revolution, and can never
+ * hold up the writer or the other readers.
+ *
+ * The segment is a POSIX shared-memory object (shm_open) on Linux and Mac, and a named file
+ * mapping on Windows.*/
+
+// At the very start of the segment
+struct FLidarShmRingHeader {
+    static constexpr uint32_t ExpectedMagic = 0x5344494C;  // "LIDS"
+    static constexpr uint32_t CurrentVersion = 1;
+
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t NumSlots;
+    // The most points a slot holds
+    uint32_t SlotCapacity;
+    uint64_t SlotStride;
+    // The sequence number of the latest revolution published, counting from 1, or 0 before
+    // the first. Its slot is (LatestSequence - 1) % NumSlots.
+    std::atomic<uint64_t> LatestSequence;
+};
+
+// At the start of each slot
+struct FLidarShmSlotHeader {
+    // 2 * Sequence once the slot holds a complete revolution, odd while it is being written
+    std::atomic<uint64_t> Lock;
+    uint64_t Sequence;
+    int32_t Revolution;
+    int32_t NumPoints;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "The shared-memory ring needs lock-free 64-bit atomics");
+
+// Where each array of a slot starts, in bytes from the start of the slot
+struct SPINNINGLIDARCORE_API FLidarShmSlotLayout {
+    size_t X, Y, Z, Range, Intensity, Time, Beam, Column, Flags;
+    size_t Stride;
+
+    static FLidarShmSlotLayout Make(uint32_t SlotCapacity);
+};
+
+// A revolution read in place in the segment. The arrays are only safe to use while
+// FLidarShmRingReader::IsValid says the slot hasn't been rewritten since.
+struct FLidarShmRevolutionView {
+    uint64_t Sequence = 0;
+    int32_t Revolution = 0;
+    int32_t NumPoints = 0;
+    const float* X = nullptr;
+    const float* Y = nullptr;
+    const float* Z = nullptr;
+    const float* Range = nullptr;
+    const float* Intensity = nullptr;
+    const double* Time = nullptr;
+    const uint16_t* Beam = nullptr;
+    const uint16_t* Column = nullptr;
+    const uint8_t* Flags = nullptr;
+
+    bool HasReturn(int32_t Index) const {
+        return (Flags[Index] & FLidarPointCloud::PointReturned) != 0;
+    }
+
+ private:
+    friend class FLidarShmRingReader;
+    const FLidarShmSlotHeader* Slot = nullptr;
+    uint64_t Lock = 0;
+};
+
+// A mapping of a named shared-memory segment
+class SPINNINGLIDARCORE_API FLidarSharedMemory {
+ public:
+    FLidarSharedMemory() = default;
+    FLidarSharedMemory(const FLidarSharedMemory &) = delete;
+    FLidarSharedMemory &operator=(const FLidarSharedMemory &) = delete;
+    ~FLidarSharedMemory();
+
+    // Create the segment, replacing any left over with the same name, and map it read-write
+    bool Create(const char* Name, size_t Size);
+
+    // Map an existing segment read-only
+    bool Open(const char* Name);
+
+    // Unmap the segment, and remove its name if this mapping created it.
+    // Readers that still have it mapped keep their mapping.
+    void Close();
+
+    uint8_t* GetData() const { return Data; }
+    size_t GetSize() const { return Size; }
+
+ private:
+    uint8_t* Data = nullptr;
+    size_t Size = 0;
+    bool bOwner = false;
+    std::string SegmentName;
+#if defined(_WIN32)
+    void* Mapping = nullptr;
+#endif
+};
+
+// The sensor's side of the ring. Publish is called from one thread only.
+class SPINNINGLIDARCORE_API FLidarShmRingWriter {
+ public:
+    // Create the segment with room for NumSlots revolutions of up to SlotCapacity points each
+    bool Create(const char* Name, uint32_t NumSlots, uint32_t SlotCapacity);
+
+    void Close();
+
+    bool IsOpen() const { return Header != nullptr; }
+
+    // Copy the cloud's points into the next slot and make it the latest revolution.
+    // Points beyond SlotCapacity are left out.
+    void Publish(const FLidarPointCloud &Cloud);
+
+ private:
+    FLidarSharedMemory Memory;
+    FLidarShmRingHeader* Header = nullptr;
+    FLidarShmSlotLayout Layout;
+};
+
+// A consumer's side of the ring. Any number of readers, in any number of processes.
+class SPINNINGLIDARCORE_API FLidarShmRingReader {
+ public:
+    // Map the ring a writer created. Returns false if it doesn't exist or isn't a ring.
+    bool Open(const char* Name);
+
+    void Close();
+
+    bool IsOpen() const { return Header != nullptr; }
+
+    // The sequence number of the latest revolution, to poll for new ones. 0 before the first.
+    uint64_t GetLatestSequence() const;
+
+    // View the latest revolution in place, without copying. Returns false if there is none
+    // yet, or the writer was in the middle of rewriting it, in which case try again.
+    // Check IsValid after reading the arrays, and discard what was read if it fails.
+    bool AcquireLatest(FLidarShmRevolutionView &OutView) const;
+
+    // Whether the view's slot is unchanged since AcquireLatest, so that what was read is
+    // the whole revolution and not a mix with the next one
+    bool IsValid(const FLidarShmRevolutionView &View) const;
+
+    // Copy the latest revolution into a cloud, retrying while the writer gets in the way.
+    // Returns false if there is no revolution yet.
+    bool ReadLatest(FLidarPointCloud &OutCloud, uint64_t &OutSequence) const;
+
+ private:
+    FLidarSharedMemory Memory;
+    const FLidarShmRingHeader* Header = nullptr;
+    FLidarShmSlotLayout Layout;
+};
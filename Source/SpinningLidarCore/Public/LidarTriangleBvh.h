@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCoreTypes.h"
+#include <vector>
+
+// The result of tracing one beam against a FLidarTriangleBvh
+struct FLidarBvhHit {
+    bool bBlockingHit = false;
+    // Distance in cm from the start of the beam to the impact point
+    float Distance = 0.f;
+    FLidarVector3 ImpactPoint;
+    // The normal of the hit triangle, facing back along the beam
+    FLidarVector3 ImpactNormal;
+    // The object the hit triangle came from, as given to AddMesh
+    int32_t ObjectIndex = -1;
+};
+
+/*A bounding volume hierarchy over a static triangle soup, for tracing beams without going
+ * through the physics engine.
+ * Meshes are added in world space and the tree is built once with a binned surface area
+ * heuristic. The nodes are a flat 32-byte array with both children of a node next to each
+ * other, and the triangles are stored in leaf order as a vertex and two edges, so traversal
+ * walks memory mostly forwards.
+ * Triangles are two-sided, as complex collision is for line traces.
+ * TraceFan traces the beams of a column together. They all start at the same point, so each
+ * group of four shares the node tests and the ray-independent half of the triangle test,
+ * which runs four beams at a time with SSE where the compiler targets it.*/
+class SPINNINGLIDARCORE_API FLidarTriangleBvh {
+ public:
+    // Add NumTriangles triangles, three indices into Vertices each, tagged with ObjectIndex.
+    // Build must be called again afterwards.
+    void AddMesh(const FLidarVector3* Vertices, const uint32_t* Indices, int32_t NumTriangles,
+                 int32_t ObjectIndex);
+
+    // Build the tree over every triangle added so far
+    void Build();
+
+    // Forget every triangle
+    void Reset();
+
+    int32_t GetNumTriangles() const { return (int32_t)Triangles.size(); }
+    int32_t GetNumNodes() const { return (int32_t)Nodes.size(); }
+
+    // The first triangle along the beam from Start to End
+    FLidarBvhHit Trace(const FLidarVector3 &Start, const FLidarVector3 &End) const;
+
+    // Trace NumRays beams from the same Start to each of Ends, four at a time
+    void TraceFan(const FLidarVector3 &Start, const FLidarVector3* Ends, int32_t NumRays,
+                  FLidarBvhHit* OutHits) const;
+
+ private:
+    // A node's children are at FirstIndex and FirstIndex + 1 if NumTriangles is 0,
+    // otherwise it is a leaf with NumTriangles triangles from FirstIndex
+    struct FNode {
+        float Min[3];
+        uint32_t FirstIndex;
+        float Max[3];
+        uint32_t NumTriangles;
+    };
+
+    struct FTriangle {
+        FLidarVector3 Vertex;
+        FLidarVector3 Edge1;
+        FLidarVector3 Edge2;
+    };
+
+    // Trace up to four beams of a fan through the tree
+    void TracePacket(const FLidarVector3 &Start, const FLidarVector3* Ends, int32_t NumRays,
+                     FLidarBvhHit* OutHits) const;
+
+    // Fill in a hit on a triangle from the distance along the beam
+    void MakeHit(const FLidarVector3 &Start, const FLidarVector3 &Direction, float Distance,
+                 int32_t Triangle, FLidarBvhHit &OutHit) const;
+
+    std::vector<FNode> Nodes;
+    std::vector<FTriangle> Triangles;
+    std::vector<FLidarVector3> Normals;
+    std::vector<int32_t> ObjectIndices;
+};
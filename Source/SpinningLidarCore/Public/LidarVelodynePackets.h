@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "LidarCloudSerializers.h"
+#include "LidarPointCloud.h"
+
+/*Packs columns of the point cloud into Velodyne HDL-32E data packets, as captured in a pcap.
+ * Each 1206-byte packet holds 12 firing blocks, one per column, each with the 0xFFEE block
+ * header, the azimuth in hundredths of a degree and 32 channel records of distance in 2 mm
+ * units and reflectivity, followed by the GPS timestamp in microseconds past the hour and the
+ * return mode and product id bytes. Distance 0 means no return.
+ * The packet is built in place inside a preallocated pcap record, with the pcap record header,
+ * Ethernet, IPv4 and UDP headers filled in once, so emitting a packet only touches the
+ * payload, the timestamps and the IP checksum. Records are meant to follow the pcap file
+ * header from AppendPcapFileHeader.*/
+class SPINNINGLIDARCORE_API FLidarVelodynePacketEncoder {
+ public:
+    static constexpr int32_t BlocksPerPacket = 12;
+    static constexpr int32_t ChannelsPerBlock = 32;
+    static constexpr int32_t BlockSize = 4 + ChannelsPerBlock * 3;
+    static constexpr int32_t PayloadSize = BlocksPerPacket * BlockSize + 6;
+    static constexpr int32_t PcapFileHeaderSize = 24;
+    static constexpr int32_t PcapRecordHeaderSize = 16;
+    static constexpr int32_t FrameSize = 14 + 20 + 8 + PayloadSize;
+    static constexpr int32_t PcapRecordSize = PcapRecordHeaderSize + FrameSize;
+    // The port the sensor sends data packets to
+    static constexpr uint16_t DataPort = 2368;
+
+    FLidarVelodynePacketEncoder();
+
+    // The pcap file header for a capture of Ethernet frames
+    static void AppendPcapFileHeader(FLidarByteSink &Out);
+
+    // Pack one column as the next firing block. Channels past the first 32 points are dropped,
+    // and missing channels are written as no return.
+    // Returns true if this filled a packet, which is then available from GetPayload and
+    // GetPcapRecord until the next call.
+    bool AddColumn(const FLidarPointCloud &Cloud, int32_t FirstPoint, int32_t NumPoints,
+                   float AzimuthDegrees);
+
+    // Complete a partly filled packet, repeating the last azimuth with no returns in the
+    // unused blocks. Returns false if there was no partial packet.
+    bool Flush();
+
+    // The UDP payload of the last completed packet
+    const uint8_t* GetPayload() const { return Record + PcapRecordSize - PayloadSize; }
+
+    // The last completed packet with its pcap record header and UDP/IP/Ethernet framing
+    const uint8_t* GetPcapRecord() const { return Record; }
+
+ private:
+    // Fill in the headers and timestamps of a full packet
+    void FinishPacket();
+
+    uint8_t Record[PcapRecordSize];
+    int32_t NumBlocks = 0;
+    uint16_t LastAzimuth = 0;
+    uint16_t IpIdentification = 0;
+    // Time in seconds of the first firing block of the packet being filled
+    double PacketTime = 0.0;
+};
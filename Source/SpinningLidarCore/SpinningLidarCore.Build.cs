@@ -0,0 +1,21 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+using UnrealBuildTool;
+
+// The engine-independent lidar sensor model. Apart from the module boilerplate it uses only the
+// C++17 standard library, so that it also builds on its own with the CMakeLists.txt at the
+// root of the plugin.
+public class SpinningLidarCore : ModuleRules
+{
+	public SpinningLidarCore(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+		CppStandard = CppStandardVersion.Cpp17;
+
+		PublicDependencyModuleNames.AddRange(
+			new string[]
+			{
+				"Core",
+			}
+			);
+	}
+}
@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarBatchCommandlet.h"
+#include "SpinningLidarSensorActor.h"
+#include "SpinningLidarStats.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Containers/Ticker.h"
+#include "EngineUtils.h"
+#include "HAL/FileManager.h"
+#include "Misc/App.h"
+#include "Misc/PackageName.h"
+
+namespace {
+
+// The total size of the files under Directory
+int64 GetDirectorySize(const FString &Directory) {
+    TArray<FString> Files;
+    IFileManager::Get().FindFilesRecursive(Files, *Directory, TEXT("*"), true, false);
+    int64 Size = 0;
+    for (const FString &File : Files) {
+        Size += FMath::Max<int64>(0, IFileManager::Get().FileSize(*File));
+    }
+    return Size;
+}
+
+}  // namespace
+
+#ifdef ConfigurationPluginIncluded
+FLidarReadScenarioFile ULidarBatchCommandlet::ReadScenarioFile;
+#endif
+
+ULidarBatchCommandlet::ULidarBatchCommandlet() {
+    IsClient = false;
+    IsServer = false;
+    LogToConsole = true;
+}
+
+int32 ULidarBatchCommandlet::Main(const FString &Params) {
+    FString MapName;
+    if (!FParse::Value(*Params, TEXT("Map="), MapName)) {
+        UE_LOG(LogSpinningLidar, Error, TEXT("Usage: -run=LidarBatch -Map=<map> "
+               "[-Scenarios=<a.yaml,b.yaml>] [-Seconds=60] [-Fps=20] [-OutputDir=<dir>]"));
+        return 1;
+    }
+
+    // The scenarios to run in sequence, or a single run of the sensors placed in the map
+    TArray<FString> ScenarioFiles;
+    FString ScenariosParam;
+    if (FParse::Value(*Params, TEXT("Scenarios="), ScenariosParam, false)) {
+        ScenariosParam.ParseIntoArray(ScenarioFiles, TEXT(","));
+    }
+#ifdef ConfigurationPluginIncluded
+    if (ScenarioFiles.Num() > 0 && !ReadScenarioFile.IsBound()) {
+        UE_LOG(LogSpinningLidar, Error, TEXT("-Scenarios needs "
+               "ULidarBatchCommandlet::ReadScenarioFile to be bound by the project"));
+        return 1;
+    }
+#else
+    if (ScenarioFiles.Num() > 0) {
+        UE_LOG(LogSpinningLidar, Error, TEXT("-Scenarios needs the ConfigurationPlugin"));
+        return 1;
+    }
+#endif
+    if (ScenarioFiles.Num() == 0) ScenarioFiles.Add(FString());
+
+    float Seconds = 60.f;
+    float Fps = 20.f;
+    FParse::Value(*Params, TEXT("Seconds="), Seconds);
+    FParse::Value(*Params, TEXT("Fps="), Fps);
+    if (Seconds <= 0.f || Fps <= 0.f) {
+        UE_LOG(LogSpinningLidar, Error, TEXT("-Seconds and -Fps must be positive"));
+        return 1;
+    }
+    const float DeltaSeconds = 1.f / Fps;
+    const int32 NumFrames = FMath::CeilToInt(Seconds * Fps);
+
+    FString OutputDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("LidarBatch"));
+    FParse::Value(*Params, TEXT("OutputDir="), OutputDir);
+
+    // Every frame advances the simulation by the same step, however long it took to compute
+    FApp::SetUseFixedTimeStep(true);
+    FApp::SetFixedDeltaTime(DeltaSeconds);
+
+    FScenarioResult Total;
+    Total.Name = TEXT("Total");
+    int32 NumFailed = 0;
+    for (const FString &ScenarioFile : ScenarioFiles) {
+        FScenarioResult Result;
+        Result.Name = ScenarioFile.IsEmpty() ? FPackageName::GetShortName(MapName)
+                                             : FPaths::GetBaseFilename(ScenarioFile);
+        const FString ScenarioOutputDir = FPaths::Combine(OutputDir, Result.Name);
+        if (!RunScenario(MapName, ScenarioFile, ScenarioOutputDir, DeltaSeconds, NumFrames,
+                         Result)) {
+            ++NumFailed;
+            continue;
+        }
+        LogResult(Result);
+
+        Total.NumSensors += Result.NumSensors;
+        Total.NumFrames += Result.NumFrames;
+        Total.SimSeconds += Result.SimSeconds;
+        Total.WallSeconds += Result.WallSeconds;
+        Total.Rays += Result.Rays;
+        Total.Hits += Result.Hits;
+        Total.Revolutions += Result.Revolutions;
+        Total.BytesWritten += Result.BytesWritten;
+    }
+
+    UE_LOG(LogSpinningLidar, Display, TEXT("%d of %d scenarios completed"),
+           ScenarioFiles.Num() - NumFailed, ScenarioFiles.Num());
+    LogResult(Total);
+    return NumFailed > 0 ? 1 : 0;
+}
+
+bool ULidarBatchCommandlet::RunScenario(const FString &MapName, const FString &ScenarioFile,
+                                        const FString &ScenarioOutputDir, float DeltaSeconds,
+                                        int32 NumFrames, FScenarioResult &Result) {
+    UPackage* MapPackage = LoadPackage(nullptr, *MapName, LOAD_None);
+    UWorld* World = MapPackage ? UWorld::FindWorldInPackage(MapPackage) : nullptr;
+    if (!World) {
+        UE_LOG(LogSpinningLidar, Error, TEXT("Could not load map %s"), *MapName);
+        return false;
+    }
+
+    World->WorldType = EWorldType::Game;
+    World->AddToRoot();
+    FWorldContext &WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+    WorldContext.SetCurrentWorld(World);
+    World->InitWorld(UWorld::InitializationValues()
+                             .AllowAudioPlayback(false)
+                             .RequiresHitProxies(false)
+                             .CreateNavigation(false)
+                             .CreateAISystem(false)
+                             .ShouldSimulatePhysics(true)
+                             .SetTransactional(false));
+    World->UpdateWorldComponents(true, false);
+
+    bool bSpawned = true;
+#ifdef ConfigurationPluginIncluded
+    if (!ScenarioFile.IsEmpty()) bSpawned = SpawnScenarioSensor(World, ScenarioFile);
+#endif
+
+    // Redirect the outputs before the sensors open them in BeginPlay
+    IFileManager::Get().MakeDirectory(*ScenarioOutputDir, true);
+    const int64 StartBytes = GetDirectorySize(ScenarioOutputDir);
+    TArray<ASpinningLidarSensorActor*> Sensors;
+    for (TActorIterator<ASpinningLidarSensorActor> It(World); It; ++It) {
+        It->SetSaveDirectory(ScenarioOutputDir);
+        Sensors.Add(*It);
+    }
+    if (bSpawned && Sensors.Num() == 0) {
+        UE_LOG(LogSpinningLidar, Warning, TEXT("%s has no lidar sensors"), *Result.Name);
+    }
+
+    const double StartSeconds = FPlatformTime::Seconds();
+    if (bSpawned) {
+        // There is no game mode or player, the actors just begin play
+        FURL URL;
+        World->InitializeActorsForPlay(URL);
+        World->GetWorldSettings()->NotifyBeginPlay();
+
+        for (int32 Frame = 0; Frame < NumFrames; ++Frame) {
+            FApp::SetDeltaTime(DeltaSeconds);
+            FApp::SetCurrentTime(FApp::GetCurrentTime() + DeltaSeconds);
+            World->Tick(LEVELTICK_All, DeltaSeconds);
+            FTicker::GetCoreTicker().Tick(DeltaSeconds);
+            FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+            ++GFrameCounter;
+        }
+
+        for (ASpinningLidarSensorActor* Sensor : Sensors) {
+            Result.Rays += Sensor->GetTotalRays();
+            Result.Hits += Sensor->GetTotalHits();
+            Result.Revolutions += Sensor->GetLatestRevolutionIndex() + 1;
+        }
+        Result.NumSensors = Sensors.Num();
+        Result.NumFrames = NumFrames;
+        Result.SimSeconds = NumFrames * (double)DeltaSeconds;
+
+        // Ending play flushes the sensors' writers, which is part of the time taken
+        for (FActorIterator It(World); It; ++It) {
+            It->RouteEndPlay(EEndPlayReason::Quit);
+        }
+    }
+    Result.WallSeconds = FPlatformTime::Seconds() - StartSeconds;
+
+    GEngine->DestroyWorldContext(World);
+    World->DestroyWorld(false);
+    World->RemoveFromRoot();
+    CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+    Result.BytesWritten = GetDirectorySize(ScenarioOutputDir) - StartBytes;
+    return bSpawned;
+}
+
+#ifdef ConfigurationPluginIncluded
+bool ULidarBatchCommandlet::SpawnScenarioSensor(UWorld* World, const FString &ScenarioFile) {
+    FString Error;
+    UDocumentNode* Document = ReadScenarioFile.Execute(ScenarioFile, Error);
+    UDocumentNode* SpinningLidarNode;
+    if (!Document) {
+        if (Error.IsEmpty()) Error = TEXT("could not be read");
+    } else if (!Document->TryGetMapField("spinning-lidar", SpinningLidarNode)) {
+        Error += UDocumentNode::MissingRequiredFieldError("spinning-lidar");
+    } else {
+        ASpinningLidarSensorPlugin::SpawnSpinningLidarsFromYAML(World, SpinningLidarNode,
+                                                                nullptr, &Error);
+    }
+
+    if (!Error.IsEmpty()) {
+        UE_LOG(LogSpinningLidar, Error, TEXT("Scenario %s: %s"), *ScenarioFile, *Error);
+        return false;
+    }
+    return true;
+}
+#endif
+
+void ULidarBatchCommandlet::LogResult(const FScenarioResult &Result) const {
+    const double WallSeconds = FMath::Max(Result.WallSeconds, 1e-6);
+    UE_LOG(LogSpinningLidar, Display,
+           TEXT("%s: %d sensors, %d frames, %.1f s simulated in %.1f s (%.2fx realtime), "
+                "%lld revolutions, %lld rays (%.0f rays/s), %lld hits, %.1f MB written"),
+           *Result.Name, Result.NumSensors, Result.NumFrames, Result.SimSeconds,
+           Result.WallSeconds, Result.SimSeconds / WallSeconds, Result.Revolutions, Result.Rays,
+           Result.Rays / WallSeconds, Result.Hits, Result.BytesWritten / (1024.0 * 1024.0));
+}
@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarOutputWriter.h"
+#include "SpinningLidarStats.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+
+FLidarOutputWriter::FLidarOutputWriter(int32 QueueCapacity,
+                                       ELidarWriterBackpressure InBackpressure,
+                                       int32 InWriteBufferBytes)
+    : Queue(QueueCapacity),
+      FreeBuffers(QueueCapacity),
+      Backpressure(InBackpressure),
+      WriteBufferBytes(InWriteBufferBytes) {
+}
+
+FLidarOutputWriter::~FLidarOutputWriter() {
+    Close();
+}
+
+bool FLidarOutputWriter::Open(const FString &FilePath, bool bAppend) {
+    Close();
+
+    if (!FilePath.IsEmpty()) {
+        IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+        FileHandle = PlatformFile.OpenWrite(*FilePath, bAppend);
+        if (!FileHandle) return false;
+    }
+
+    StagingBuffer.Reset(WriteBufferBytes);
+    bStopRequested = false;
+    bFlushRequested = false;
+    WorkEvent = FPlatformProcess::GetSynchEventFromPool(false);
+    Thread = FRunnableThread::Create(this, TEXT("LidarOutputWriter"), 0, TPri_BelowNormal);
+    return true;
+}
+
+void FLidarOutputWriter::Close() {
+    if (Thread) {
+        // Whatever is still waiting on the game thread has to go through the queue first
+        while (Backlog.Num() > 0) {
+            DrainBacklog();
+            WorkEvent->Trigger();
+            FPlatformProcess::Sleep(0.f);
+        }
+
+        // The writer thread drains the queue and flushes the file before it exits
+        bStopRequested = true;
+        WorkEvent->Trigger();
+        Thread->WaitForCompletion();
+        delete Thread;
+        Thread = nullptr;
+
+        FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+        WorkEvent = nullptr;
+    }
+
+    if (FileHandle) {
+        delete FileHandle;
+        FileHandle = nullptr;
+    }
+}
+
+TArray<uint8> FLidarOutputWriter::AcquireBuffer() {
+    TArray<uint8> Buffer;
+    FreeBuffers.TryPop(Buffer);
+    Buffer.Reset();
+    return Buffer;
+}
+
+void FLidarOutputWriter::Submit(TArray<uint8> &&Buffer, const FString &NewFilePath) {
+    if (!Thread || (Buffer.Num() == 0 && NewFilePath.IsEmpty())) return;
+
+    FWriteBatch Batch;
+    Batch.Bytes = MoveTemp(Buffer);
+    Batch.NewFilePath = NewFilePath;
+
+    // Keep batches in order: anything already in the backlog has to be queued first
+    DrainBacklog();
+
+    if (Backlog.Num() > 0 || !Queue.TryPush(Batch)) {
+        switch (Backpressure) {
+        case ELidarWriterBackpressure::Block:
+            while (!Queue.TryPush(Batch)) {
+                WorkEvent->Trigger();
+                FPlatformProcess::Sleep(0.f);
+            }
+            break;
+        case ELidarWriterBackpressure::DropOldest:
+            // The backlog is allowed to hold as many batches as the queue itself
+            if (Backlog.Num() >= Queue.Capacity()) {
+                Backlog.RemoveAt(0, 1, false);
+                BatchesDropped++;
+            }
+            Backlog.Emplace(MoveTemp(Batch));
+            break;
+        case ELidarWriterBackpressure::Grow:
+            Backlog.Emplace(MoveTemp(Batch));
+            break;
+        }
+    }
+
+    PeakQueueDepth = FMath::Max(PeakQueueDepth, GetQueueDepth());
+    WorkEvent->Trigger();
+}
+
+void FLidarOutputWriter::Flush() {
+    if (!Thread) return;
+    DrainBacklog();
+    bFlushRequested = true;
+    WorkEvent->Trigger();
+}
+
+void FLidarOutputWriter::DrainBacklog() {
+    int32 NumQueued = 0;
+    while (NumQueued < Backlog.Num() && Queue.TryPush(Backlog[NumQueued])) {
+        NumQueued++;
+    }
+    if (NumQueued > 0) Backlog.RemoveAt(0, NumQueued, false);
+}
+
+uint32 FLidarOutputWriter::Run() {
+    FWriteBatch Batch;
+    while (true) {
+        // Checked before draining, so that every batch submitted before Close is written
+        const bool bStopping = bStopRequested;
+
+        while (Queue.TryPop(Batch)) {
+            if (!Batch.NewFilePath.IsEmpty()) SwitchFile(Batch.NewFilePath);
+
+            TArray<uint8> &Bytes = Batch.Bytes;
+            if (StagingBuffer.Num() + Bytes.Num() > WriteBufferBytes) WriteStagingBuffer();
+
+            // Batches at least as large as the staging buffer are written without a copy
+            if (Bytes.Num() >= WriteBufferBytes) {
+                WriteBytes(Bytes.GetData(), Bytes.Num());
+            } else {
+                StagingBuffer.Append(Bytes);
+            }
+
+            // Send the emptied buffer back to the game thread. If the free list is full,
+            // the buffer is simply released.
+            Bytes.Reset();
+            FreeBuffers.TryPush(Bytes);
+            Bytes.Empty();
+        }
+
+        if (bStopping) break;
+
+        if (bFlushRequested.exchange(false)) {
+            WriteStagingBuffer();
+            if (FileHandle) FileHandle->Flush();
+        }
+
+        WorkEvent->Wait(100);
+    }
+
+    WriteStagingBuffer();
+    if (FileHandle) FileHandle->Flush();
+    return 0;
+}
+
+void FLidarOutputWriter::Stop() {
+    bStopRequested = true;
+    if (WorkEvent) WorkEvent->Trigger();
+}
+
+void FLidarOutputWriter::WriteStagingBuffer() {
+    WriteBytes(StagingBuffer.GetData(), StagingBuffer.Num());
+    StagingBuffer.Reset();
+}
+
+// Writer thread only: finish the current file and start writing to a new one
+void FLidarOutputWriter::SwitchFile(const FString &FilePath) {
+    WriteStagingBuffer();
+    delete FileHandle;
+
+    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+    FileHandle = PlatformFile.OpenWrite(*FilePath, false);
+}
+
+void FLidarOutputWriter::WriteBytes(const uint8 *Data, int64 NumBytes) {
+    // Bytes for a file that could not be opened are discarded
+    if (NumBytes <= 0 || !FileHandle) return;
+    LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarFileIO);
+    if (FileHandle->Write(Data, NumBytes)) {
+        BytesWritten.fetch_add(NumBytes, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarPointCloudFormats.h"
+
+void FLidarPointCloudFormats::AppendRevolutionFile(ELidarOutputFormat Format,
+                                                   const FLidarPointCloud &Cloud,
+                                                   TArray<uint8> &OutBytes) {
+    FLidarTArrayByteSink Sink(OutBytes);
+    switch (Format) {
+    case ELidarOutputFormat::PCDBinary:
+        FLidarCloudSerializers::AppendPcdBinary(Cloud, Sink);
+        break;
+    case ELidarOutputFormat::PLYBinary:
+        FLidarCloudSerializers::AppendPlyBinary(Cloud, Sink);
+        break;
+    case ELidarOutputFormat::KITTIBin:
+        FLidarCloudSerializers::AppendKittiBin(Cloud, Sink);
+        break;
+    default:
+        break;
+    }
+}
+
+bool FLidarPointCloudFormats::IsPerRevolution(ELidarOutputFormat Format) {
+    return Format == ELidarOutputFormat::PCDBinary || Format == ELidarOutputFormat::PLYBinary ||
+           Format == ELidarOutputFormat::KITTIBin;
+}
+
+bool FLidarPointCloudFormats::HasFrameIndex(ELidarOutputFormat Format) {
+    return Format == ELidarOutputFormat::RangeImage || Format == ELidarOutputFormat::Recording;
+}
+
+const TCHAR* FLidarPointCloudFormats::GetFileExtension(ELidarOutputFormat Format) {
+    switch (Format) {
+    case ELidarOutputFormat::PCDBinary: return TEXT(".pcd");
+    case ELidarOutputFormat::PLYBinary: return TEXT(".ply");
+    case ELidarOutputFormat::KITTIBin: return TEXT(".bin");
+    case ELidarOutputFormat::VelodynePcap: return TEXT(".pcap");
+    case ELidarOutputFormat::RangeImage: return TEXT(".lri");
+    case ELidarOutputFormat::Recording: return TEXT(".lrec");
+    default: return TEXT(".csv");
+    }
+}
@@ -0,0 +1,299 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarScanManager.h"
+#include "SpinningLidarSensorActor.h"
+#include "SpinningLidarStats.h"
+#include "LidarCoreConversions.h"
+#include "Async/ParallelFor.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "EngineUtils.h"
+#include "Interfaces/Interface_CollisionDataProvider.h"
+#include "Kismet/GameplayStatics.h"
+#include "Materials/MaterialInterface.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "PhysicsEngine/BodySetup.h"
+
+namespace {
+
+// How a line trace of the lidar beams' channel responds to the component: ECR_Block if it
+// stops there, ECR_Overlap if a multi-hit trace reports it and carries on, else ECR_Ignore
+ECollisionResponse GetLidarBeamResponse(const UPrimitiveComponent* Component) {
+    if (!Component || !Component->IsRegistered() ||
+        !CollisionEnabledHasQuery(Component->GetCollisionEnabled())) {
+        return ECR_Ignore;
+    }
+    return Component->GetCollisionResponseToChannel(ECC_Visibility);
+}
+
+}  // namespace
+
+ALidarScanManager::ALidarScanManager() {
+    PrimaryActorTick.bCanEverTick = true;
+    // Sensors are usually attached to vehicles, so scan from where physics has left them
+    PrimaryActorTick.TickGroup = TG_PostPhysics;
+}
+
+ALidarScanManager* ALidarScanManager::Get(UWorld* World) {
+    if (!World) return nullptr;
+    for (TActorIterator<ALidarScanManager> It(World); It; ++It) {
+        return *It;
+    }
+    FActorSpawnParameters SpawnParameters;
+    SpawnParameters.Name = TEXT("LidarScanManager");
+    SpawnParameters.SpawnCollisionHandlingOverride =
+            ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+    return World->SpawnActor<ALidarScanManager>(SpawnParameters);
+}
+
+void ALidarScanManager::RegisterSensor(ASpinningLidarSensorActor* Sensor) {
+    Sensors.AddUnique(Sensor);
+    if (!Sensor->bSubStepScan) ApplyClockSettings(Sensor);
+    if (Sensor->TraceMode == ELidarTraceMode::StaticSnapshot && !bStaticSceneBuilt) {
+        BuildStaticScene();
+    }
+}
+
+void ALidarScanManager::UnregisterSensor(ASpinningLidarSensorActor* Sensor) {
+    Sensors.Remove(Sensor);
+    if (ClockSensor != Sensor) return;
+
+    // Hand the clock to the next sensor that scans once per frame, or give the world back the
+    // rates it had before any sensor set them
+    ClockSensor = nullptr;
+    for (ASpinningLidarSensorActor* Other : Sensors) {
+        if (Other && !Other->bSubStepScan) {
+            UE_LOG(LogSpinningLidar, Log,
+                   TEXT("%s left, so the world now runs at the frame rate and time dilation "
+                        "of %s"),
+                   *Sensor->GetName(), *Other->GetName());
+            ApplyClockSettings(Other);
+            return;
+        }
+    }
+    RestoreClockSettings();
+}
+
+void ALidarScanManager::ApplyClockSettings(ASpinningLidarSensorActor* Sensor) {
+    if (ClockSensor) {
+        if (ClockSensor->RealClockFramerate != Sensor->RealClockFramerate ||
+            ClockSensor->SimTimeFramerate != Sensor->SimTimeFramerate) {
+            UE_LOG(LogSpinningLidar, Warning,
+                   TEXT("%s wants a different frame rate or time dilation than %s, which the "
+                        "world already runs at. Use sub-stepping for sensors with their own "
+                        "rates."),
+                   *Sensor->GetName(), *ClockSensor->GetName());
+        }
+        return;
+    }
+    ClockSensor = Sensor;
+    if (!bSavedClockSettings) {
+        SavedMaxFPS = GEngine ? GEngine->GetMaxFPS() : 0.f;
+        SavedTimeDilation = UGameplayStatics::GetGlobalTimeDilation(GetWorld());
+        bSavedClockSettings = true;
+    }
+
+    // Cap the frame rate at a value your machine can reliably achieve,
+    // to lock the simulation at a constant frame rate.
+    if (GEngine) GEngine->SetMaxFPS(Sensor->RealClockFramerate);
+
+    // Set global time dilation to match the ratio of sim time to real time
+    UGameplayStatics::SetGlobalTimeDilation(
+            GetWorld(), Sensor->RealClockFramerate / Sensor->SimTimeFramerate);
+}
+
+void ALidarScanManager::RestoreClockSettings() {
+    if (!bSavedClockSettings) return;
+    bSavedClockSettings = false;
+    if (GEngine) GEngine->SetMaxFPS(SavedMaxFPS);
+    UGameplayStatics::SetGlobalTimeDilation(GetWorld(), SavedTimeDilation);
+}
+
+// Snapshot every static mesh that blocks beams, in world space. Components that don't move but
+// can't be snapshotted are traced through the engine instead, as if they were movable.
+void ALidarScanManager::BuildStaticScene() {
+    const double StartSeconds = FPlatformTime::Seconds();
+    bStaticSceneBuilt = true;
+    StaticScene.Reset();
+    StaticSceneComponents.Reset();
+    StaticScenePhysicalMaterials.Reset();
+    FallbackComponents.Reset();
+
+    // Meshes placed many times are only read once
+    TMap<UStaticMesh*, FTriMeshCollisionData> MeshData;
+    TArray<UPrimitiveComponent*> Components;
+    for (TActorIterator<AActor> It(GetWorld()); It; ++It) {
+        AActor* Actor = *It;
+        // Movable actors are picked up every frame. Sensors never go in the snapshot, as
+        // their beams would hit their own mesh.
+        if (Actor->IsRootComponentMovable()) continue;
+        const bool bIsSensor = Actor->IsA<ASpinningLidarSensorActor>();
+        Actor->GetComponents(Components);
+        for (UPrimitiveComponent* Component : Components) {
+            // The snapshot only has opaque surfaces. Ones that beams pass through are left to
+            // the engine, for multi-return traces.
+            const ECollisionResponse Response = GetLidarBeamResponse(Component);
+            if (Response == ECR_Ignore) continue;
+            UStaticMeshComponent* MeshComponent = Cast<UStaticMeshComponent>(Component);
+            if (bIsSensor || !MeshComponent || Response != ECR_Block ||
+                Component->Mobility == EComponentMobility::Movable ||
+                !AddToStaticScene(MeshComponent, MeshData)) {
+                FallbackComponents.Add(Component);
+            }
+        }
+    }
+    StaticScene.Build();
+
+    UE_LOG(LogSpinningLidar, Log,
+           TEXT("Static scene snapshot of %d mesh materials, %d triangles, built in %.2f s"),
+           StaticSceneComponents.Num(), StaticScene.GetNumTriangles(),
+           FPlatformTime::Seconds() - StartSeconds);
+    if (FallbackComponents.Num() > 0) {
+        UE_LOG(LogSpinningLidar, Log,
+               TEXT("%d static components that lidar beams hit aren't static meshes with "
+                    "complex collision that block them, so beams that may cross them are "
+                    "traced by the engine"),
+               FallbackComponents.Num());
+    }
+}
+
+// Add every instance of a static mesh component to the static scene, using the triangles that
+// complex traces hit. Returns false if the mesh has none the scene can use.
+bool ALidarScanManager::AddToStaticScene(UStaticMeshComponent* Component,
+                                         TMap<UStaticMesh*, FTriMeshCollisionData> &MeshData) {
+    UStaticMesh* Mesh = Component->GetStaticMesh();
+    if (!Mesh) return false;
+    // Complex traces against these hit the simple collision shapes instead
+    if (Mesh->BodySetup &&
+        Mesh->BodySetup->GetCollisionTraceFlag() == CTF_UseSimpleAsComplex) {
+        return false;
+    }
+    FTriMeshCollisionData* Data = MeshData.Find(Mesh);
+    if (!Data) {
+        // Cooked builds only keep the triangles of meshes that allow CPU access
+        Data = &MeshData.Add(Mesh);
+        Mesh->GetPhysicsTriMeshData(Data, true);
+    }
+    if (Data->Indices.Num() == 0) return false;
+
+    TArray<FTransform, TInlineAllocator<1>> Transforms;
+    if (UInstancedStaticMeshComponent* Instanced = Cast<UInstancedStaticMeshComponent>(Component)) {
+        for (int32 Instance = 0; Instance < Instanced->GetInstanceCount(); Instance++) {
+            FTransform Transform;
+            if (Instanced->GetInstanceTransform(Instance, Transform, true)) {
+                Transforms.Add(Transform);
+            }
+        }
+    } else {
+        Transforms.Add(Component->GetComponentTransform());
+    }
+
+    // Each material of the mesh is an object of its own, so a beam knows the physical
+    // material of the triangle it hit, as a complex trace would
+    TArray<TArray<uint32>, TInlineAllocator<4>> MaterialIndices;
+    for (int32 Triangle = 0; Triangle < Data->Indices.Num(); Triangle++) {
+        const int32 MaterialIndex = Data->MaterialIndices.IsValidIndex(Triangle)
+                ? Data->MaterialIndices[Triangle] : 0;
+        if (MaterialIndex >= MaterialIndices.Num()) MaterialIndices.SetNum(MaterialIndex + 1);
+        const FTriIndices &Indices = Data->Indices[Triangle];
+        MaterialIndices[MaterialIndex].Add(Indices.v0);
+        MaterialIndices[MaterialIndex].Add(Indices.v1);
+        MaterialIndices[MaterialIndex].Add(Indices.v2);
+    }
+    TArray<int32, TInlineAllocator<4>> ObjectIndices;
+    for (int32 MaterialIndex = 0; MaterialIndex < MaterialIndices.Num(); MaterialIndex++) {
+        const UMaterialInterface* Material = Component->GetMaterial(MaterialIndex);
+        ObjectIndices.Add(StaticSceneComponents.Add(Component));
+        StaticScenePhysicalMaterials.Add(Material ? Material->GetPhysicalMaterial() : nullptr);
+    }
+
+    TArray<FLidarVector3> Vertices;
+    Vertices.SetNumUninitialized(Data->Vertices.Num());
+    for (const FTransform &Transform : Transforms) {
+        for (int32 i = 0; i < Vertices.Num(); i++) {
+            Vertices[i] = FLidarCoreConversions::ToCore(
+                    Transform.TransformPosition(Data->Vertices[i]));
+        }
+        for (int32 MaterialIndex = 0; MaterialIndex < MaterialIndices.Num(); MaterialIndex++) {
+            const TArray<uint32> &Indices = MaterialIndices[MaterialIndex];
+            if (Indices.Num() == 0) continue;
+            StaticScene.AddMesh(Vertices.GetData(), Indices.GetData(), Indices.Num() / 3,
+                                ObjectIndices[MaterialIndex]);
+        }
+    }
+    return true;
+}
+
+// Gather the bounds of everything beams hit that isn't in the static scene: the components
+// left out of the snapshot, and every component of every movable actor
+void ALidarScanManager::UpdateDynamicBounds() {
+    DynamicBounds.Reset();
+    for (const TWeakObjectPtr<UPrimitiveComponent> &Component : FallbackComponents) {
+        const ECollisionResponse Response = GetLidarBeamResponse(Component.Get());
+        if (Response != ECR_Ignore) {
+            DynamicBounds.Add({Component->Bounds.GetBox(), Component->GetOwner(),
+                               Response == ECR_Block});
+        }
+    }
+
+    TArray<UPrimitiveComponent*> Components;
+    for (TActorIterator<AActor> It(GetWorld()); It; ++It) {
+        AActor* Actor = *It;
+        if (!Actor->IsRootComponentMovable()) continue;
+        Actor->GetComponents(Components);
+        for (UPrimitiveComponent* Component : Components) {
+            const ECollisionResponse Response = GetLidarBeamResponse(Component);
+            if (Response != ECR_Ignore) {
+                DynamicBounds.Add({Component->Bounds.GetBox(), Actor, Response == ECR_Block});
+            }
+        }
+    }
+}
+
+void ALidarScanManager::Tick(float DeltaTime) {
+    Super::Tick(DeltaTime);
+
+    // A sensor can be destroyed by a handler of its own revolution event partway through,
+    // so work through the sensors registered at the start of the frame
+    TickSensors = Sensors;
+
+    // Every sensor builds the rays of the columns it swept this frame
+    for (ASpinningLidarSensorActor* Sensor : TickSensors) {
+        Sensor->BeginScanStep(DeltaTime);
+    }
+
+    // Trace the columns of every sensor in Parallel or StaticSnapshot mode as one batch.
+    // Scene queries are read-only and each column only writes its own points, so columns of
+    // different sensors can share the worker threads freely.
+    if (bStaticSceneBuilt) UpdateDynamicBounds();
+    SharedColumns.Reset();
+    int32 NumSharedRays = 0;
+    for (ASpinningLidarSensorActor* Sensor : TickSensors) {
+        if (!Sensor->IsTracedByScanManager() || !Sensors.Contains(Sensor)) continue;
+        const int32 NumColumns = Sensor->TraceBatch.Columns.Num();
+        for (int32 ColumnIndex = 0; ColumnIndex < NumColumns; ColumnIndex++) {
+            SharedColumns.Add({Sensor, ColumnIndex});
+        }
+        NumSharedRays += Sensor->TraceBatch.NumTracedRays;
+    }
+
+    double SharedTraceSeconds = 0.0;
+    if (SharedColumns.Num() > 0) {
+        LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarRaycasts);
+        FLidarScopedTimer RaycastsTimer(SharedTraceSeconds);
+        ParallelFor(SharedColumns.Num(), [this](int32 SharedIndex) {
+            const FSharedColumn &Column = SharedColumns[SharedIndex];
+            Column.Sensor->TraceLidarColumn(Column.Sensor->TraceBatch, Column.ColumnIndex);
+        });
+    }
+
+    // Each sensor is charged for the share of the batch its own rays made up
+    for (ASpinningLidarSensorActor* Sensor : TickSensors) {
+        if (!Sensors.Contains(Sensor)) continue;
+        double TraceSeconds = 0.0;
+        if (Sensor->IsTracedByScanManager() && NumSharedRays > 0) {
+            TraceSeconds = SharedTraceSeconds * Sensor->TraceBatch.NumTracedRays / NumSharedRays;
+        }
+        Sensor->EndScanStep(TraceSeconds);
+    }
+}
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarSensorProfiles.h"
+
+FLidarBeamTable FLidarSensorProfiles::GetBeamTable(ELidarSensorProfile Profile) {
+    switch (Profile) {
+    case ELidarSensorProfile::VelodyneHDL32E: return FLidarBeamTables::VelodyneHDL32E();
+    case ELidarSensorProfile::VelodyneVLP16: return FLidarBeamTables::VelodyneVLP16();
+    case ELidarSensorProfile::OusterOS1_64: return FLidarBeamTables::OusterOS1_64();
+    default: return FLidarBeamTable();
+    }
+}
+
+bool FLidarSensorProfiles::ParseProfileName(const FString &Name,
+                                            ELidarSensorProfile &OutProfile) {
+    if (Name.Equals(TEXT("custom"), ESearchCase::IgnoreCase)) {
+        OutProfile = ELidarSensorProfile::Custom;
+    } else if (Name.Equals(TEXT("HDL-32E"), ESearchCase::IgnoreCase)) {
+        OutProfile = ELidarSensorProfile::VelodyneHDL32E;
+    } else if (Name.Equals(TEXT("VLP-16"), ESearchCase::IgnoreCase)) {
+        OutProfile = ELidarSensorProfile::VelodyneVLP16;
+    } else if (Name.Equals(TEXT("OS1-64"), ESearchCase::IgnoreCase)) {
+        OutProfile = ELidarSensorProfile::OusterOS1_64;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+TArray<FString> FLidarSensorProfiles::GetProfileNames() {
+    return {TEXT("custom"), TEXT("HDL-32E"), TEXT("VLP-16"), TEXT("OS1-64")};
+}
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarUdpSender.h"
+#include "Common/UdpSocketBuilder.h"
+#include "IPAddress.h"
+#include "SocketSubsystem.h"
+#include "Sockets.h"
+
+FLidarUdpSender::~FLidarUdpSender() {
+    Close();
+}
+
+bool FLidarUdpSender::Open(const FString &Host, int32 Port) {
+    Close();
+
+    ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+    if (!SocketSubsystem) return false;
+
+    bool bIsValid = false;
+    Destination = SocketSubsystem->CreateInternetAddr();
+    Destination->SetIp(*Host, bIsValid);
+    Destination->SetPort(Port);
+    if (!bIsValid) {
+        Destination.Reset();
+        return false;
+    }
+
+    Socket = FUdpSocketBuilder(TEXT("LidarUdpSender"))
+            .AsNonBlocking()
+            .AsReusable()
+            .WithBroadcast()
+            .Build();
+    return Socket != nullptr;
+}
+
+void FLidarUdpSender::Close() {
+    if (Socket) {
+        Socket->Close();
+        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+        Socket = nullptr;
+    }
+    Destination.Reset();
+}
+
+void FLidarUdpSender::Send(const uint8* Data, int32 Count) {
+    if (!Socket) return;
+    int32 BytesSent = 0;
+    Socket->SendTo(Data, Count, BytesSent, *Destination);
+}
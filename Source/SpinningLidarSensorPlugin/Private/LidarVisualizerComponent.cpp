@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LidarVisualizerComponent.h"
+#include "PrimitiveSceneProxy.h"
+#include "SceneManagement.h"
+
+// Draws a copy of the component's points with the primitive draw interface, which batches
+// every point and line of a view into a few draw calls
+class FLidarVisualizerSceneProxy final : public FPrimitiveSceneProxy {
+ public:
+    explicit FLidarVisualizerSceneProxy(const ULidarVisualizerComponent* Component)
+        : FPrimitiveSceneProxy(Component), Points(Component->Points),
+          PointSize(Component->PointSize), bDrawBeams(Component->bDrawBeams),
+          BeamThickness(Component->BeamThickness), BeamColor(Component->BeamColor) {}
+
+    SIZE_T GetTypeHash() const override {
+        static size_t UniquePointer;
+        return reinterpret_cast<size_t>(&UniquePointer);
+    }
+
+    void GetDynamicMeshElements(const TArray<const FSceneView*> &Views,
+                                const FSceneViewFamily &ViewFamily, uint32 VisibilityMap,
+                                FMeshElementCollector &Collector) const override {
+        for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++) {
+            if (!(VisibilityMap & (1 << ViewIndex))) continue;
+            FPrimitiveDrawInterface* PDI = Collector.GetPDI(ViewIndex);
+            for (const FLidarVisualPoint &Point : Points) {
+                if (Point.bReturned) {
+                    PDI->DrawPoint(Point.Position, Point.Color, PointSize, SDPG_World);
+                }
+            }
+            if (!bDrawBeams) continue;
+            for (const FLidarVisualPoint &Point : Points) {
+                PDI->DrawLine(Point.BeamStart, Point.Position, BeamColor, SDPG_World,
+                              BeamThickness);
+            }
+        }
+    }
+
+    FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override {
+        FPrimitiveViewRelevance Result;
+        Result.bDrawRelevance = IsShown(View);
+        Result.bDynamicRelevance = true;
+        Result.bShadowRelevance = false;
+        return Result;
+    }
+
+    uint32 GetMemoryFootprint() const override { return sizeof(*this) + GetAllocatedSize(); }
+
+ private:
+    uint32 GetAllocatedSize() const {
+        return FPrimitiveSceneProxy::GetAllocatedSize() + Points.GetAllocatedSize();
+    }
+
+    const TArray<FLidarVisualPoint> Points;
+    const float PointSize;
+    const bool bDrawBeams;
+    const float BeamThickness;
+    const FColor BeamColor;
+};
+
+ULidarVisualizerComponent::ULidarVisualizerComponent() {
+    PrimaryComponentTick.bCanEverTick = false;
+    SetCollisionEnabled(ECollisionEnabled::NoCollision);
+    SetCastShadow(false);
+    // The points are in world space, wherever the sensor carrying the component goes
+    bAbsoluteLocation = true;
+    bAbsoluteRotation = true;
+    bAbsoluteScale = true;
+    PointBounds.Init();
+}
+
+void ULidarVisualizerComponent::SetPoints(TArray<FLidarVisualPoint> &InPoints) {
+    Swap(Points, InPoints);
+    PointBounds.Init();
+    for (const FLidarVisualPoint &Point : Points) {
+        PointBounds += Point.Position;
+        if (bDrawBeams) PointBounds += Point.BeamStart;
+    }
+    // The proxy is recreated with the new points, the same way the debug line batcher does it
+    UpdateBounds();
+    MarkRenderStateDirty();
+}
+
+FPrimitiveSceneProxy* ULidarVisualizerComponent::CreateSceneProxy() {
+    return Points.Num() > 0 ? new FLidarVisualizerSceneProxy(this) : nullptr;
+}
+
+FBoxSphereBounds ULidarVisualizerComponent::CalcBounds(const FTransform &LocalToWorld) const {
+    if (!PointBounds.IsValid) {
+        return FBoxSphereBounds(LocalToWorld.GetLocation(), FVector::ZeroVector, 0.f);
+    }
+    return FBoxSphereBounds(PointBounds);
+}
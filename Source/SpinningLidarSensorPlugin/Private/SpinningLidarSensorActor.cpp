@@ -2,17 +2,22 @@
 
 
 #include "SpinningLidarSensorActor.h"
+#include "LidarScanManager.h"
 #include "SpinningLidarSensorPlugin.h"
-#include <random>
+#include "SpinningLidarStats.h"
+#include "LidarCoreConversions.h"
 #include <math.h>
 #include "Kismet/KismetMathLibrary.h"
-#include "Runtime/Engine/Classes/Engine/TextureRenderTarget2D.h"
+#include "Async/ParallelFor.h"
+#include "EngineUtils.h"
+#include "Misc/App.h"
+#include "Misc/Compression.h"
 
 // Sets default values, including meshes
 ASpinningLidarSensorActor::ASpinningLidarSensorActor() {
-    // Set this actor to call Tick() every frame.
-    // You can turn this off to improve performance if you don't need it.
-    PrimaryActorTick.bCanEverTick = true;
+    // The sensor doesn't tick itself. The world's ALidarScanManager scans with every sensor
+    // at once each frame.
+    PrimaryActorTick.bCanEverTick = false;
 
     // Root component: a dummy for other components to move
     // relative to--for example, as the lidar scans,
@@ -44,42 +49,22 @@ ASpinningLidarSensorActor::ASpinningLidarSensorActor() {
     LidarMeshComponent->SetupAttachment(RootComponent);
     LidarMeshComponent->SetMobility(EComponentMobility::Movable);
 
-
-    // Add a scene capture component to write the view from the sensor to a texture,
-    // so that colors can be sampled from the world at the beam locations.
-    SceneCap = CreateDefaultSubobject<USceneCaptureComponent2D>(TEXT("SceneCapture"));
-    SceneCap->CaptureSource = ESceneCaptureSource::SCS_BaseColor;
-    RenderTexture = NewObject<UTextureRenderTarget2D>();
-    RenderTexture->InitAutoFormat(RenderTextureDimensions.X, RenderTextureDimensions.Y);
-    SceneCap->FOVAngle = 90.f;
-    if (abs(MaxElevation - MinElevation) > 70.f) SceneCap->FOVAngle =
-            abs(MaxElevation - MinElevation) + 20.f;
-    SceneCap->TextureTarget = RenderTexture;
-    SceneCap->SetupAttachment(LidarMeshComponent);
-    SceneCap->SetRelativeRotation(FRotator((MaxElevation + MinElevation) / 2.f, 0, 0));
-    SceneCap->SetRelativeLocation(FVector(0, 0, BeamStartRelativeZ));
+    // The visualizer draws in world space, so it doesn't matter what it is attached to
+    Visualizer = CreateDefaultSubobject<ULidarVisualizerComponent>(TEXT("Visualizer"));
+    Visualizer->SetupAttachment(RootComponent);
 }
 
 // Called when the game starts or when spawned
 void ASpinningLidarSensorActor::BeginPlay() {
     Super::BeginPlay();
 
-    UE_LOG(LogTemp, Warning, TEXT("lidar actor spawned"));
+    UE_LOG(LogSpinningLidar, Log, TEXT("lidar actor spawned"));
 
-    // Update the field of view for the scene capture if
-    // needed based on the max and min beam elevations
-    float LidarFOV = abs(MaxElevation - MinElevation);
-    if (LidarFOV > 70.f && LidarFOV < 150.f) {
-        SceneCap->FOVAngle = abs(MaxElevation - MinElevation) + 20.f;
-    } else if (LidarFOV >= 150.f) {
-        SceneCap->FOVAngle = 170.f;
-        UE_LOG(LogTemp, Warning, TEXT("Lidar beams have greater vertical FOV "
-                                      "than the scene capture component! Intensities may not be"
-                                      " calculated for points at the far top or bottom."));
-    }
+    // Build the beam direction table before anything depends on the elevation range
+    BuildBeamTable();
 
-    // The difference in elevation between adjacent lidar beams
-    BeamSpacing = (MaxElevation - MinElevation) / (NumBeams-1);
+    // Without rendering there is nothing to draw the points in
+    bRendering = FApp::CanEverRender();
 
     // Set the directory where the output file will be saved,
     // by default the top level folder of the Unreal project
@@ -90,352 +75,1471 @@ void ASpinningLidarSensorActor::BeginPlay() {
         SaveFilePath = FPaths::ProjectDir() + SaveFileName;
     }
 
-    // Open file to write, and then write the headers for the columns in the .csv file
-    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
-    IFileHandle* FileHandle = PlatformFile.OpenWrite(*SaveFilePath, true);
-    if (FileHandle) {
-        FString StringToWrite = FString(TEXT("timestamp (seconds),x (cm),y (cm),z (cm),"
-                                             "intensity (scale of 0 to 255)") LINE_TERMINATOR);
+    // The number of azimuth columns that make up one full revolution
+    ColumnsPerRevolution = FMath::Max(1, FMath::RoundToInt(360.f / AngularResolution));
+    PointsPerColumn = ReturnMode == ELidarReturnMode::Dual ? 2 * NumBeams : NumBeams;
+    RevolutionIndex = 0;
+    RevolutionColumn = 0;
+    CurrentCloud = nullptr;
+
+    // The hit cache holds one revolution, and starts out empty so the first is fully traced
+    CachedHits.Reset();
+    CachedColumns.Reset();
+    TrackedActors.Reset();
+    MovedActorBounds.Reset();
+    if (bReuseStaticHits) {
+        CachedHits.SetNumZeroed(ColumnsPerRevolution * NumBeams);
+        CachedColumns.SetNum(ColumnsPerRevolution);
+    }
 
-        FileHandle->Write((const uint8*)TCHAR_TO_ANSI(*StringToWrite), StringToWrite.Len());
+    // Labels start over with every recording
+    ComponentLabels.Reset();
+    ActorInstanceIds.Reset();
+    LabelDictionary = FLidarLabelDictionary();
+
+    // Skip more columns than asked for until a revolution's points fit the budget
+    VisualBeamStride = FMath::Max(1, VisualizeEveryNthBeam);
+    VisualColumnStride = FMath::Max(1, VisualizeEveryNthColumn);
+    const int32 VisualBeams = FMath::DivideAndRoundUp(NumBeams, VisualBeamStride);
+    if (VisualizationPointBudget > 0) {
+        const int32 BudgetColumns = FMath::Max(1, VisualizationPointBudget / VisualBeams);
+        VisualColumnStride = FMath::Max(
+                VisualColumnStride, FMath::DivideAndRoundUp(ColumnsPerRevolution, BudgetColumns));
+    }
+    PendingVisualPoints.Reset();
+    PendingVisualPoints.Reserve(
+            FMath::DivideAndRoundUp(ColumnsPerRevolution, VisualColumnStride) * VisualBeams);
+    Visualizer->PointSize = LidarPointSize;
+    Visualizer->bDrawBeams = bVisualizeBeams;
+    Visualizer->BeamThickness = BeamThickness;
+    Visualizer->BeamColor = BeamColor;
+
+    // Open the output writer once for the whole session.
+    // Everything after this is written on the writer thread.
+    // The frame index is laid out as frames are queued, so a frame dropped after that would
+    // leave every later entry pointing into the wrong chunk.
+    ELidarWriterBackpressure Backpressure = WriterBackpressure;
+    if (Backpressure == ELidarWriterBackpressure::DropOldest &&
+        FLidarPointCloudFormats::HasFrameIndex(OutputFormat)) {
+        UE_LOG(LogSpinningLidar, Warning,
+               TEXT("%s can't drop frames of its %s output, which has a frame index, so it "
+                    "buffers them until the writer catches up instead"),
+               *GetName(), FLidarPointCloudFormats::GetFileExtension(OutputFormat));
+        Backpressure = ELidarWriterBackpressure::Grow;
+    }
+    OutputWriter = MakeUnique<FLidarOutputWriter>(WriterQueueCapacity, Backpressure);
+    if (OutputFormat == ELidarOutputFormat::CSV) {
+        // Open the file, and then write the headers for the columns in the .csv file
+        if (OutputWriter->Open(SaveFilePath, true)) {
+            CsvWriter = FLidarCsvWriter(CsvTimestampDecimals, CsvDecimals);
+            FString StringToWrite = FString(TEXT("timestamp (seconds),x (cm),y (cm),z (cm),"
+                                                 "intensity (scale of 0 to 255)"));
+            if (ReturnMode != ELidarReturnMode::First) StringToWrite += TEXT(",return index");
+            if (bWriteLabels) StringToWrite += TEXT(",instance id,class id");
+            StringToWrite += LINE_TERMINATOR;
+
+            TArray<uint8> Buffer = OutputWriter->AcquireBuffer();
+            Buffer.Append((const uint8*)TCHAR_TO_ANSI(*StringToWrite), StringToWrite.Len());
+            OutputWriter->Submit(MoveTemp(Buffer));
+        } else {
+            UE_LOG(LogSpinningLidar, Error, TEXT("Could not open lidar output file %s"),
+                   *SaveFilePath);
+        }
+    } else if (OutputFormat == ELidarOutputFormat::VelodynePcap) {
+        // One capture for the whole session, starting with the pcap file header
+        const FString PcapFilePath = FPaths::GetBaseFilename(SaveFilePath, false) +
+                FLidarPointCloudFormats::GetFileExtension(OutputFormat);
+        if (OutputWriter->Open(PcapFilePath, false)) {
+            TArray<uint8> Buffer = OutputWriter->AcquireBuffer();
+            FLidarTArrayByteSink Sink(Buffer);
+            FLidarVelodynePacketEncoder::AppendPcapFileHeader(Sink);
+            OutputWriter->Submit(MoveTemp(Buffer));
+        } else {
+            UE_LOG(LogSpinningLidar, Error, TEXT("Could not open lidar output file %s"),
+                   *PcapFilePath);
+        }
+    } else if (OutputFormat == ELidarOutputFormat::RangeImage) {
+        // One file for the whole session, with a frame for each revolution
+        RangeImage = FLidarRangeImageEncoder(NumBeams, ColumnsPerRevolution,
+                                             RangeImageResolution);
+        const FString RangeImagePath = FPaths::GetBaseFilename(SaveFilePath, false) +
+                FLidarPointCloudFormats::GetFileExtension(OutputFormat);
+        if (OutputWriter->Open(RangeImagePath, false)) {
+            TArray<uint8> Buffer = OutputWriter->AcquireBuffer();
+            FLidarTArrayByteSink Sink(Buffer);
+            RangeImage.AppendFileHeader(Sink);
+            OutputWriter->Submit(MoveTemp(Buffer));
+        } else {
+            UE_LOG(LogSpinningLidar, Error, TEXT("Could not open lidar output file %s"),
+                   *RangeImagePath);
+        }
+    } else if (OutputFormat == ELidarOutputFormat::Recording) {
+        // One file for the whole session, with a frame for each revolution
+        Recording = FLidarRecordingEncoder(NumBeams, PointsPerColumn, ColumnsPerRevolution,
+                                           bUseLocalCoordinates);
+        const FString RecordingPath = FPaths::GetBaseFilename(SaveFilePath, false) +
+                FLidarPointCloudFormats::GetFileExtension(OutputFormat);
+        if (OutputWriter->Open(RecordingPath, false)) {
+            TArray<uint8> Buffer = OutputWriter->AcquireBuffer();
+            FLidarTArrayByteSink Sink(Buffer);
+            Recording.AppendFileHeader(Sink);
+            OutputWriter->Submit(MoveTemp(Buffer));
+        } else {
+            UE_LOG(LogSpinningLidar, Error, TEXT("Could not open lidar output file %s"),
+                   *RecordingPath);
+        }
+    } else {
+        // The binary formats start a new file for every revolution
+        OutputWriter->Open(FString(), false);
+    }
 
-        delete FileHandle;
+    // The Velodyne packet stream starts with an empty packet, and optionally goes out over UDP
+    VelodynePackets = FLidarVelodynePacketEncoder();
+    if (bSendVelodyneUdp && !VelodyneUdpSender.Open(VelodyneUdpAddress, VelodyneUdpPort)) {
+        UE_LOG(LogSpinningLidar, Error, TEXT("Could not open UDP socket to %s:%d"),
+               *VelodyneUdpAddress, VelodyneUdpPort);
     }
 
-    // Initialize the "sim time" value, which keeps track of the simulation clock
-    // regardless of whether the simulation runs in real time.
-    SimTimeSeconds = 0.f;
+    // Every slot of the shared-memory ring has room for a full revolution
+    if (bPublishSharedMemory &&
+        !SharedMemoryRing.Create(TCHAR_TO_ANSI(*SharedMemoryName),
+                                 FMath::Max(2, SharedMemorySlots),
+                                 ColumnsPerRevolution * PointsPerColumn)) {
+        UE_LOG(LogSpinningLidar, Error, TEXT("Could not create lidar shared memory %s"),
+               *SharedMemoryName);
+    }
 
-    // Cap the frame rate at a value your machine can reliably achieve,
-    // to lock the simulation at a constant frame rate.
-    if (GEngine) GEngine->SetMaxFPS(RealClockFramerate);
+    // Open the perf report, which gets one summary line per revolution
+    if (PerfReportFormat != ELidarPerfReportFormat::None) {
+        const FString PerfReportPath = FPaths::GetBaseFilename(SaveFilePath, false) +
+                (PerfReportFormat == ELidarPerfReportFormat::CSV ? TEXT("_perf.csv")
+                                                                 : TEXT("_perf.json"));
+        PerfReportWriter = MakeUnique<FLidarOutputWriter>(16, ELidarWriterBackpressure::Grow);
+        if (PerfReportWriter->Open(PerfReportPath, false)) {
+            if (PerfReportFormat == ELidarPerfReportFormat::CSV) {
+                WritePerfReportLine(TEXT("revolution,sim time (seconds),real time (seconds),"
+                                         "tick (ms),build rays (ms),raycasts (ms),"
+                                         "randomize returns (ms),range noise (ms),"
+                                         "intensity (ms),visualize (ms),filter (ms),"
+                                         "serialize (ms),"
+                                         "rays,hits,bytes written,rays per second,"
+                                         "writer queue depth"));
+            }
+        } else {
+            UE_LOG(LogSpinningLidar, Error, TEXT("Could not open lidar perf report %s"),
+                   *PerfReportPath);
+            PerfReportWriter.Reset();
+        }
+    }
 
-    // Set global time dilation to match the ratio of sim time to real time
-    UGameplayStatics::SetGlobalTimeDilation(GetWorld(), RealClockFramerate/SimTimeFramerate);
+    // Open the label dictionary, which gets a row for each class and instance as it is first
+    // hit
+    if (bWriteLabels) {
+        const FString LabelsPath = FPaths::GetBaseFilename(SaveFilePath, false) +
+                TEXT("_labels.csv");
+        LabelWriter = MakeUnique<FLidarOutputWriter>(16, ELidarWriterBackpressure::Grow);
+        if (LabelWriter->Open(LabelsPath, false)) {
+            TArray<uint8> Buffer = LabelWriter->AcquireBuffer();
+            FLidarTArrayByteSink Sink(Buffer);
+            FLidarLabelDictionary::AppendHeader(StringCast<ANSICHAR>(LINE_TERMINATOR).Get(),
+                                                Sink);
+            LabelWriter->Submit(MoveTemp(Buffer));
+        } else {
+            UE_LOG(LogSpinningLidar, Error, TEXT("Could not open lidar labels %s"), *LabelsPath);
+            LabelWriter.Reset();
+        }
+    }
+    TotalRays = 0;
+    TotalHits = 0;
+    RevolutionPerf = FLidarRevolutionPerf();
+    RevolutionPerf.StartRealTimeSeconds = FPlatformTime::Seconds();
+
+    // Set up the return model with the parameters from the editor.
+    // The noise is keyed by the sensor, so every run with the same seed is identical.
+    FLidarSensorModelSettings ModelSettings;
+    ModelSettings.LidarRange = LidarRange;
+    ModelSettings.RangeAccuracy = RangeAccuracy;
+    ModelSettings.MaxRangeNoReturnProbability = MaxRangeNoReturnProbability;
+    ModelSettings.FalloffStdDev = FalloffStdDev;
+    ModelSettings.IntensityAffectedByAngle = IntensityAffectedByAngle;
+    ModelSettings.NoiseSeed = NoiseSeed;
+    ModelSettings.SensorId = SensorId;
+    SensorModel = FLidarSensorModel(ModelSettings);
+
+    // Set up the filter stage, with a voxel grid big enough for a full revolution
+    FLidarPointFilterSettings FilterSettings;
+    FilterSettings.bDropMisses = bDropMisses;
+    FilterSettings.bCropToRegion = bCropToRegion;
+    FilterSettings.Region =
+            FLidarCoreConversions::ToCore(FTransform(RegionRotation, RegionCenter));
+    FilterSettings.RegionExtent = FLidarCoreConversions::ToCore(RegionExtent);
+    FilterSettings.VoxelSize = VoxelSize;
+    PointFilter = FLidarPointFilter(FilterSettings, ColumnsPerRevolution * PointsPerColumn);
+
+    // Raycasting parameters: "true" to trace using full visible geometry,
+    // "this" so that the sensor itself does not occlude the beam
+    RaycastParameters = FCollisionQueryParams(FName(TEXT("LidarBeam")), true, this);
+    // Physical materials are only needed if some of them behave differently from the rest
+    Reflectivities.Reset();
+    for (const TPair<UPhysicalMaterial*, float> &Entry : MaterialReflectivity) {
+        if (Entry.Key) Reflectivities.Add(Entry.Key, FMath::Clamp(Entry.Value, 0.f, 1.f));
+    }
+    RaycastParameters.bReturnPhysicalMaterial = Reflectivities.Num() > 0 ||
+            (ReturnMode != ELidarReturnMode::First && TransmissiveMaterials.Num() > 0);
+
+    // Start the sensor clock, which keeps track of the simulation time in integer
+    // nanoseconds regardless of whether the simulation runs in real time.
+    // The beams of a column fire one after another, spread evenly over the column's period.
+    ScanClock = FLidarFiringClock(SimTimeFramerate);
+    BeamFiringIntervalSeconds = ScanClock.GetFiringPeriodSeconds() / FMath::Max(1, NumBeams);
+
+    // Initialize the sub-stepping state from the starting pose of the sensor
+    PreviousActorTransform = GetActorTransform();
+    ScanAzimuth = LidarMeshComponent->RelativeRotation.Yaw;
+    RealTimeStartSeconds = FPlatformTime::Seconds();
+    PreviousRealTimeSeconds = 0.0;
+
+    // Hand the sensor to the world's scan manager, which also applies the frame rate cap and
+    // global time dilation if this sensor doesn't sub-step
+    ScanManager = ALidarScanManager::Get(GetWorld());
+    if (ScanManager.IsValid()) ScanManager->RegisterSensor(this);
 }
 
-// Called every frame
-void ASpinningLidarSensorActor::Tick(float DeltaTime) {
-    Super::Tick(DeltaTime);
+// Called when the game ends or the actor is destroyed
+void ASpinningLidarSensorActor::EndPlay(const EEndPlayReason::Type EndPlayReason) {
+    if (ScanManager.IsValid()) ScanManager->UnregisterSensor(this);
+    ScanManager.Reset();
 
-    /// Fire lasers in the direction the sensor is facing
-    // An array to store the data from each lidar beam for this timestep
-    TArray<FHitResult> LidarHits;
+    // Finish any traces still in flight and write out the partial final revolution
+    if (PendingAsyncBatch.AsyncHandles.Num() > 0) {
+        CollectAsyncLidarBatch(PendingAsyncBatch);
+        FinishLidarBatch(PendingAsyncBatch);
+    }
+    CompleteRevolution(CurrentCloud, false);
+    CurrentCloud = nullptr;
+    FlushVelodynePackets();
+    VelodyneUdpSender.Close();
+    if (OutputFormat == ELidarOutputFormat::RangeImage && OutputWriter && OutputWriter->IsOpen()) {
+        TArray<uint8> Buffer = OutputWriter->AcquireBuffer();
+        FLidarTArrayByteSink Sink(Buffer);
+        RangeImage.AppendIndex(Sink);
+        OutputWriter->Submit(MoveTemp(Buffer));
+    }
+    if (OutputFormat == ELidarOutputFormat::Recording && OutputWriter && OutputWriter->IsOpen()) {
+        TArray<uint8> Buffer = OutputWriter->AcquireBuffer();
+        FLidarTArrayByteSink Sink(Buffer);
+        Recording.AppendIndex(Sink);
+        OutputWriter->Submit(MoveTemp(Buffer));
+    }
+    SharedMemoryRing.Close();
+
+    // Consumers can no longer read the published revolutions
+    for (FLidarPointCloud* Cloud : PublishedClouds) PointCloudPool.Release(Cloud);
+    PublishedClouds.Reset();
 
-    // ASSUMPTION: The beams are evenly spaced in elevation.
-    for (int i = 0; i < NumBeams-1; i++) {
-        LidarHits.Emplace(FireLidarBeam(MinElevation + BeamSpacing * i));
+    // Write out everything still queued, then close the file
+    if (OutputWriter) {
+        OutputWriter->Flush();
+        OutputWriter->Close();
+        OutputWriter.Reset();
+    }
+    if (PerfReportWriter) {
+        PerfReportWriter->Close();
+        PerfReportWriter.Reset();
+    }
+    if (LabelWriter) {
+        LabelWriter->Close();
+        LabelWriter.Reset();
     }
 
-    // Doing the max elevation beam outside the loop so that
-    // max elevation is as precise as possible, without rounding errors
-    // NOTE: If there is only one beam, it will be at the max elevation angle.
-    LidarHits.Emplace(FireLidarBeam(MaxElevation));
+    Super::EndPlay(EndPlayReason);
+}
 
-    // Write the results from all beams to file
-    WriteLidarPointsToFile(LidarHits);
+// Build the rays of every column swept since the previous scan step
+void ASpinningLidarSensorActor::BeginScanStep(float DeltaTime) {
+    LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarTick);
+    FLidarScopedTimer TickTimer(RevolutionPerf.TickSeconds);
+    ScanStepStartRevolution = RevolutionIndex;
+
+    // Work out which azimuth columns the sensor fired during this frame. The clock carries
+    // the time to the next firing over to the next frame.
+    // Without sub-stepping, exactly one column is fired per tick at the current pose.
+    const int32 NumColumns = bSubStepScan ? ScanClock.Advance(DeltaTime)
+                                          : ScanClock.AdvanceOneFiring();
+
+    const FTransform CurrentActorTransform = GetActorTransform();
+    const double CurrentRealTimeSeconds = FPlatformTime::Seconds() - RealTimeStartSeconds;
+
+    // In async mode, the traces queued on the previous tick have completed by now
+    if (PendingAsyncBatch.AsyncHandles.Num() > 0) {
+        CollectAsyncLidarBatch(PendingAsyncBatch);
+        FinishLidarBatch(PendingAsyncBatch);
+    }
 
-    // Increment the "sim time" value by one timestep,
-    // according to the frame rate of the sensor if it ran in real time
-    SimTimeSeconds += 1.f / SimTimeFramerate;
+    // Look for movable actors that have moved, which cached hits can no longer be trusted near
+    if (CachedColumns.Num() > 0) UpdateMovedActors();
+
+    /// Fire lasers in the direction the sensor is facing, once per column
+    TraceBatch.Reset();
+    if (bWriteLabels) TraceBatch.PointComponents.SetNum(NumColumns * PointsPerColumn);
+    {
+        LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarBuildRays);
+        FLidarScopedTimer BuildRaysTimer(RevolutionPerf.BuildRaysSeconds);
+        for (int32 ColumnIndex = 0; ColumnIndex < NumColumns; ColumnIndex++) {
+            // How far through the frame this column was fired, from 0 (previous tick) to 1 (now)
+            const int64 Firing = ScanClock.TakeFiring();
+            const float Alpha = bSubStepScan ? ScanClock.GetFrameAlpha(Firing) : 1.f;
+
+            FLidarScanColumn Column;
+            Column.ActorTransform.Blend(PreviousActorTransform, CurrentActorTransform, Alpha);
+            Column.BeamTransform = FTransform(
+                    Column.ActorTransform.GetRotation() * FRotator(0, ScanAzimuth, 0).Quaternion(),
+                    Column.ActorTransform.GetLocation());
+            Column.Azimuth = ScanAzimuth;
+
+            // By default, use "sim time" which may be slower than real time,
+            // unless the option has been chosen to use the real clock.
+            Column.Timestamp = ScanClock.GetFiringTimeSeconds(Firing);
+            if (bUseRealClockTimestamps) {
+                Column.Timestamp = FMath::Lerp(PreviousRealTimeSeconds, CurrentRealTimeSeconds,
+                                               Alpha);
+            }
 
-    // Apply a relative rotation to the sensor.
-    // The mesh component will rotate while the root component is unchanged.
-    LidarMeshComponent->AddRelativeRotation(FRotator(0, AngularResolution, 0));
-}
-
-void ASpinningLidarSensorActor::WriteLidarPointsToFile(TArray<FHitResult> &LidarHits) {
-    // The time in seconds since the simulation began.
-    // By default, use "sim time" which may be slower than real time,
-    // unless the option has been chosen to use the real clock.
-    float Timestamp = SimTimeSeconds;
-    if (bUseRealClockTimestamps) {
-        Timestamp = GetWorld()->GetRealTimeSeconds();
-    }
-
-    // Get a base color image of the scene to determine the intensity of each lidar return
-    float HitIntensity = 0.f;
-    FColor PointColorFromScene = PointColor;
-    FTextureRenderTargetResource* RenderTextureResource =
-            SceneCap->TextureTarget->GameThread_GetRenderTargetResource();
-    TArray<FColor> ImageBitmap;
-    RenderTextureResource->ReadPixels(ImageBitmap);
-
-    /*Set up a FSceneView to match the perspective of the scene capture component,
-     * so that its WorldToPixel function can be used to
-     * find the pixel location of each lidar point*/
-    TSharedPtr<FSceneView> SceneView;
-    GetSceneView(SceneCap, SceneView);
-
-    // Write to the specified output file
-    IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
-    IFileHandle* FileHandle = PlatformFile.OpenWrite(*SaveFilePath, true);
-    if (FileHandle) {
-        for (auto Hit : LidarHits) {
-            //// Calculate the intensity of the return
-            // GetLidarPointIntensity(Hit, ImageBitmap, SceneView,
-                                   // PointColorFromScene, HitIntensity);
-
-            // Add Gaussian range noise based on angle of incidence
-            AddGaussianRangeNoise(Hit);
-
-            // Visualize the beam and any impact point it has
-            VisualizeBeam(Hit, PointColorFromScene);
-
-            // If the user has chosen to use the sensor's local coordinates,
-            // transform into this frame.
-            FVector LidarPoint = Hit.ImpactPoint;
-            if (bUseLocalCoordinates && Hit.bBlockingHit) {
-                LidarPoint = GetActorTransform().InverseTransformPositionNoScale(LidarPoint);
+            // Each revolution's points go into their own cloud from the pool
+            if (!CurrentCloud) {
+                CurrentCloud = PointCloudPool.Acquire(ColumnsPerRevolution * PointsPerColumn);
+                CurrentCloud->Revolution = RevolutionIndex;
+                CurrentCloud->bMultiReturn = ReturnMode != ELidarReturnMode::First;
+                CurrentCloud->SensorPose = FLidarCoreConversions::ToCore(Column.ActorTransform);
             }
+            Column.Revolution = RevolutionIndex;
+            Column.RevolutionColumn = RevolutionColumn;
+            Column.Cloud = CurrentCloud;
+            Column.FirstPoint = CurrentCloud->AddUninitialized(PointsPerColumn);
+            AddLidarColumn(TraceBatch, Column);
+
+            // Advance the sensor head by one azimuth step
+            ScanAzimuth = FMath::Fmod(ScanAzimuth + AngularResolution, 360.f);
+            if (++RevolutionColumn >= ColumnsPerRevolution) {
+                RevolutionColumn = 0;
+                RevolutionIndex++;
+                CurrentCloud = nullptr;
+            }
+        }
+    }
+
+    const int32 NumRays = TraceBatch.RayEnds.Num();
+    if (CachedColumns.Num() > 0 && NumRays > 0) {
+        const int32 NumReused = NumRays - TraceBatch.NumTracedRays;
+        INC_DWORD_STAT_BY(STAT_LidarReusedHits, NumReused);
+        ReusedHitFraction = (float)NumReused / NumRays;
+    }
 
-            // Beams that don't hit anything return 0 for x, y, and z.
-            if (!Hit.bBlockingHit) {
-                LidarPoint = FVector(0.f, 0.f, 0.f);
+    PreviousActorTransform = CurrentActorTransform;
+    PreviousRealTimeSeconds = CurrentRealTimeSeconds;
+}
+
+// Trace whatever the scan manager didn't, then hand the results to the output
+void ASpinningLidarSensorActor::EndScanStep(double SharedTraceSeconds) {
+    {
+        LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarTick);
+        FLidarScopedTimer TickTimer(RevolutionPerf.TickSeconds);
+        RevolutionPerf.TickSeconds += SharedTraceSeconds;
+
+        if (TraceMode == ELidarTraceMode::Async) {
+            // The results are picked up at the start of the next scan step
+            if (TraceBatch.Columns.Num() > 0) {
+                QueueAsyncLidarBatch(TraceBatch);
+                Swap(TraceBatch, PendingAsyncBatch);
+            }
+        } else if (TraceBatch.Columns.Num() > 0) {
+            if (IsTracedByScanManager()) {
+                // Already traced in the scan manager's shared batch
+                const int32 NumRays = TraceBatch.NumTracedRays;
+                INC_DWORD_STAT_BY(STAT_LidarRays, NumRays);
+                RevolutionPerf.Rays += NumRays;
+                RevolutionPerf.RaycastsSeconds += SharedTraceSeconds;
+                UpdateMeasuredRaysPerSecond(NumRays, SharedTraceSeconds);
+            } else {
+                TraceLidarBatch(TraceBatch);
             }
+            FinishLidarBatch(TraceBatch);
+        }
+    }
 
-            FString StringToWrite = FString::Printf(TEXT("%f,%f,%f,%f,%f") LINE_TERMINATOR,
-                                                    Timestamp,
-                                                    LidarPoint.X,
-                                                    LidarPoint.Y,
-                                                    LidarPoint.Z,
-                                                    HitIntensity);
-            FileHandle->Write((const uint8*)TCHAR_TO_ANSI(*StringToWrite), StringToWrite.Len());
-
-            // display sensor data in log for debugging
-            UE_LOG(LogTemp, Warning, TEXT("Impact Point: %s, Timestamp: %s"),
-                   *(LidarPoint.ToString()),
-                   *FString::SanitizeFloat(Timestamp));
-        }
-        delete FileHandle;
-    }
-}
-
-/*Set up a FSceneView to match the perspective of the scene capture component, so that its WorldToPixel function can be used
-to find the pixel location of each lidar point*/
-void ASpinningLidarSensorActor::GetSceneView(USceneCaptureComponent2D * SceneCapture,
-                                             TSharedPtr<FSceneView> &OutSceneView) {
-    FSceneViewInitOptions SceneViewOptions;
-    float TextureTargetWidth = SceneCapture->TextureTarget->GetSurfaceWidth();
-    float TextureTargetHeight = SceneCapture->TextureTarget->GetSurfaceHeight();
-    SceneViewOptions.SetViewRectangle(FIntRect(0, 0, TextureTargetWidth, TextureTargetHeight));
-    FSceneViewFamilyContext ViewFamilyContext(FSceneViewFamily::ConstructionValues(
-                                                  SceneCapture->TextureTarget->
-                                                  GameThread_GetRenderTargetResource(),
-                                                  SceneCapture->GetScene(),
-                                                  SceneCapture->ShowFlags));
-    SceneViewOptions.ViewFamily = &ViewFamilyContext;
-
-    // Find the translation and rotation for the view
-    FTransform ViewTransform = SceneCapture->GetComponentToWorld();
-    SceneViewOptions.ViewOrigin = ViewTransform.GetTranslation();
-    // remove translation to get the transform for the rotation only
-    ViewTransform.SetTranslation(FVector::ZeroVector);
-    SceneViewOptions.ViewRotationMatrix = ViewTransform.ToInverseMatrixWithScale() *
-            // Switch between screen coordinates (y-up, x-right, z-forward) and
-            // Unreal's left-handed 3D coordinates (z-up, y-right, x-forward)
-            FMatrix(FPlane(0, 0, 1, 0), FPlane(1, 0, 0, 0), FPlane(0, 1, 0, 0), FPlane(0, 0, 0, 1));
-    SceneViewOptions.OverrideFarClippingPlaneDistance = SceneCapture->MaxViewDistanceOverride;
-
-    // Find field of view multipliers for the x and y axis, which will be 1 for the larger axis
-
-    // Half the field of view in radians
-    float HalfFOV = SceneCapture->FOVAngle * (float)PI / 360.f;
-    float MultFOVX;
-    float MultFOVY;
-    if (TextureTargetWidth > TextureTargetHeight) {
-        MultFOVX = 1.f;
-        MultFOVY = TextureTargetWidth / TextureTargetHeight;
-    } else {
-        MultFOVX = TextureTargetHeight / TextureTargetWidth;
-        MultFOVY = 1.f;
-    }
-
-    SceneViewOptions.ProjectionMatrix =
-            FPerspectiveMatrix(HalfFOV, HalfFOV, MultFOVX, MultFOVY,
-                               GNearClippingPlane, GNearClippingPlane);
-    //    OutSceneView = MakeShareable(new FSceneView(SceneViewOptions));
-}
-
-// Add Gaussian range noise based on angle of incidence.
-void ASpinningLidarSensorActor::AddGaussianRangeNoise(FHitResult &Hit) {
-    if (Hit.bBlockingHit) {
-        // Determine the random amount by which to change the range of the hit
-        std::random_device rd;  // random seed
-        std::mt19937 gen(rd());  // random number engine based on Mersenne Twister algorithm
-
-        // find the unit vector parallel to the beam, in world coordinates
-        FVector BeamUnitVector =
-                UKismetMathLibrary::GetDirectionUnitVector(GetActorLocation()
-                                                           + GetActorUpVector()*BeamStartRelativeZ,
-                                                           Hit.ImpactPoint);
-
-        // Standard deviation.
-        // ASSUMPTION: the range noise is greatest when the angle of incidence is closest
-        // to parallel with the surface.
-        // This function should be adjusted to match real data, but it has a standard deviation
-        // based on the range accuracy from the spec sheet which is minimized when the beam is
-        // perpendicular to the surface and maximized as the beam approaches parallel
-        // to the surface.
-        float StdDev = RangeAccuracy *
-                (1.f - FVector::DotProduct(-BeamUnitVector, Hit.ImpactNormal));
-        std::normal_distribution<float> d(0.f, StdDev);
-        float RangeNoiseScalar = d(gen);
-
-        // Add a vector of this length to the hit's position, parallel to the laser beam
-        Hit.ImpactPoint += (BeamUnitVector*RangeNoiseScalar);
-        Hit.Distance += RangeNoiseScalar;
-
-        // Write to log for debugging
-        /*UE_LOG(LogTemp, Warning, TEXT("Distance: %s, Range Noise Standard Deviation: %s, Range Noise Scalar: %s"),
-            *FString::SanitizeFloat(Hit.Distance),
-            *FString::SanitizeFloat(StdDev),
-            *FString::SanitizeFloat(RangeNoiseScalar)
-        );*/
-    }
-}
-
-// Simulate the probability that there will be no return signal received for some hits,
-// especially near max range.
-// If the hit does not return due to this probability, set Hit.bBlockingHit to false.
-void ASpinningLidarSensorActor::RandomizeWhetherHitReturns(FHitResult &Hit) {
-    if (Hit.bBlockingHit && FalloffStdDev > 0.f) {
-        // Calculate probablility that there will be no return, as a function of distance.
-        // Use a gaussian function centered at the max distance.
-        float ProbabilityOfNoReturn = ProbabilityOfNoReturn =
-                MaxRangeNoReturnProbability * exp(-0.5f * pow((Hit.Distance - LidarRange) /
-                                                              FalloffStdDev, 2));
-
-        // Use RNG to determine whether this hit is received or lost.
-        if (FMath::RandRange(0.f, 1.f) < ProbabilityOfNoReturn) Hit.bBlockingHit = false;
-
-        // Write to log for debugging
-        /*UE_LOG(LogTemp, Warning, TEXT("Distance: %s, ProbabilityOfNoReturn: %s"),
-            *FString::SanitizeFloat(Hit.Distance),
-            *FString::SanitizeFloat(ProbabilityOfNoReturn)
-        );*/
-    }
-}
-
-FHitResult ASpinningLidarSensorActor::FireLidarBeam(float BeamElevation) {
-    // an out parameter of LineTraceSingleByChannel that will contain
-    // the data returned from a firing of a laser
-    FHitResult Hit;
-
-    // The raycast starts at a location that is an adjustable distance
+    // Update the writer counters shown in the editor
+    if (OutputWriter) {
+        WriterQueueDepth = OutputWriter->GetQueueDepth();
+        WriterPeakQueueDepth = OutputWriter->GetPeakQueueDepth();
+        WriterBatchesDropped = OutputWriter->GetBatchesDropped();
+        WriterBytesWritten = OutputWriter->GetBytesWritten();
+    }
+
+    // Apply the final relative rotation to the sensor.
+    // The mesh component will rotate while the root component is unchanged.
+    LidarMeshComponent->SetRelativeRotation(FRotator(0, ScanAzimuth, 0));
+
+    // Summarize every revolution that finished during this step. The work of a step that
+    // finished several is counted in the first of them.
+    for (int32 Revolution = ScanStepStartRevolution; Revolution < RevolutionIndex; Revolution++) {
+        WritePerfReport(Revolution);
+    }
+}
+
+void ASpinningLidarSensorActor::FLidarTraceBatch::Reset() {
+    Columns.Reset();
+    RayEnds.Reset();
+    TraceRays.Reset();
+    AsyncHandles.Reset();
+    PointComponents.Reset();
+    NumTracedRays = 0;
+}
+
+// Add the rays for every beam in one azimuth column to a batch
+void ASpinningLidarSensorActor::AddLidarColumn(FLidarTraceBatch &Batch,
+                                               const FLidarScanColumn &Column) {
+    // The raycasts start at a location that is an adjustable distance
     // along the actor's z axis from the actor's root component.
-    FVector BeamStart = GetActorLocation() + GetActorUpVector()*BeamStartRelativeZ;
+    // The only per-column work is one rotation of the cached beam directions
+    const FLidarRigidTransform Head = FLidarCoreConversions::ToCore(Column.BeamTransform);
+    const FLidarVector3 BeamStart = ScanPattern.GetBeamStart(Head, BeamStartRelativeZ);
+
+    const int32 ColumnIndex = Batch.Columns.Emplace(Column);
+    Batch.Columns[ColumnIndex].BeamStart = FLidarCoreConversions::ToEngine(BeamStart);
+    // A step longer than a revolution fires some places in it twice. Only the first firing of
+    // each uses the cache, as the columns of a batch are traced at the same time.
+    Batch.Columns[ColumnIndex].bCacheHits =
+            CachedColumns.Num() > 0 && ColumnIndex < ColumnsPerRevolution;
+    Batch.Columns[ColumnIndex].PointComponents =
+            Batch.PointComponents.Num() > 0 ? &Batch.PointComponents[ColumnIndex * PointsPerColumn]
+                                            : nullptr;
+
+    for (int32 i = 0; i < NumBeams; i++) {
+        // A point at the max range of the raycast
+        Batch.RayEnds.Emplace(FLidarCoreConversions::ToEngine(
+                ScanPattern.GetBeamEnd(Head, BeamStart, i, LidarRange)));
+        Batch.TraceRays.Add(true);
+    }
+    Batch.NumTracedRays += NumBeams;
 
-    // A point at the max range of the raycast
-    FVector BeamEnd = BeamStart +
-            LidarMeshComponent->GetForwardVector().RotateAngleAxis(
-                BeamElevation, -LidarMeshComponent->GetRightVector())*LidarRange;
-    // Note: Unreal uses a left-handed coordinate system, so the "right" vector is multiplied
-    // by -1 before rotating about it
+    if (Batch.Columns[ColumnIndex].bCacheHits) ReuseCachedHits(Batch, ColumnIndex);
+}
 
-    // Raycasting parameters: "true" to trace using full visible geometry,
-    // "this" so that the sensor itself does not occlude the beam
-    FCollisionQueryParams RaycastParameters(FName(TEXT("")), true, this);
+// Store the cached hits of a column that can still be trusted, leaving only the rest to trace.
+// The cache is indexed by the column's place in the revolution, so each beam is compared with
+// its own firing one revolution earlier.
+void ASpinningLidarSensorActor::ReuseCachedHits(FLidarTraceBatch &Batch, int32 ColumnIndex) {
+    const FLidarScanColumn &Column = Batch.Columns[ColumnIndex];
+    FLidarCachedColumn &CachedColumn = CachedColumns[Column.RevolutionColumn];
+    const FQuat BeamRotation = Column.BeamTransform.GetRotation();
+
+    // Once the sensor head has moved, the whole column is traced and cached again from here.
+    // It is only valid again once FinishLidarBatch has its traces.
+    if (!CachedColumn.bValid ||
+        FVector::Dist(Column.BeamStart, CachedColumn.BeamStart) > ReusePositionTolerance ||
+        BeamRotation.AngularDistance(CachedColumn.BeamRotation) >
+                FMath::DegreesToRadians(ReuseRotationTolerance)) {
+        CachedColumn.bValid = false;
+        return;
+    }
+
+    const int32 FirstRay = ColumnIndex * NumBeams;
+    const int32 FirstCachedHit = Column.RevolutionColumn * NumBeams;
+    for (int32 i = 0; i < NumBeams; i++) {
+        // Hits on anything that can move, or that has since been destroyed, are traced again
+        const FLidarCachedHit &Cached = CachedHits[FirstCachedHit + i];
+        if (Cached.bMovable || (Cached.bBlockingHit && !Cached.Component.IsValid())) continue;
+
+        // So are beams that a moved actor may now be in the way of
+        const FVector &RayEnd = Batch.RayEnds[FirstRay + i];
+        const FVector PathEnd = Cached.bBlockingHit ? Cached.ImpactPoint : RayEnd;
+        bool bCrossesMovedActor = false;
+        for (const FBox &Bounds : MovedActorBounds) {
+            if (FMath::LineBoxIntersection(Bounds, Column.BeamStart, PathEnd,
+                                           PathEnd - Column.BeamStart)) {
+                bCrossesMovedActor = true;
+                break;
+            }
+        }
+        if (bCrossesMovedActor) continue;
+
+        Batch.TraceRays[FirstRay + i] = false;
+        Batch.NumTracedRays--;
+        StoreLidarPoint(Column, i, Cached.bBlockingHit, Cached.ImpactPoint, Cached.ImpactNormal,
+                        Cached.Distance, Cached.Reflectivity, Cached.Component, RayEnd);
+    }
+}
+
+// Track the movable actors in range, noting when each last moved further than the tolerance.
+// An actor's bounds invalidate cached hits for one revolution after it moves, by which time
+// every column has been traced again with the actor where it is now.
+void ASpinningLidarSensorActor::UpdateMovedActors() {
+    const int64 NextFiring = ScanClock.GetNextFiring();
+    const FVector SensorLocation = GetActorLocation();
+    const float RotationTolerance = FMath::DegreesToRadians(ReuseRotationTolerance);
+
+    for (TActorIterator<AActor> It(GetWorld()); It; ++It) {
+        AActor* Actor = *It;
+        if (Actor == this || !Actor->IsRootComponentMovable()) continue;
+        const FBox Bounds = Actor->GetComponentsBoundingBox(true);
+        if (!Bounds.IsValid ||
+            Bounds.ComputeSquaredDistanceToPoint(SensorLocation) > FMath::Square(LidarRange)) {
+            continue;
+        }
+
+        // Hits cached before an actor came into range may be behind it, so it starts out moved
+        const FTransform Transform = Actor->GetActorTransform();
+        FLidarTrackedActor* Tracked = TrackedActors.Find(Actor);
+        if (!Tracked) {
+            TrackedActors.Add(Actor, {Transform, Bounds, NextFiring});
+        } else if (FVector::Dist(Transform.GetLocation(), Tracked->Transform.GetLocation()) >
+                           ReusePositionTolerance ||
+                   Transform.GetRotation().AngularDistance(Tracked->Transform.GetRotation()) >
+                           RotationTolerance) {
+            Tracked->Transform = Transform;
+            Tracked->Bounds = Bounds;
+            Tracked->MovedAtFiring = NextFiring;
+        }
+    }
+
+    MovedActorBounds.Reset();
+    for (auto It = TrackedActors.CreateIterator(); It; ++It) {
+        if (!It.Key().IsValid()) {
+            It.RemoveCurrent();
+        } else if (NextFiring < It.Value().MovedAtFiring + ColumnsPerRevolution) {
+            MovedActorBounds.Add(It.Value().Bounds.ExpandBy(ReusePositionTolerance));
+        }
+    }
+}
+
+// Work out the direction of every beam relative to the sensor head, once per session.
+// Built-in profiles use their laser tables and override the beam count and elevation range.
+void ASpinningLidarSensorActor::BuildBeamTable() {
+    const FLidarBeamTable ProfileTable = FLidarSensorProfiles::GetBeamTable(SensorProfile);
+    if (ProfileTable.Num > 0) {
+        ScanPattern = FLidarScanPattern(ProfileTable);
+        NumBeams = ScanPattern.Num();
+        MinElevation = ScanPattern.GetMinElevation();
+        MaxElevation = ScanPattern.GetMaxElevation();
+    } else {
+        ScanPattern = FLidarScanPattern(NumBeams, MinElevation, MaxElevation);
+    }
+}
+
+// Trace the rays of one column. Only reads the scene and writes the column's own points,
+// so it can run on any thread.
+void ASpinningLidarSensorActor::TraceLidarColumn(FLidarTraceBatch &Batch, int32 ColumnIndex) {
+    if (TraceMode == ELidarTraceMode::StaticSnapshot && ScanManager.IsValid()) {
+        TraceStaticSnapshotColumn(Batch, ColumnIndex);
+        return;
+    }
+
+    UWorld* World = GetWorld();
+    const FLidarScanColumn &Column = Batch.Columns[ColumnIndex];
+    TArray<FHitResult> Hits;
+    for (int32 i = 0; i < NumBeams; i++) {
+        if (!Batch.TraceRays[ColumnIndex * NumBeams + i]) continue;
+        TraceLidarBeam(World, Column, i, Batch.RayEnds[ColumnIndex * NumBeams + i], Hits);
+    }
+}
+
+// Trace one beam through the engine and store it. Each result is stored straight into the
+// column's point cloud, so the full FHitResult only ever lives on the stack of the thread that
+// traced it. Multi-return modes trace every surface up to the first that blocks into Hits,
+// which is only there to keep its allocation from beam to beam.
+void ASpinningLidarSensorActor::TraceLidarBeam(UWorld* World, const FLidarScanColumn &Column,
+                                               int32 BeamIndex, const FVector &RayEnd,
+                                               TArray<FHitResult> &Hits) {
+    if (ReturnMode == ELidarReturnMode::First) {
+        FHitResult Hit(Column.BeamStart, RayEnd);
+        World->LineTraceSingleByChannel(
+                    Hit,
+                    Column.BeamStart,
+                    RayEnd,
+                    ECollisionChannel::ECC_Visibility,
+                    RaycastParameters);
+        StoreLidarHit(Column, BeamIndex, Hit);
+    } else {
+        World->LineTraceMultiByChannel(
+                    Hits,
+                    Column.BeamStart,
+                    RayEnd,
+                    ECollisionChannel::ECC_Visibility,
+                    RaycastParameters);
+        StoreLidarHits(Column, BeamIndex, Hits, RayEnd);
+    }
+}
+
+// Trace the stretch of a beam from SpanStart to SpanEnd through the engine, and store the beam
+// if the stretch has its returns. Returns false if the beam passes through the stretch without
+// hitting anything, leaving the rest of it to the caller.
+bool ASpinningLidarSensorActor::TraceLidarBeamSpan(UWorld* World, const FLidarScanColumn &Column,
+                                                   int32 BeamIndex, const FVector &SpanStart,
+                                                   const FVector &SpanEnd, const FVector &RayEnd,
+                                                   TArray<FHitResult> &Hits) {
+    // Distances are along the whole beam, not the stretch
+    const float SpanOffset = FVector::Dist(Column.BeamStart, SpanStart);
+    if (ReturnMode == ELidarReturnMode::First) {
+        FHitResult Hit(SpanStart, SpanEnd);
+        if (!World->LineTraceSingleByChannel(Hit, SpanStart, SpanEnd,
+                                             ECollisionChannel::ECC_Visibility,
+                                             RaycastParameters)) {
+            return false;
+        }
+        Hit.Distance += SpanOffset;
+        Hit.TraceStart = Column.BeamStart;
+        Hit.TraceEnd = RayEnd;
+        StoreLidarHit(Column, BeamIndex, Hit);
+        return true;
+    }
+
+    World->LineTraceMultiByChannel(Hits, SpanStart, SpanEnd, ECollisionChannel::ECC_Visibility,
+                                   RaycastParameters);
+    if (Hits.Num() == 0) return false;
+    if (!Hits.Last().bBlockingHit) {
+        // The beam goes on through to surfaces further out, so it is traced whole
+        TraceLidarBeam(World, Column, BeamIndex, RayEnd, Hits);
+        return true;
+    }
+    for (FHitResult &Hit : Hits) {
+        Hit.Distance += SpanOffset;
+    }
+    StoreLidarHits(Column, BeamIndex, Hits, RayEnd);
+    return true;
+}
+
+// Trace the rays of one column against the scan manager's static scene, all beams at once.
+// Where a ray's path up to its hit crosses the bounds of anything the snapshot doesn't have,
+// that stretch of it is traced by the engine as well. Runs on any thread, like
+// TraceLidarColumn.
+void ASpinningLidarSensorActor::TraceStaticSnapshotColumn(FLidarTraceBatch &Batch,
+                                                          int32 ColumnIndex) {
+    const ALidarScanManager* Manager = ScanManager.Get();
+    const FLidarScanColumn &Column = Batch.Columns[ColumnIndex];
+    const int32 FirstRay = ColumnIndex * NumBeams;
+
+    // Reused rays are traced along with the rest, as whole packets are cheaper than gaps
+    TArray<FLidarVector3, TInlineAllocator<128>> RayEnds;
+    TArray<FLidarBvhHit, TInlineAllocator<128>> SnapshotHits;
+    RayEnds.SetNumUninitialized(NumBeams);
+    SnapshotHits.SetNumUninitialized(NumBeams);
+    FBox ColumnBounds(Column.BeamStart, Column.BeamStart);
+    for (int32 i = 0; i < NumBeams; i++) {
+        RayEnds[i] = FLidarCoreConversions::ToCore(Batch.RayEnds[FirstRay + i]);
+        ColumnBounds += Batch.RayEnds[FirstRay + i];
+    }
+    Manager->GetStaticScene().TraceFan(FLidarCoreConversions::ToCore(Column.BeamStart),
+                                       RayEnds.GetData(), NumBeams, SnapshotHits.GetData());
+
+    // Only the dynamic bounds near the column can be in the way of its beams.
+    // The sensor's own components are ignored by its traces, so they never are, and ones that
+    // beams pass through only matter to multi-hit traces.
+    const bool bMultiReturn = ReturnMode != ELidarReturnMode::First;
+    TArray<FLidarBox, TInlineAllocator<16>> NearbyBounds;
+    for (const FLidarDynamicBounds &Dynamic : Manager->GetDynamicBounds()) {
+        if (Dynamic.Owner != this && (Dynamic.bBlocksBeams || bMultiReturn) &&
+            Dynamic.Bounds.Intersect(ColumnBounds)) {
+            NearbyBounds.Add(FLidarCoreConversions::ToCore(Dynamic.Bounds));
+        }
+    }
+    const FLidarVector3 BeamStart = FLidarCoreConversions::ToCore(Column.BeamStart);
+
+    UWorld* World = GetWorld();
+    TArray<FHitResult> Hits;
+    int32 NumFallbackRays = 0;
+    for (int32 i = 0; i < NumBeams; i++) {
+        if (!Batch.TraceRays[FirstRay + i]) continue;
+        const FVector &RayEnd = Batch.RayEnds[FirstRay + i];
+        const FLidarBvhHit &SnapshotHit = SnapshotHits[i];
+        const FVector ImpactPoint = FLidarCoreConversions::ToEngine(SnapshotHit.ImpactPoint);
+        const FVector PathEnd = SnapshotHit.bBlockingHit ? ImpactPoint : RayEnd;
+
+        // Only the stretch of the path that crosses dynamic bounds is traced by the engine.
+        // Bounds the beam starts inside, like those of the vehicle the sensor is mounted on,
+        // only cost a trace out to their side.
+        float SpanEnter = 1.f;
+        float SpanExit = 0.f;
+        for (const FLidarBox &Bounds : NearbyBounds) {
+            float Enter, Exit;
+            if (Bounds.ClipSegment(BeamStart, FLidarCoreConversions::ToCore(PathEnd), Enter,
+                                   Exit)) {
+                SpanEnter = FMath::Min(SpanEnter, Enter);
+                SpanExit = FMath::Max(SpanExit, Exit);
+            }
+        }
+        if (SpanEnter <= SpanExit) {
+            NumFallbackRays++;
+            if (TraceLidarBeamSpan(World, Column, i,
+                                   FMath::Lerp(Column.BeamStart, PathEnd, SpanEnter),
+                                   FMath::Lerp(Column.BeamStart, PathEnd, SpanExit), RayEnd,
+                                   Hits)) {
+                continue;
+            }
+        }
+
+        // The snapshot's surfaces are all opaque, so its hit is the beam's only return
+        const FVector ImpactNormal = FLidarCoreConversions::ToEngine(SnapshotHit.ImpactNormal);
+        const float Reflectivity = SnapshotHit.bBlockingHit ? GetReflectivity(
+                Manager->GetStaticScenePhysicalMaterial(SnapshotHit.ObjectIndex)) : 0.f;
+        const TWeakObjectPtr<UPrimitiveComponent> Component = SnapshotHit.bBlockingHit
+                ? Manager->GetStaticSceneComponent(SnapshotHit.ObjectIndex) : nullptr;
+        StoreLidarPoint(Column, i, SnapshotHit.bBlockingHit, ImpactPoint, ImpactNormal,
+                        SnapshotHit.Distance, Reflectivity, Component, RayEnd);
+        CacheLidarHit(Column, i, SnapshotHit.bBlockingHit, ImpactPoint, ImpactNormal,
+                      SnapshotHit.Distance, Reflectivity, Component, false);
+    }
+    INC_DWORD_STAT_BY(STAT_LidarSnapshotFallbackRays, NumFallbackRays);
+}
+
+// Trace every ray in a batch serially on the game thread.
+// Batches in Parallel and StaticSnapshot mode are traced by the scan manager instead.
+void ASpinningLidarSensorActor::TraceLidarBatch(FLidarTraceBatch &Batch) {
+    const int32 NumRays = Batch.NumTracedRays;
+
+    LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarRaycasts);
+    FLidarScopedTimer RaycastsTimer(RevolutionPerf.RaycastsSeconds);
+    INC_DWORD_STAT_BY(STAT_LidarRays, NumRays);
+    RevolutionPerf.Rays += NumRays;
+
+    const double StartSeconds = FPlatformTime::Seconds();
+    for (int32 ColumnIndex = 0; ColumnIndex < Batch.Columns.Num(); ColumnIndex++) {
+        TraceLidarColumn(Batch, ColumnIndex);
+    }
+    UpdateMeasuredRaysPerSecond(NumRays, FPlatformTime::Seconds() - StartSeconds);
+}
+
+// Hand every ray in a batch to the world's async trace system.
+// The traces run on worker threads during the rest of the frame.
+void ASpinningLidarSensorActor::QueueAsyncLidarBatch(FLidarTraceBatch &Batch) {
+    LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarRaycasts);
+    FLidarScopedTimer RaycastsTimer(RevolutionPerf.RaycastsSeconds);
+
+    // Rays whose hits were reused keep an invalid handle
+    const int32 NumRays = Batch.RayEnds.Num();
+    Batch.AsyncHandles.Reset();
+    Batch.AsyncHandles.SetNum(NumRays, false);
+    Batch.TraceStartSeconds = FPlatformTime::Seconds();
+
+    const EAsyncTraceType TraceType = ReturnMode == ELidarReturnMode::First
+            ? EAsyncTraceType::Single : EAsyncTraceType::Multi;
+    UWorld* World = GetWorld();
+    for (int32 RayIndex = 0; RayIndex < NumRays; RayIndex++) {
+        if (!Batch.TraceRays[RayIndex]) continue;
+        Batch.AsyncHandles[RayIndex] = World->AsyncLineTraceByChannel(
+                    TraceType,
+                    Batch.Columns[RayIndex / NumBeams].BeamStart,
+                    Batch.RayEnds[RayIndex],
+                    ECollisionChannel::ECC_Visibility,
+                    RaycastParameters);
+    }
+}
+
+// Gather the results of a batch queued with QueueAsyncLidarBatch on the previous tick
+void ASpinningLidarSensorActor::CollectAsyncLidarBatch(FLidarTraceBatch &Batch) {
+    LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarRaycasts);
+    FLidarScopedTimer RaycastsTimer(RevolutionPerf.RaycastsSeconds);
+
+    const int32 NumTracedRays = Batch.NumTracedRays;
+    INC_DWORD_STAT_BY(STAT_LidarRays, NumTracedRays);
+    RevolutionPerf.Rays += NumTracedRays;
+
+    UWorld* World = GetWorld();
+    FTraceDatum TraceData;
+    for (int32 RayIndex = 0; RayIndex < Batch.AsyncHandles.Num(); RayIndex++) {
+        if (!Batch.TraceRays[RayIndex]) continue;
+        const FLidarScanColumn &Column = Batch.Columns[RayIndex / NumBeams];
+        FHitResult Hit(Column.BeamStart, Batch.RayEnds[RayIndex]);
+
+        // Beams whose trace found nothing, or whose data has expired, are left as misses
+        const bool bHaveTraceData = World->QueryTraceData(Batch.AsyncHandles[RayIndex], TraceData);
+        if (!bHaveTraceData) TraceData.OutHits.Reset();
+        if (ReturnMode != ELidarReturnMode::First) {
+            StoreLidarHits(Column, RayIndex % NumBeams, TraceData.OutHits,
+                           Batch.RayEnds[RayIndex]);
+        } else {
+            if (TraceData.OutHits.Num() > 0) Hit = TraceData.OutHits[0];
+            StoreLidarHit(Column, RayIndex % NumBeams, Hit);
+        }
+
+        // An expired trace says nothing about the scene, so its column is cached again
+        if (!bHaveTraceData && Column.bCacheHits) {
+            CachedColumns[Column.RevolutionColumn].bValid = false;
+            Batch.Columns[RayIndex / NumBeams].bCacheHits = false;
+        }
+    }
+    Batch.AsyncHandles.Reset();
+    UpdateMeasuredRaysPerSecond(NumTracedRays,
+                                FPlatformTime::Seconds() - Batch.TraceStartSeconds);
+}
+
+// Store the result of one beam's trace as a point in its column's cloud, and cache it
+void ASpinningLidarSensorActor::StoreLidarHit(const FLidarScanColumn &Column, int32 BeamIndex,
+                                              const FHitResult &Hit) {
+    const float Reflectivity = GetReflectivity(Hit.PhysMaterial.Get());
+    StoreLidarPoint(Column, BeamIndex, Hit.bBlockingHit, Hit.ImpactPoint, Hit.ImpactNormal,
+                    Hit.Distance, Reflectivity, Hit.Component, Hit.TraceEnd);
+    const UPrimitiveComponent* Component = Hit.GetComponent();
+    CacheLidarHit(Column, BeamIndex, Hit.bBlockingHit, Hit.ImpactPoint, Hit.ImpactNormal,
+                  Hit.Distance, Reflectivity, Hit.Component,
+                  Component && Component->Mobility == EComponentMobility::Movable);
+}
+
+// Store the surfaces one beam's multi-hit trace reached, in order along the beam, as the
+// returns ReturnMode reports
+void ASpinningLidarSensorActor::StoreLidarHits(const FLidarScanColumn &Column, int32 BeamIndex,
+                                               const TArray<FHitResult> &Hits,
+                                               const FVector &TraceEnd) {
+    if (Hits.Num() == 0) {
+        StoreLidarPoint(Column, BeamIndex, false, TraceEnd, FVector::ZeroVector, 0.f, 0.f,
+                        nullptr, TraceEnd);
+        CacheLidarHit(Column, BeamIndex, false, TraceEnd, FVector::ZeroVector, 0.f, 0.f,
+                      nullptr, false);
+        return;
+    }
+
+    // How strong each surface's return is, from how much of the beam gets through to it
+    TArray<FLidarBeamSurface, TInlineAllocator<8>> Surfaces;
+    TArray<float, TInlineAllocator<8>> Strengths;
+    Surfaces.SetNumUninitialized(Hits.Num());
+    Strengths.SetNumUninitialized(Hits.Num());
+    for (int32 i = 0; i < Hits.Num(); i++) {
+        Surfaces[i].ImpactPoint = FLidarCoreConversions::ToCore(Hits[i].ImpactPoint);
+        Surfaces[i].ImpactNormal = FLidarCoreConversions::ToCore(Hits[i].ImpactNormal);
+        Surfaces[i].Transmittance = GetTransmittance(Hits[i]);
+        Surfaces[i].Reflectivity = GetReflectivity(Hits[i].PhysMaterial.Get());
+    }
+    SensorModel.GetReturnStrengths(Surfaces.GetData(), Surfaces.Num(),
+                                   FLidarCoreConversions::ToCore(Column.BeamStart),
+                                   Strengths.GetData());
+    int32 Strongest = 0;
+    for (int32 i = 1; i < Hits.Num(); i++) {
+        if (Strengths[i] > Strengths[Strongest]) Strongest = i;
+    }
+    const int32 Last = Hits.Num() - 1;
+
+    int32 FirstReturn = Strongest;
+    int32 SecondReturn = INDEX_NONE;
+    if (ReturnMode == ELidarReturnMode::Last) {
+        FirstReturn = Last;
+    } else if (ReturnMode == ELidarReturnMode::Dual) {
+        SecondReturn = Last;
+        if (Last == Strongest) {
+            SecondReturn = INDEX_NONE;
+            for (int32 i = 0; i < Last; i++) {
+                if (SecondReturn == INDEX_NONE || Strengths[i] > Strengths[SecondReturn]) {
+                    SecondReturn = i;
+                }
+            }
+        }
+    }
+
+    // The second return is stored as a miss here, and filled in below if there is one
+    const FHitResult &FirstHit = Hits[FirstReturn];
+    StoreLidarPoint(Column, BeamIndex, true, FirstHit.ImpactPoint, FirstHit.ImpactNormal,
+                    FirstHit.Distance, Surfaces[FirstReturn].Reflectivity, FirstHit.Component,
+                    TraceEnd);
+    FLidarPointCloud &Cloud = *Column.Cloud;
+    Cloud.SetReturnIndex(Column.FirstPoint + BeamIndex, FirstReturn);
+    if (SecondReturn != INDEX_NONE) {
+        const FHitResult &SecondHit = Hits[SecondReturn];
+        const int32 PointIndex = Column.FirstPoint + NumBeams + BeamIndex;
+        SensorModel.StoreReturn(Cloud, PointIndex, FLidarCoreConversions::ToCore(Column.BeamStart),
+                                FLidarCoreConversions::ToCore(SecondHit.ImpactPoint),
+                                FLidarCoreConversions::ToCore(SecondHit.ImpactNormal),
+                                SecondHit.Distance);
+        Cloud.Intensity[PointIndex] = 255.f * Surfaces[SecondReturn].Reflectivity;
+        Cloud.Flags[PointIndex] |= FLidarPointCloud::PointSecondReturn;
+        Cloud.SetReturnIndex(PointIndex, SecondReturn);
+        if (Column.PointComponents) {
+            Column.PointComponents[NumBeams + BeamIndex] = SecondHit.Component;
+        }
+    }
+
+    // The cache only keeps one surface, so a beam that passed through any is traced again
+    const FHitResult &LastHit = Hits[Last];
+    const UPrimitiveComponent* Component = LastHit.GetComponent();
+    CacheLidarHit(Column, BeamIndex, LastHit.bBlockingHit, LastHit.ImpactPoint,
+                  LastHit.ImpactNormal, LastHit.Distance, Surfaces[Last].Reflectivity,
+                  LastHit.Component,
+                  Hits.Num() > 1 || !LastHit.bBlockingHit ||
+                          (Component && Component->Mobility == EComponentMobility::Movable));
+}
+
+// How much of the beam a surface lets through, from its physical material if that is tagged
+float ASpinningLidarSensorActor::GetTransmittance(const FHitResult &Hit) const {
+    if (const float* Transmittance = TransmissiveMaterials.Find(Hit.PhysMaterial.Get())) {
+        return FMath::Clamp(*Transmittance, 0.f, 1.f);
+    }
+    return Hit.bBlockingHit ? 0.f : OverlapTransmittance;
+}
+
+// How much of the beam a surface reflects, from its physical material
+float ASpinningLidarSensorActor::GetReflectivity(const UPhysicalMaterial* PhysicalMaterial) const {
+    const float* Reflectivity = Reflectivities.Find(PhysicalMaterial);
+    return Reflectivity ? *Reflectivity : DefaultReflectivity;
+}
+
+// Remember one beam's trace, if hits are being reused.
+// Each beam has its own cache entry, so this is safe from any thread.
+void ASpinningLidarSensorActor::CacheLidarHit(const FLidarScanColumn &Column, int32 BeamIndex,
+                                              bool bBlockingHit, const FVector &ImpactPoint,
+                                              const FVector &ImpactNormal, float Distance,
+                                              float Reflectivity,
+                                              const TWeakObjectPtr<UPrimitiveComponent> &Component,
+                                              bool bMovable) {
+    if (!Column.bCacheHits) return;
+    FLidarCachedHit &Cached = CachedHits[Column.RevolutionColumn * NumBeams + BeamIndex];
+    Cached.ImpactPoint = ImpactPoint;
+    Cached.ImpactNormal = ImpactNormal;
+    Cached.Distance = Distance;
+    Cached.Reflectivity = Reflectivity;
+    Cached.Component = Component;
+    Cached.bBlockingHit = bBlockingHit;
+    Cached.bMovable = bMovable;
+}
 
-    // Perform the raycast
-    GetWorld()->LineTraceSingleByChannel(
-                Hit,
-                BeamStart,
-                BeamEnd,
-                ECollisionChannel::ECC_Visibility,
-                RaycastParameters);
+// Store one beam as a point in its column's cloud, before the return model is applied, with
+// the intensity of a perpendicular return from its surface and, if labels are written, the
+// component it hit.
+// In dual-return mode its second return is stored as a miss.
+void ASpinningLidarSensorActor::StoreLidarPoint(const FLidarScanColumn &Column, int32 BeamIndex,
+                                                bool bBlockingHit, const FVector &ImpactPoint,
+                                                const FVector &ImpactNormal, float Distance,
+                                                float Reflectivity,
+                                                const TWeakObjectPtr<UPrimitiveComponent> &Component,
+                                                const FVector &TraceEnd) {
+    FLidarPointCloud &Cloud = *Column.Cloud;
+    const int32 PointIndex = Column.FirstPoint + BeamIndex;
+    if (bBlockingHit) {
+        SensorModel.StoreReturn(Cloud, PointIndex, FLidarCoreConversions::ToCore(Column.BeamStart),
+                                FLidarCoreConversions::ToCore(ImpactPoint),
+                                FLidarCoreConversions::ToCore(ImpactNormal), Distance);
+        Cloud.Intensity[PointIndex] = 255.f * Reflectivity;
+    } else {
+        SensorModel.StoreMiss(Cloud, PointIndex, FLidarCoreConversions::ToCore(TraceEnd));
+    }
+    const double FiringTime = Column.Timestamp + BeamIndex * BeamFiringIntervalSeconds;
+    Cloud.SetFiring(PointIndex, FiringTime, BeamIndex, Column.RevolutionColumn);
+
+    if (PointsPerColumn > NumBeams) {
+        const int32 SecondPointIndex = PointIndex + NumBeams;
+        SensorModel.StoreMiss(Cloud, SecondPointIndex, FLidarCoreConversions::ToCore(TraceEnd));
+        Cloud.Flags[SecondPointIndex] = FLidarPointCloud::PointSecondReturn;
+        Cloud.SetFiring(SecondPointIndex, FiringTime, BeamIndex, Column.RevolutionColumn);
+    }
+
+    // Each beam has its own slots, so this is safe from any thread
+    if (Column.PointComponents) {
+        Column.PointComponents[BeamIndex] = bBlockingHit ? Component : nullptr;
+        if (PointsPerColumn > NumBeams) Column.PointComponents[BeamIndex + NumBeams] = nullptr;
+    }
+}
+
+// Apply the return model to a traced batch and write it out
+void ASpinningLidarSensorActor::FinishLidarBatch(FLidarTraceBatch &Batch) {
+    if (Batch.PointComponents.Num() > 0) LabelColumns(Batch);
 
     // Simulate the probability that there will be no return signal received for some hits,
     // especially near max range.
-    // If the hit does not return due to this probability, set Hit.bBlockingHit to false.
-    RandomizeWhetherHitReturns(Hit);
-
-
-
-    return Hit;
-}
-
-// Input a lidar hit and a bitmap of the render texture showing the lidar's view.
-// The color and intensity of the hit are out parameters.
-void ASpinningLidarSensorActor::GetLidarPointIntensity(FHitResult &Hit,
-                                                       TArray<FColor> &ImageBitmap,
-                                                       TSharedPtr<FSceneView> SceneView,
-                                                       FColor &OutPointColorFromScene,
-                                                       float &OutHitIntensity) {
-    OutHitIntensity = 0.f;
-    if (Hit.bBlockingHit) {
-        // Find the texture coordinates at this location
-        int32 TextureWidth = SceneCap->TextureTarget->SizeX;
-        int32 TextureHeight = SceneCap->TextureTarget->SizeY;
-        FVector2D PixelLocation;
-        SceneView->WorldToPixel(Hit.ImpactPoint, PixelLocation);
-        int32 PixelX = PixelLocation.X;
-        int32 PixelY = PixelLocation.Y;
-
-        // NOTE: if no base color can be found for a lidar point,
-        // the intensity will remain at zero by default.
-        // This issue should only happen if the difference between max and min beam elevation
-        // is greater than the field of view for the scene capture component.
-        if ((TextureWidth*(PixelY)+PixelX) < ImageBitmap.Num()) {
-            // Determine color value at the hit location on the surface
-            FColor BaseColor = ImageBitmap[TextureWidth*(PixelY)+PixelX];
-
-            // Set intensity based on the red channel, as an approximation for infrared
-            OutHitIntensity = (float)BaseColor.R;
-        }
-
-        // The magnitude of the effect of angle of incidence is adjustable in the editor,
-        // for efficiency of refining the model to match real data.
-        // multiply by a factor based on angle of incidence,
-        // so that returns are brightest when the beam is perpendicular to the surface.
-        FVector BeamUnitVector = UKismetMathLibrary::GetDirectionUnitVector(GetActorLocation()
-                                                           + GetActorUpVector()*BeamStartRelativeZ,
-                                                           Hit.ImpactPoint);
-        OutHitIntensity *= IntensityAffectedByAngle *
-                FVector::DotProduct(-BeamUnitVector, Hit.ImpactNormal) +
-                (1.f- IntensityAffectedByAngle);
-
-        // Set the lidar point color for visualization on a scale from red to green
-        // where green is most intense and red is least.
-        if (bVisualizeIntensity) OutPointColorFromScene =
-                FColor::MakeRedToGreenColorFromScalar(OutHitIntensity / 255.f);
-    }
-}
-
-// Visualize the beam and any impact point it has
-void ASpinningLidarSensorActor::VisualizeBeam(FHitResult &Hit, FColor &PointColorFromScene) {
-    // For visualization, determine whether to draw the beam ending
-    // at the impact point or at max range
-    FVector LidarPoint = Hit.TraceEnd;
-    if (Hit.bBlockingHit) LidarPoint = Hit.ImpactPoint;
-
-    // visualize the beam
-    DrawDebugLine(
-                GetWorld(),
-                Hit.TraceStart,
-                LidarPoint,
-                BeamColor,
-                false,
-                0.0f,
-                0.0f,
-                BeamThickness);
-
-    // visualize the point where the beam hits something, if it hits something
-    if (Hit.bBlockingHit) {
-        DrawDebugPoint(
-                    GetWorld(),
-                    LidarPoint,
-                    LidarPointSize,
-                    PointColorFromScene,  // PointColor,
-                    false,
-                    PointLifetime);
+    // If the hit does not return due to this probability, its point is marked as a miss.
+    {
+        LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarRandomizeReturns);
+        FLidarScopedTimer RandomizeReturnsTimer(RevolutionPerf.RandomizeReturnsSeconds);
+        // Each column draws its own random numbers from the noise model, so columns can be
+        // processed on any thread in any order with the same result
+        TArray<int32, TInlineAllocator<64>> ColumnHits;
+        ColumnHits.SetNumUninitialized(Batch.Columns.Num());
+        ParallelFor(Batch.Columns.Num(), [this, &Batch, &ColumnHits](int32 ColumnIndex) {
+            const FLidarScanColumn &Column = Batch.Columns[ColumnIndex];
+            ColumnHits[ColumnIndex] = SensorModel.ApplyDropout(*Column.Cloud, Column.FirstPoint,
+                                                               PointsPerColumn, Column.Revolution,
+                                                               Column.RevolutionColumn);
+        }, !IsTracedByScanManager());
+
+        int32 NumHits = 0;
+        for (const int32 Hits : ColumnHits) {
+            NumHits += Hits;
+        }
+        INC_DWORD_STAT_BY(STAT_LidarHits, NumHits);
+        RevolutionPerf.Hits += NumHits;
+    }
+
+    // Write the results from all beams to file
+    WriteLidarPointsToFile(Batch);
+
+    // Columns traced again in full are cached at the pose they were traced from
+    for (const FLidarScanColumn &Column : Batch.Columns) {
+        if (!Column.bCacheHits) continue;
+        FLidarCachedColumn &CachedColumn = CachedColumns[Column.RevolutionColumn];
+        if (!CachedColumn.bValid) {
+            CachedColumn.BeamStart = Column.BeamStart;
+            CachedColumn.BeamRotation = Column.BeamTransform.GetRotation();
+            CachedColumn.bValid = true;
+        }
+    }
+
+    // A revolution's cloud is complete once its last column has been written
+    for (const FLidarScanColumn &Column : Batch.Columns) {
+        if (Column.RevolutionColumn == ColumnsPerRevolution - 1) {
+            CompleteRevolution(Column.Cloud);
+        }
+    }
+}
+
+// Label each point of a batch with the ids of the component it hit, and write the dictionary
+// entries of the instances and classes hit for the first time
+void ASpinningLidarSensorActor::LabelColumns(const FLidarTraceBatch &Batch) {
+    LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarLabels);
+    for (const FLidarScanColumn &Column : Batch.Columns) {
+        FLidarPointCloud &Cloud = *Column.Cloud;
+        Cloud.bLabeled = true;
+
+        // Neighbouring beams mostly hit the same component, or nothing, so runs of them only
+        // look it up once
+        TWeakObjectPtr<UPrimitiveComponent> LastComponent;
+        FLidarPointLabel Label;
+        for (int32 i = 0; i < PointsPerColumn; i++) {
+            const TWeakObjectPtr<UPrimitiveComponent> &Component = Column.PointComponents[i];
+            if (!(Component == LastComponent)) {
+                Label = GetComponentLabel(Component);
+                LastComponent = Component;
+            }
+            Cloud.InstanceId[Column.FirstPoint + i] = Label.InstanceId;
+            Cloud.ClassId[Column.FirstPoint + i] = Label.ClassId;
+        }
+    }
+
+    if (LabelWriter && LabelDictionary.HasNewEntries()) {
+        TArray<uint8> Buffer = LabelWriter->AcquireBuffer();
+        FLidarTArrayByteSink Sink(Buffer);
+        LabelDictionary.AppendNewEntries(StringCast<ANSICHAR>(LINE_TERMINATOR).Get(), Sink);
+        LabelWriter->Submit(MoveTemp(Buffer));
+    }
+}
+
+// The labels of the points on a component. Every component of an actor is the same instance,
+// and each is resolved once, then found in the cache.
+ASpinningLidarSensorActor::FLidarPointLabel ASpinningLidarSensorActor::GetComponentLabel(
+        const TWeakObjectPtr<UPrimitiveComponent> &Component) {
+    if (const FLidarPointLabel* CachedLabel = ComponentLabels.Find(Component)) {
+        return *CachedLabel;
+    }
+
+    FLidarPointLabel Label;
+    const UPrimitiveComponent* HitComponent = Component.Get();
+    AActor* Actor = HitComponent ? HitComponent->GetOwner() : nullptr;
+    if (!Actor) return Label;
+    const uint32* InstanceId = ActorInstanceIds.Find(Actor);
+    if (!InstanceId) {
+        const uint16 ClassId = LabelDictionary.FindOrAddClass(
+                std::string(TCHAR_TO_UTF8(*GetLabelClassName(Actor))));
+        InstanceId = &ActorInstanceIds.Add(Actor, LabelDictionary.AddInstance(
+                std::string(TCHAR_TO_UTF8(*Actor->GetName())), ClassId));
+    }
+    Label.InstanceId = *InstanceId;
+    Label.ClassId = LabelDictionary.GetInstanceClass(*InstanceId);
+    ComponentLabels.Add(Component, Label);
+    return Label;
+}
+
+// The class of an actor: from a tag starting with ClassTagPrefix, otherwise from LabelClasses
+// by one of its tags, then by its actor class
+FString ASpinningLidarSensorActor::GetLabelClassName(const AActor* Actor) const {
+    if (!ClassTagPrefix.IsEmpty()) {
+        for (const FName &Tag : Actor->Tags) {
+            const FString TagName = Tag.ToString();
+            if (TagName.StartsWith(ClassTagPrefix)) return TagName.RightChop(ClassTagPrefix.Len());
+        }
+    }
+    for (const FName &Tag : Actor->Tags) {
+        if (const FString* ClassName = LabelClasses.Find(Tag)) return *ClassName;
+    }
+    const FString* ClassName = LabelClasses.Find(Actor->GetClass()->GetFName());
+    return ClassName ? *ClassName : FString();
+}
+
+// Write out a finished revolution, then publish it to consumers or hand its cloud back to the pool
+void ASpinningLidarSensorActor::CompleteRevolution(FLidarPointCloud* Cloud, bool bPublish) {
+    if (!Cloud) return;
+    if (FLidarPointCloudFormats::IsPerRevolution(OutputFormat)) WriteRevolutionFile(*Cloud);
+    if (OutputFormat == ELidarOutputFormat::RangeImage) WriteRangeImageFrame(*Cloud);
+    if (OutputFormat == ELidarOutputFormat::Recording) WriteRecordingFrame(*Cloud);
+    if (bPublish) {
+        PublishRevolution(Cloud);
+    } else {
+        PointCloudPool.Release(Cloud);
+    }
+}
+
+// Make a revolution the latest one, retiring the oldest published revolution to the pool
+void ASpinningLidarSensorActor::PublishRevolution(FLidarPointCloud* Cloud) {
+    PublishedClouds.Add(Cloud);
+    while (PublishedClouds.Num() > FMath::Max(1, PublishedRevolutionBuffers)) {
+        PointCloudPool.Release(PublishedClouds[0]);
+        PublishedClouds.RemoveAt(0, 1, false);
+    }
+
+    if (SharedMemoryRing.IsOpen()) SharedMemoryRing.Publish(*Cloud);
+    OnRevolutionCompletedNative.Broadcast(this, *Cloud);
+    OnRevolutionCompleted.Broadcast(this, Cloud->Revolution);
+}
+
+const FLidarPointCloud* ASpinningLidarSensorActor::GetLatestRevolution() const {
+    return PublishedClouds.Num() > 0 ? PublishedClouds.Last() : nullptr;
+}
+
+int32 ASpinningLidarSensorActor::GetLatestRevolutionIndex() const {
+    const FLidarPointCloud* Cloud = GetLatestRevolution();
+    return Cloud ? Cloud->Revolution : -1;
+}
+
+void ASpinningLidarSensorActor::SetSaveDirectory(const FString &Directory) {
+    SaveFilePath = FPaths::Combine(Directory, FPaths::GetCleanFilename(
+            SaveFilePath.IsEmpty() ? SaveFileName : SaveFilePath));
+}
+
+bool ASpinningLidarSensorActor::GetLatestRevolutionPoints(TArray<FVector> &OutPoints,
+                                                          TArray<float> &OutIntensities) const {
+    OutPoints.Reset();
+    OutIntensities.Reset();
+    const FLidarPointCloud* Cloud = GetLatestRevolution();
+    if (!Cloud) return false;
+
+    const int32 NumReturns = Cloud->CountReturns();
+    OutPoints.Reserve(NumReturns);
+    OutIntensities.Reserve(NumReturns);
+    for (int32 i = 0; i < Cloud->Num(); i++) {
+        if (!Cloud->HasReturn(i)) continue;
+        OutPoints.Add(FLidarCoreConversions::ToEngine(Cloud->GetPosition(i)));
+        OutIntensities.Add(Cloud->Intensity[i]);
+    }
+    return true;
+}
+
+void ASpinningLidarSensorActor::UpdateMeasuredRaysPerSecond(int32 NumRays, double TraceSeconds) {
+    if (NumRays <= 0 || TraceSeconds <= 0.0) return;
+
+    // Exponential moving average, so that the figure is steady enough to read in the editor
+    const float RaysPerSecond = NumRays / TraceSeconds;
+    MeasuredRaysPerSecond = (MeasuredRaysPerSecond > 0.f)
+            ? FMath::Lerp(MeasuredRaysPerSecond, RaysPerSecond, 0.1f)
+            : RaysPerSecond;
+}
+
+// Write one line of the perf report summarizing a completed revolution, then start the next
+void ASpinningLidarSensorActor::WritePerfReport(int32 Revolution) {
+    const double NowSeconds = FPlatformTime::Seconds();
+    const double RealSeconds = NowSeconds - RevolutionPerf.StartRealTimeSeconds;
+    // The revolution ends when the first column of the next one fires
+    const double SimTimeSeconds =
+            ScanClock.GetFiringTimeSeconds((int64)(Revolution + 1) * ColumnsPerRevolution);
+    const int64 BytesWritten = OutputWriter ? OutputWriter->GetBytesWritten() : 0;
+    const int64 RevolutionBytes = BytesWritten - RevolutionPerf.StartBytesWritten;
+    const int32 QueueDepth = OutputWriter ? OutputWriter->GetQueueDepth() : 0;
+    INC_DWORD_STAT_BY(STAT_LidarBytesWritten, RevolutionBytes);
+
+    if (PerfReportWriter) {
+        const double RaysPerSecond = RevolutionPerf.RaycastsSeconds > 0.0
+                ? RevolutionPerf.Rays / RevolutionPerf.RaycastsSeconds : 0.0;
+        if (PerfReportFormat == ELidarPerfReportFormat::CSV) {
+            WritePerfReportLine(FString::Printf(
+                    TEXT("%d,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%lld,%lld,%lld,%f,%d"),
+                    Revolution, SimTimeSeconds, RealSeconds,
+                    RevolutionPerf.TickSeconds * 1000.0,
+                    RevolutionPerf.BuildRaysSeconds * 1000.0,
+                    RevolutionPerf.RaycastsSeconds * 1000.0,
+                    RevolutionPerf.RandomizeReturnsSeconds * 1000.0,
+                    RevolutionPerf.RangeNoiseSeconds * 1000.0,
+                    RevolutionPerf.IntensitySeconds * 1000.0,
+                    RevolutionPerf.VisualizeSeconds * 1000.0,
+                    RevolutionPerf.FilterSeconds * 1000.0,
+                    RevolutionPerf.SerializeSeconds * 1000.0,
+                    RevolutionPerf.Rays, RevolutionPerf.Hits, RevolutionBytes,
+                    RaysPerSecond, QueueDepth));
+        } else {
+            WritePerfReportLine(FString::Printf(
+                    TEXT("{\"revolution\":%d,\"sim_time_s\":%f,\"real_time_s\":%f,"
+                         "\"tick_ms\":%f,\"build_rays_ms\":%f,\"raycasts_ms\":%f,"
+                         "\"randomize_returns_ms\":%f,\"range_noise_ms\":%f,"
+                         "\"intensity_ms\":%f,\"visualize_ms\":%f,\"filter_ms\":%f,"
+                         "\"serialize_ms\":%f,"
+                         "\"rays\":%lld,\"hits\":%lld,\"bytes_written\":%lld,"
+                         "\"rays_per_second\":%f,\"writer_queue_depth\":%d}"),
+                    Revolution, SimTimeSeconds, RealSeconds,
+                    RevolutionPerf.TickSeconds * 1000.0,
+                    RevolutionPerf.BuildRaysSeconds * 1000.0,
+                    RevolutionPerf.RaycastsSeconds * 1000.0,
+                    RevolutionPerf.RandomizeReturnsSeconds * 1000.0,
+                    RevolutionPerf.RangeNoiseSeconds * 1000.0,
+                    RevolutionPerf.IntensitySeconds * 1000.0,
+                    RevolutionPerf.VisualizeSeconds * 1000.0,
+                    RevolutionPerf.FilterSeconds * 1000.0,
+                    RevolutionPerf.SerializeSeconds * 1000.0,
+                    RevolutionPerf.Rays, RevolutionPerf.Hits, RevolutionBytes,
+                    RaysPerSecond, QueueDepth));
+        }
+    }
+
+    TotalRays += RevolutionPerf.Rays;
+    TotalHits += RevolutionPerf.Hits;
+    RevolutionPerf = FLidarRevolutionPerf();
+    RevolutionPerf.StartRealTimeSeconds = NowSeconds;
+    RevolutionPerf.StartBytesWritten = BytesWritten;
+}
+
+void ASpinningLidarSensorActor::WritePerfReportLine(const FString &Line) {
+    const FString StringToWrite = Line + LINE_TERMINATOR;
+    TArray<uint8> Buffer = PerfReportWriter->AcquireBuffer();
+    Buffer.Append((const uint8*)TCHAR_TO_ANSI(*StringToWrite), StringToWrite.Len());
+    PerfReportWriter->Submit(MoveTemp(Buffer));
+}
+
+void ASpinningLidarSensorActor::WriteLidarPointsToFile(const FLidarTraceBatch &Batch) {
+    // Scale the intensity of each return by its angle of incidence, so that returns are
+    // brightest when the beam is perpendicular to the surface
+    {
+        LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarIntensity);
+        FLidarScopedTimer IntensityTimer(RevolutionPerf.IntensitySeconds);
+        ParallelFor(Batch.Columns.Num(), [this, &Batch](int32 ColumnIndex) {
+            const FLidarScanColumn &Column = Batch.Columns[ColumnIndex];
+            SensorModel.ApplyIntensity(*Column.Cloud, Column.FirstPoint, PointsPerColumn);
+        }, !IsTracedByScanManager());
+    }
+
+    // Add Gaussian range noise based on angle of incidence
+    {
+        LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarRangeNoise);
+        FLidarScopedTimer RangeNoiseTimer(RevolutionPerf.RangeNoiseSeconds);
+        ParallelFor(Batch.Columns.Num(), [this, &Batch](int32 ColumnIndex) {
+            const FLidarScanColumn &Column = Batch.Columns[ColumnIndex];
+            SensorModel.ApplyRangeNoise(*Column.Cloud, Column.FirstPoint, PointsPerColumn,
+                                        FLidarCoreConversions::ToCore(Column.BeamStart),
+                                        Column.Revolution, Column.RevolutionColumn);
+        }, !IsTracedByScanManager());
+    }
+
+    // Gather the points to visualize while they are still in world space
+    if (bRendering && VisualizationPointBudget > 0) {
+        LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarVisualize);
+        FLidarScopedTimer VisualizeTimer(RevolutionPerf.VisualizeSeconds);
+        VisualizeColumns(Batch);
+    }
+
+    // Remove the points that aren't to be written. The voxel grid keeps the first return to
+    // reach each voxel, so the columns go through in firing order.
+    if (PointFilter.IsEnabled()) {
+        LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarFilter);
+        FLidarScopedTimer FilterTimer(RevolutionPerf.FilterSeconds);
+        for (const FLidarScanColumn &Column : Batch.Columns) {
+            PointFilter.Apply(*Column.Cloud, Column.FirstPoint, PointsPerColumn,
+                              FLidarCoreConversions::ToCore(Column.ActorTransform));
+        }
+    }
+
+    LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarSerialize);
+    FLidarScopedTimer SerializeTimer(RevolutionPerf.SerializeSeconds);
+
+    // Move the points into the frame they are written in, in place.
+    // If the user has chosen to use the sensor's local coordinates, transform into this frame.
+    // Beams that don't hit anything return 0 for x, y, and z.
+    for (const FLidarScanColumn &Column : Batch.Columns) {
+        FLidarSensorModel::TransformToOutputFrame(
+                    *Column.Cloud, Column.FirstPoint, PointsPerColumn,
+                    FLidarCoreConversions::ToCore(Column.ActorTransform), bUseLocalCoordinates);
+    }
+
+    if (OutputFormat == ELidarOutputFormat::VelodynePcap || VelodyneUdpSender.IsOpen()) {
+        WriteVelodynePackets(Batch);
+    }
+
+    // The binary formats are written a revolution at a time, once each cloud is complete
+    if (OutputFormat != ELidarOutputFormat::CSV || !OutputWriter || !OutputWriter->IsOpen()) {
+        return;
+    }
+
+    // Serialize the points into one batch for the writer thread.
+    // Each row starts with the time in seconds since the simulation began at which its column
+    // was fired.
+    TArray<uint8> Buffer = OutputWriter->AcquireBuffer();
+    FLidarTArrayByteSink Sink(Buffer);
+    const auto LineTerminator = StringCast<ANSICHAR>(LINE_TERMINATOR);
+    for (const FLidarScanColumn &Column : Batch.Columns) {
+        CsvWriter.Append(*Column.Cloud, Column.FirstPoint, PointsPerColumn, LineTerminator.Get(),
+                         Sink);
+
+        // display sensor data in log for debugging
+#if SPINNING_LIDAR_POINT_LOGGING
+        for (int32 PointIndex = Column.FirstPoint;
+             PointIndex < Column.FirstPoint + PointsPerColumn; PointIndex++) {
+            UE_LOG(LogSpinningLidar, VeryVerbose, TEXT("Impact Point: %s, Timestamp: %s"),
+                   *FLidarCoreConversions::ToEngine(
+                           Column.Cloud->GetPosition(PointIndex)).ToString(),
+                   *FString::SanitizeFloat(Column.Cloud->Time[PointIndex]));
+        }
+#endif
+    }
+    OutputWriter->Submit(MoveTemp(Buffer));
+}
+
+// Pack the batch's columns into Velodyne packets, one firing block per column.
+// The last packet of a batch is usually only partly filled, and is completed by the next batch.
+void ASpinningLidarSensorActor::WriteVelodynePackets(const FLidarTraceBatch &Batch) {
+    const bool bWritePcap = OutputFormat == ELidarOutputFormat::VelodynePcap && OutputWriter &&
+            OutputWriter->IsOpen();
+    TArray<uint8> Buffer;
+    if (bWritePcap) Buffer = OutputWriter->AcquireBuffer();
+    for (const FLidarScanColumn &Column : Batch.Columns) {
+        // Packets are in strongest-return mode, so only the first return of each beam is sent
+        if (VelodynePackets.AddColumn(*Column.Cloud, Column.FirstPoint, NumBeams,
+                                      Column.Azimuth)) {
+            EmitVelodynePacket(bWritePcap ? &Buffer : nullptr);
+        }
+    }
+    if (Buffer.Num() > 0) OutputWriter->Submit(MoveTemp(Buffer));
+}
+
+// Send out the partly filled last packet at the end of the session
+void ASpinningLidarSensorActor::FlushVelodynePackets() {
+    if (!VelodynePackets.Flush()) return;
+    const bool bWritePcap = OutputFormat == ELidarOutputFormat::VelodynePcap && OutputWriter &&
+            OutputWriter->IsOpen();
+    TArray<uint8> Buffer;
+    EmitVelodynePacket(bWritePcap ? &Buffer : nullptr);
+    if (Buffer.Num() > 0) OutputWriter->Submit(MoveTemp(Buffer));
+}
+
+// Append the packet just completed to the pcap buffer and send it over UDP
+void ASpinningLidarSensorActor::EmitVelodynePacket(TArray<uint8>* PcapBuffer) {
+    if (PcapBuffer) {
+        PcapBuffer->Append(VelodynePackets.GetPcapRecord(),
+                           FLidarVelodynePacketEncoder::PcapRecordSize);
+    }
+    if (VelodyneUdpSender.IsOpen()) {
+        VelodyneUdpSender.Send(VelodynePackets.GetPayload(),
+                               FLidarVelodynePacketEncoder::PayloadSize);
+    }
+}
+
+// Serialize the returns of one revolution into their own file
+void ASpinningLidarSensorActor::WriteRevolutionFile(const FLidarPointCloud &Cloud) {
+    if (Cloud.CountReturns() > 0 && OutputWriter && OutputWriter->IsOpen()) {
+        const FString RevolutionFilePath = FPaths::GetBaseFilename(SaveFilePath, false) +
+                FString::Printf(TEXT("_%06d"), Cloud.Revolution) +
+                FLidarPointCloudFormats::GetFileExtension(OutputFormat);
+
+        LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarSerialize);
+        FLidarScopedTimer SerializeTimer(RevolutionPerf.SerializeSeconds);
+        TArray<uint8> Buffer = OutputWriter->AcquireBuffer();
+        FLidarPointCloudFormats::AppendRevolutionFile(OutputFormat, Cloud, Buffer);
+        OutputWriter->Submit(MoveTemp(Buffer), RevolutionFilePath);
+
+        // SemanticKITTI keeps the labels of a revolution in a file of their own
+        if (Cloud.bLabeled && OutputFormat == ELidarOutputFormat::KITTIBin) {
+            TArray<uint8> LabelBuffer = OutputWriter->AcquireBuffer();
+            FLidarTArrayByteSink Sink(LabelBuffer);
+            FLidarCloudSerializers::AppendKittiLabels(Cloud, Sink);
+            OutputWriter->Submit(MoveTemp(LabelBuffer),
+                                 FPaths::ChangeExtension(RevolutionFilePath, TEXT(".label")));
+        }
+    }
+}
+
+// Quantize a revolution into a range image and append it to the range image file as a frame
+void ASpinningLidarSensorActor::WriteRangeImageFrame(const FLidarPointCloud &Cloud) {
+    if (!OutputWriter || !OutputWriter->IsOpen()) return;
+
+    LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarSerialize);
+    FLidarScopedTimer SerializeTimer(RevolutionPerf.SerializeSeconds);
+    const std::vector<uint8_t> &Image = RangeImage.BuildImage(Cloud);
+    const double StartTime = Cloud.Num() > 0 ? Cloud.Time[0] : 0.0;
+
+    // Frames that zlib can't shrink are stored as they are
+    ELidarRangeImageCompression Compression = ELidarRangeImageCompression::None;
+    const uint8* Stored = Image.data();
+    int32 StoredSize = (int32)Image.size();
+    if (bCompressRangeImage) {
+        int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, StoredSize);
+        RangeImageStorage.SetNumUninitialized(CompressedSize, false);
+        if (FCompression::CompressMemory(NAME_Zlib, RangeImageStorage.GetData(), CompressedSize,
+                                         Image.data(), StoredSize, COMPRESS_BiasSpeed) &&
+            CompressedSize < StoredSize) {
+            Compression = ELidarRangeImageCompression::Zlib;
+            Stored = RangeImageStorage.GetData();
+            StoredSize = CompressedSize;
+        }
+    }
+
+    TArray<uint8> Buffer = OutputWriter->AcquireBuffer();
+    FLidarTArrayByteSink Sink(Buffer);
+    RangeImage.AppendFrame(Cloud.Revolution, StartTime, Compression, Stored,
+                           (uint32_t)StoredSize, Sink);
+    OutputWriter->Submit(MoveTemp(Buffer));
+}
+
+// Append a revolution to the recording file as a frame, every beam of it as it is in the cloud
+void ASpinningLidarSensorActor::WriteRecordingFrame(const FLidarPointCloud &Cloud) {
+    if (!OutputWriter || !OutputWriter->IsOpen()) return;
+
+    LIDAR_SCOPE_CYCLE_COUNTER(STAT_LidarSerialize);
+    FLidarScopedTimer SerializeTimer(RevolutionPerf.SerializeSeconds);
+    TArray<uint8> Buffer = OutputWriter->AcquireBuffer();
+    FLidarTArrayByteSink Sink(Buffer);
+    Recording.AppendFrame(Cloud, Sink);
+    OutputWriter->Submit(MoveTemp(Buffer));
+}
+
+// Add the decimated beams of each column to the revolution being visualized, and hand the
+// revolution to the visualizer once its last column is in. Only the gathered points are
+// colored, so the cost follows the point budget rather than the sensor's resolution.
+void ASpinningLidarSensorActor::VisualizeColumns(const FLidarTraceBatch &Batch) {
+    for (int32 ColumnIndex = 0; ColumnIndex < Batch.Columns.Num(); ColumnIndex++) {
+        const FLidarScanColumn &Column = Batch.Columns[ColumnIndex];
+        if (Column.RevolutionColumn % VisualColumnStride == 0) {
+            const FLidarPointCloud &Cloud = *Column.Cloud;
+            for (int32 i = 0; i < NumBeams; i += VisualBeamStride) {
+                const int32 PointIndex = Column.FirstPoint + i;
+                FLidarVisualPoint &Point =
+                        PendingVisualPoints[PendingVisualPoints.AddUninitialized()];
+                Point.BeamStart = Column.BeamStart;
+                Point.bReturned = Cloud.HasReturn(PointIndex);
+                Point.Position = Point.bReturned
+                        ? FLidarCoreConversions::ToEngine(Cloud.GetPosition(PointIndex))
+                        : Batch.RayEnds[ColumnIndex * NumBeams + i];
+                Point.Color = Point.bReturned
+                        ? GetVisualPointColor(Point, Cloud.Intensity[PointIndex]) : BeamColor;
+            }
+        }
+        if (Column.RevolutionColumn == ColumnsPerRevolution - 1) {
+            // Swapping hands back the previous revolution's array, to refill without allocating
+            Visualizer->SetPoints(PendingVisualPoints);
+            PendingVisualPoints.Reset();
+        }
+    }
+}
+
+// The color of a returned point in the chosen color mode
+FColor ASpinningLidarSensorActor::GetVisualPointColor(const FLidarVisualPoint &Point,
+                                                      float Intensity) const {
+    switch (PointColorMode) {
+    case ELidarPointColorMode::Intensity:
+        return FColor::MakeRedToGreenColorFromScalar(Intensity / 255.f);
+    case ELidarPointColorMode::Height: {
+        // From red at HeightColorMax down to blue at HeightColorMin
+        const float Height = Point.Position.Z - Point.BeamStart.Z;
+        const float Alpha = FMath::Clamp(
+                (Height - HeightColorMin) / FMath::Max(HeightColorMax - HeightColorMin, 1.f),
+                0.f, 1.f);
+        return FLinearColor::MakeFromHSV8((uint8)((1.f - Alpha) * 170.f), 255, 255)
+                .ToFColor(false);
+    }
+    default:
+        return PointColor;
     }
 }
 
 #ifdef ConfigurationPluginIncluded
 bool ASpinningLidarSensorActor::SetParamsFromYaml(UDocumentNode* SpinningLidarNode) {
     // TODO(future): expose velodyne specific parameters to be read in from yaml too
-    // TODO(future): add ground truth
     // TODO(future): make saving csv a toggle - true/false
 
     Error.Empty();
@@ -453,6 +1557,58 @@ bool ASpinningLidarSensorActor::SetParamsFromYaml(UDocumentNode* SpinningLidarNo
         Error += UDocumentNode::MissingRequiredFieldError("spinning-lidar.name");
     }
 
+    // check for the sensor profile, which is optional
+    UDocumentNode* SpinningLidarProfileNode;
+    if (SpinningLidarNode->TryGetMapField("profile", SpinningLidarProfileNode)) {
+        const FString ProfileName = SpinningLidarProfileNode->ToString().TrimQuotes();
+        if (SpinningLidarProfileNode->GetType() != "String" ||
+            !FLidarSensorProfiles::ParseProfileName(ProfileName, SensorProfile)) {
+            Error += UDocumentNode::InvalidValueError("spinning-lidar.profile", ProfileName,
+                                                      FLidarSensorProfiles::GetProfileNames());
+        }
+    }
+
+    // check for the return mode, which is optional
+    UDocumentNode* SpinningLidarReturnModeNode;
+    if (SpinningLidarNode->TryGetMapField("return-mode", SpinningLidarReturnModeNode)) {
+        // In the same order as ELidarReturnMode
+        const TArray<FString> ReturnModeNames = {"first", "strongest", "last", "dual"};
+        const FString ReturnModeName = SpinningLidarReturnModeNode->ToString().TrimQuotes();
+        const int32 ReturnModeIndex = ReturnModeNames.Find(ReturnModeName.ToLower());
+        if (SpinningLidarReturnModeNode->GetType() != "String" || ReturnModeIndex == INDEX_NONE) {
+            Error += UDocumentNode::InvalidValueError("spinning-lidar.return-mode", ReturnModeName,
+                                                      ReturnModeNames);
+        } else {
+            ReturnMode = (ELidarReturnMode)ReturnModeIndex;
+        }
+    }
+
+    // check for ground truth labels, which are optional: a list of tag or actor class names
+    // and the classes they label, as in "Vehicle=car, BP_Tree_C=vegetation"
+    UDocumentNode* SpinningLidarLabelsNode;
+    if (SpinningLidarNode->TryGetMapField("labels", SpinningLidarLabelsNode)) {
+        const FString Labels = SpinningLidarLabelsNode->ToString().TrimQuotes();
+        TArray<FString> Entries;
+        Labels.ParseIntoArray(Entries, TEXT(","));
+        bool bValid = SpinningLidarLabelsNode->GetType() == "String";
+        for (const FString &Entry : Entries) {
+            FString Name;
+            FString ClassName;
+            if (Entry.Split(TEXT("="), &Name, &ClassName) && !Name.TrimStartAndEnd().IsEmpty()) {
+                LabelClasses.Add(FName(*Name.TrimStartAndEnd()), ClassName.TrimStartAndEnd());
+            } else {
+                bValid = false;
+            }
+        }
+        if (!bValid) {
+            const TArray<FString> ValidValues = {"<tag or actor class>=<class>, ..."};
+            Error += UDocumentNode::InvalidValueError("spinning-lidar.labels", Labels,
+                                                      ValidValues);
+        } else {
+            bWriteLabels = true;
+        }
+    }
+
     // check for motion
     UDocumentNode* MotionNode;
     bool MotionParamsInitialized = false;
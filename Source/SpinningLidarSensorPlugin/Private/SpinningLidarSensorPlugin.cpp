@@ -1,9 +1,29 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 
 #include "SpinningLidarSensorPlugin.h"
+#include "SpinningLidarStats.h"
 
 #define LOCTEXT_NAMESPACE "FSpinningLidarSensorPluginModule"
 
+DEFINE_LOG_CATEGORY(LogSpinningLidar);
+
+DEFINE_STAT(STAT_LidarTick);
+DEFINE_STAT(STAT_LidarBuildRays);
+DEFINE_STAT(STAT_LidarRaycasts);
+DEFINE_STAT(STAT_LidarLabels);
+DEFINE_STAT(STAT_LidarRandomizeReturns);
+DEFINE_STAT(STAT_LidarRangeNoise);
+DEFINE_STAT(STAT_LidarIntensity);
+DEFINE_STAT(STAT_LidarVisualize);
+DEFINE_STAT(STAT_LidarFilter);
+DEFINE_STAT(STAT_LidarSerialize);
+DEFINE_STAT(STAT_LidarFileIO);
+DEFINE_STAT(STAT_LidarRays);
+DEFINE_STAT(STAT_LidarHits);
+DEFINE_STAT(STAT_LidarReusedHits);
+DEFINE_STAT(STAT_LidarSnapshotFallbackRays);
+DEFINE_STAT(STAT_LidarBytesWritten);
+
 void FSpinningLidarSensorPluginModule::StartupModule() {
     // This code will execute after your module is loaded into memory;
     // the exact timing is specified in the .uplugin file per-module
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SpinningLidarSensorPlugin.h"
+
+#include "LidarBatchCommandlet.generated.h"
+
+#ifdef ConfigurationPluginIncluded
+// Reads a scenario file into its document, or returns null with the reason in the FString
+DECLARE_DELEGATE_RetVal_TwoParams(UDocumentNode*, FLidarReadScenarioFile, const FString&,
+                                  FString&);
+#endif
+
+/*Generates lidar datasets without rendering, as fast as the CPU allows.
+ * Each scenario loads the map afresh, spawns the sensors of its yaml file, and ticks the world
+ * at a fixed timestep for a given simulated time. Nothing is rendered and the sensors don't
+ * visualize their points. Each scenario writes into its own folder, and the commandlet ends
+ * with a throughput summary.
+ *
+ *   UE4Editor-Cmd Project.uproject -run=LidarBatch -Map=/Game/Maps/Town
+ *       -Scenarios=Day.yaml,Night.yaml -Seconds=60 -Fps=20 -OutputDir=/data/lidar -nullrhi
+ *
+ * Without -Scenarios, the map is run once with the sensors placed in it.*/
+UCLASS()
+class SPINNINGLIDARSENSORPLUGIN_API ULidarBatchCommandlet : public UCommandlet {
+    GENERATED_BODY()
+
+ public:
+    ULidarBatchCommandlet();
+
+    int32 Main(const FString &Params) override;
+
+#ifdef ConfigurationPluginIncluded
+    // The project owns the scenario format, so it parses the files. Bind this before the
+    // commandlet runs, e.g. in the StartupModule of the project's module.
+    static FLidarReadScenarioFile ReadScenarioFile;
+#endif
+
+ private:
+    // What one scenario produced, for the summary
+    struct FScenarioResult {
+        FString Name;
+        int32 NumSensors = 0;
+        int32 NumFrames = 0;
+        double SimSeconds = 0.0;
+        double WallSeconds = 0.0;
+        int64 Rays = 0;
+        int64 Hits = 0;
+        int64 Revolutions = 0;
+        int64 BytesWritten = 0;
+    };
+
+    // Load the map, spawn the scenario's sensors, and tick it for NumFrames frames
+    bool RunScenario(const FString &MapName, const FString &ScenarioFile,
+                     const FString &ScenarioOutputDir, float DeltaSeconds, int32 NumFrames,
+                     FScenarioResult &Result);
+
+#ifdef ConfigurationPluginIncluded
+    // Spawn the sensor described under spinning-lidar in the scenario file
+    bool SpawnScenarioSensor(UWorld* World, const FString &ScenarioFile);
+#endif
+
+    void LogResult(const FScenarioResult &Result) const;
+};
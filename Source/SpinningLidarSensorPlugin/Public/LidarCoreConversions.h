@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "LidarCoreTypes.h"
+
+// Conversions between engine math types and the lidar core's. Both use Unreal's units and
+// left-handed frame, so these only copy components.
+struct FLidarCoreConversions {
+    static FLidarVector3 ToCore(const FVector &Vector) {
+        return FLidarVector3(Vector.X, Vector.Y, Vector.Z);
+    }
+
+    static FVector ToEngine(const FLidarVector3 &Vector) {
+        return FVector(Vector.X, Vector.Y, Vector.Z);
+    }
+
+    static FLidarBox ToCore(const FBox &Box) { return FLidarBox(ToCore(Box.Min), ToCore(Box.Max)); }
+
+    // The rotation and translation of a transform, ignoring scale
+    static FLidarRigidTransform ToCore(const FTransform &Transform) {
+        const FQuat Rotation = Transform.GetRotation();
+        FLidarRigidTransform RigidTransform;
+        RigidTransform.AxisX = ToCore(Rotation.GetAxisX());
+        RigidTransform.AxisY = ToCore(Rotation.GetAxisY());
+        RigidTransform.AxisZ = ToCore(Rotation.GetAxisZ());
+        RigidTransform.Origin = ToCore(Transform.GetLocation());
+        return RigidTransform;
+    }
+};
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "LidarSpscRing.h"
+#include <atomic>
+
+#include "LidarOutputWriter.generated.h"
+
+class FRunnableThread;
+class IFileHandle;
+
+// What the game thread does when the writer thread has fallen behind and its queue is full
+UENUM()
+enum class ELidarWriterBackpressure : uint8 {
+    // Wait for the writer thread to make room. No data is lost, but the game thread can stall.
+    Block,
+    // Keep a bounded backlog on the game thread, discarding its oldest batches when it fills up
+    DropOldest,
+    // Keep an unbounded backlog on the game thread until the writer thread catches up
+    Grow
+};
+
+/*Writes lidar output on a dedicated thread.
+ * The output file is opened once, and the game thread hands it completed batches of
+ * serialized points through a lock-free single-producer single-consumer queue.
+ * The writer thread collects the batches into large buffered writes and sends the emptied
+ * batch buffers back through a second queue so that their allocations are reused.
+ * A batch can also start a new output file, which is how per-revolution formats are written.
+ * Everything except Run is called from the game thread.*/
+class SPINNINGLIDARSENSORPLUGIN_API FLidarOutputWriter : public FRunnable {
+ public:
+    FLidarOutputWriter(int32 QueueCapacity, ELidarWriterBackpressure InBackpressure,
+                       int32 InWriteBufferBytes = 4 * 1024 * 1024);
+    ~FLidarOutputWriter() override;
+
+    // Open the output file and start the writer thread. Returns false if the file can't be opened.
+    // With an empty path the thread is started without a file, and each batch must name one.
+    bool Open(const FString &FilePath, bool bAppend);
+
+    // Drain every queued batch, flush and close the file, and stop the writer thread
+    void Close();
+
+    bool IsOpen() const { return Thread != nullptr; }
+
+    // An empty buffer to serialize a batch into, recycled from earlier batches when possible
+    TArray<uint8> AcquireBuffer();
+
+    // Hand a filled buffer to the writer thread.
+    // If NewFilePath is set, the current file is closed and the buffer starts that file instead.
+    // This only blocks if the backpressure policy is Block and the queue is full.
+    void Submit(TArray<uint8> &&Buffer, const FString &NewFilePath = FString());
+
+    // Ask the writer thread to write out everything it has received so far
+    void Flush();
+
+    // Counters for monitoring the writer
+    int32 GetQueueDepth() const { return Queue.Num() + Backlog.Num(); }
+    int32 GetPeakQueueDepth() const { return PeakQueueDepth; }
+    int64 GetBatchesDropped() const { return BatchesDropped; }
+    int64 GetBytesWritten() const { return BytesWritten.load(std::memory_order_relaxed); }
+
+    // FRunnable interface, run on the writer thread
+    uint32 Run() override;
+    void Stop() override;
+
+ private:
+    // One queued write: serialized bytes, and optionally the file they should start
+    struct FWriteBatch {
+        TArray<uint8> Bytes;
+        FString NewFilePath;
+    };
+
+    // Move as much of the game-thread backlog into the queue as there is room for
+    void DrainBacklog();
+    void WriteStagingBuffer();
+    void WriteBytes(const uint8 *Data, int64 NumBytes);
+    void SwitchFile(const FString &FilePath);
+
+    TLidarSpscRing<FWriteBatch> Queue;
+    TLidarSpscRing<TArray<uint8>> FreeBuffers;
+    ELidarWriterBackpressure Backpressure;
+
+    // Game thread only: batches waiting for room in the queue
+    TArray<FWriteBatch> Backlog;
+    int32 PeakQueueDepth = 0;
+    int64 BatchesDropped = 0;
+
+    // Writer thread only: small batches are gathered here and written in one call
+    TArray<uint8> StagingBuffer;
+    int32 WriteBufferBytes;
+
+    IFileHandle *FileHandle = nullptr;
+    FRunnableThread *Thread = nullptr;
+    FEvent *WorkEvent = nullptr;
+    std::atomic<bool> bStopRequested{false};
+    std::atomic<bool> bFlushRequested{false};
+    std::atomic<int64> BytesWritten{0};
+};
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "LidarCloudSerializers.h"
+
+#include "LidarPointCloudFormats.generated.h"
+
+// The file format lidar points are written in
+UENUM()
+enum class ELidarOutputFormat : uint8 {
+    // One growing text file with a row per beam, including beams with no return
+    CSV,
+    // PCL point cloud data files with binary data, one per revolution
+    PCDBinary,
+    // Little-endian binary PLY files, one per revolution
+    PLYBinary,
+    // KITTI-style .bin files of float32 x, y, z, intensity, one per revolution
+    KITTIBin,
+    // One growing pcap capture of Velodyne HDL-32E data packets, as recorded from the sensor
+    VelodynePcap,
+    // One growing file of compressed range images, a frame per revolution with a frame index
+    RangeImage,
+    // One growing file of every beam of every revolution, a frame per revolution with a frame
+    // index, for random access to any revolution
+    Recording
+};
+
+// Lets the core serializers append straight into an output writer buffer
+class FLidarTArrayByteSink final : public FLidarByteSink {
+ public:
+    explicit FLidarTArrayByteSink(TArray<uint8> &InBytes) : Bytes(InBytes) {}
+
+    uint8_t* Append(size_t Count) override {
+        const int32 FirstByte = Bytes.AddUninitialized((int32)Count);
+        return Bytes.GetData() + FirstByte;
+    }
+
+ private:
+    TArray<uint8> &Bytes;
+};
+
+/*Engine-side helpers for the output formats. The serializers themselves are in the lidar
+ * core, FLidarCloudSerializers.*/
+struct SPINNINGLIDARSENSORPLUGIN_API FLidarPointCloudFormats {
+    // Append a complete file for one revolution in one of the binary formats
+    static void AppendRevolutionFile(ELidarOutputFormat Format, const FLidarPointCloud &Cloud,
+                                     TArray<uint8> &OutBytes);
+
+    // Whether the format writes a new file for every revolution
+    static bool IsPerRevolution(ELidarOutputFormat Format);
+
+    // Whether the format's file ends with an index of where each frame was written, so none of
+    // its batches may be dropped
+    static bool HasFrameIndex(ELidarOutputFormat Format);
+
+    // The file extension, including the dot, used for each format
+    static const TCHAR* GetFileExtension(ELidarOutputFormat Format);
+};
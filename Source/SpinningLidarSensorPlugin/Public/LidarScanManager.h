@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "LidarTriangleBvh.h"
+
+#include "LidarScanManager.generated.h"
+
+class ASpinningLidarSensorActor;
+class UStaticMesh;
+class UStaticMeshComponent;
+class UPhysicalMaterial;
+struct FTriMeshCollisionData;
+
+// The bounds of a component that lidar beams hit but isn't part of the static scene
+struct FLidarDynamicBounds {
+    FBox Bounds;
+    // Only compared with a sensor's own actor, never dereferenced, as it's read on workers
+    const AActor* Owner;
+    // False if beams only pass through it, which only multi-return traces see
+    bool bBlocksBeams;
+};
+
+/*Drives every lidar sensor in a world from a single tick, after physics has moved them.
+ * Each frame, every registered sensor builds the rays of the columns it swept since the last
+ * frame, at its own rate and resolution. The columns of all sensors in Parallel and
+ * StaticSnapshot trace modes are then traced together as one parallel batch, so adding a
+ * sensor adds work to the batch instead of another round of waking up and waiting on worker
+ * threads. Finally each sensor applies its return model to its own columns and writes them
+ * out.
+ * The manager also owns the world-wide frame rate cap and time dilation used by sensors that
+ * don't sub-step their scan, so that several sensors don't fight over them.
+ * For sensors in StaticSnapshot trace mode it holds the world's static meshes as a BVH, built
+ * the first time such a sensor registers, along with the bounds of everything that blocks
+ * beams but isn't in it, updated every frame.
+ * Sensors find or spawn the world's manager when they begin play.*/
+UCLASS(NotPlaceable, Transient)
+class SPINNINGLIDARSENSORPLUGIN_API ALidarScanManager : public AActor {
+    GENERATED_BODY()
+
+ public:
+    ALidarScanManager();
+
+    // The manager of the world, spawned the first time it is asked for
+    static ALidarScanManager* Get(UWorld* World);
+
+    void RegisterSensor(ASpinningLidarSensorActor* Sensor);
+    void UnregisterSensor(ASpinningLidarSensorActor* Sensor);
+
+    void Tick(float DeltaTime) override;
+
+    // The static scene, and the component and physical material of each of its objects.
+    // Read-only once built, so sensors trace it from any thread.
+    const FLidarTriangleBvh &GetStaticScene() const { return StaticScene; }
+    const TWeakObjectPtr<UPrimitiveComponent> &GetStaticSceneComponent(int32 ObjectIndex) const {
+        return StaticSceneComponents[ObjectIndex];
+    }
+    const UPhysicalMaterial* GetStaticScenePhysicalMaterial(int32 ObjectIndex) const {
+        return StaticScenePhysicalMaterials[ObjectIndex];
+    }
+
+    // Everything that blocks beams but isn't in the static scene, as of this frame
+    const TArray<FLidarDynamicBounds> &GetDynamicBounds() const { return DynamicBounds; }
+
+ private:
+    // Apply a sensor's clock settings to the world, if no other sensor has already
+    void ApplyClockSettings(ASpinningLidarSensorActor* Sensor);
+    // Put back the frame rate cap and time dilation the world had before any sensor's
+    void RestoreClockSettings();
+
+    // Snapshot the static meshes of the world into the static scene
+    void BuildStaticScene();
+    bool AddToStaticScene(UStaticMeshComponent* Component,
+                          TMap<UStaticMesh*, FTriMeshCollisionData> &MeshData);
+    void UpdateDynamicBounds();
+
+    // One column of one sensor in the shared trace batch
+    struct FSharedColumn {
+        ASpinningLidarSensorActor* Sensor;
+        int32 ColumnIndex;
+    };
+
+    UPROPERTY(Transient)
+    TArray<ASpinningLidarSensorActor*> Sensors;
+
+    // The sensor whose frame rate and time dilation the world runs at
+    UPROPERTY(Transient)
+    ASpinningLidarSensorActor* ClockSensor = nullptr;
+    // What the world ran at before a sensor first set its clock
+    float SavedMaxFPS = 0.f;
+    float SavedTimeDilation = 1.f;
+    bool bSavedClockSettings = false;
+
+    // Kept between frames so that they keep their allocations
+    TArray<ASpinningLidarSensorActor*> TickSensors;
+    TArray<FSharedColumn> SharedColumns;
+
+    FLidarTriangleBvh StaticScene;
+    bool bStaticSceneBuilt = false;
+    // Each object in the static scene is the triangles of one material of a mesh
+    TArray<TWeakObjectPtr<UPrimitiveComponent>> StaticSceneComponents;
+    TArray<const UPhysicalMaterial*> StaticScenePhysicalMaterials;
+
+    // Components of actors that don't move, which block beams but couldn't be snapshotted, or
+    // which beams pass through. Their bounds are part of the dynamic bounds along with those
+    // of every movable actor.
+    TArray<TWeakObjectPtr<UPrimitiveComponent>> FallbackComponents;
+    TArray<FLidarDynamicBounds> DynamicBounds;
+};
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "LidarScanPattern.h"
+
+#include "LidarSensorProfiles.generated.h"
+
+// The beam layout of the sensor
+UENUM()
+enum class ELidarSensorProfile : uint8 {
+    // NumBeams beams evenly spaced in elevation between MinElevation and MaxElevation
+    Custom,
+    // Velodyne HDL-32E: 32 lasers from -30.67 to +10.67 degrees
+    VelodyneHDL32E,
+    // Velodyne VLP-16 (Puck): 16 lasers from -15 to +15 degrees
+    VelodyneVLP16,
+    // Ouster OS1-64: 64 lasers from -16.6 to +16.6 degrees, staggered in azimuth
+    OusterOS1_64
+};
+
+// The built-in sensor profiles, whose laser tables live in the lidar core
+struct SPINNINGLIDARSENSORPLUGIN_API FLidarSensorProfiles {
+    // The laser table for a built-in profile, or an empty table for Custom
+    static FLidarBeamTable GetBeamTable(ELidarSensorProfile Profile);
+
+    // Parse a profile name as written in yaml, e.g. "HDL-32E", "VLP-16", "OS1-64" or "custom"
+    static bool ParseProfileName(const FString &Name, ELidarSensorProfile &OutProfile);
+
+    // Every name accepted by ParseProfileName
+    static TArray<FString> GetProfileNames();
+};
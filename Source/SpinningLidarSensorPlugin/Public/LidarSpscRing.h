@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "CoreMinimal.h"
+#include <atomic>
+
+/*A bounded, lock-free single-producer single-consumer ring buffer.
+ * Exactly one thread may call TryPush and exactly one other thread may call TryPop.
+ * The capacity is rounded up to a power of two so that indices wrap with a mask.*/
+template <typename ElementType>
+class TLidarSpscRing {
+ public:
+    explicit TLidarSpscRing(int32 InCapacity) {
+        const uint32 Capacity = FMath::RoundUpToPowerOfTwo(FMath::Max(InCapacity, 2));
+        Slots.SetNum(Capacity);
+        IndexMask = Capacity - 1;
+    }
+
+    // Producer only. Moves the item into the ring and returns true if there was space,
+    // otherwise leaves the item untouched and returns false.
+    bool TryPush(ElementType &Item) {
+        const uint32 CurrentHead = Head.load(std::memory_order_relaxed);
+        if (CurrentHead - Tail.load(std::memory_order_acquire) > IndexMask) return false;
+
+        Slots[CurrentHead & IndexMask] = MoveTemp(Item);
+        Head.store(CurrentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. Moves the oldest item out of the ring, returning false if it is empty.
+    bool TryPop(ElementType &OutItem) {
+        const uint32 CurrentTail = Tail.load(std::memory_order_relaxed);
+        if (CurrentTail == Head.load(std::memory_order_acquire)) return false;
+
+        OutItem = MoveTemp(Slots[CurrentTail & IndexMask]);
+        Tail.store(CurrentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // The number of queued items. Exact on either end's own thread, approximate elsewhere.
+    int32 Num() const {
+        return Head.load(std::memory_order_acquire) - Tail.load(std::memory_order_acquire);
+    }
+
+    int32 Capacity() const { return IndexMask + 1; }
+
+ private:
+    TArray<ElementType> Slots;
+    uint32 IndexMask;
+
+    // Head is only written by the producer and Tail only by the consumer.
+    // They sit on separate cache lines so the two threads do not false-share.
+    alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> Head{0};
+    alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint32> Tail{0};
+};
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "CoreMinimal.h"
+
+class FInternetAddr;
+class FSocket;
+
+/*Sends datagrams to one UDP destination, e.g. lidar packets to a driver on the local machine.
+ * Sends never block: a datagram the socket can't take right away is dropped, as it would be
+ * on the wire.*/
+class SPINNINGLIDARSENSORPLUGIN_API FLidarUdpSender {
+ public:
+    ~FLidarUdpSender();
+
+    // Create the socket for sending to Host:Port. Returns false if Host isn't a valid address
+    // or the socket can't be created.
+    bool Open(const FString &Host, int32 Port);
+
+    void Close();
+
+    bool IsOpen() const { return Socket != nullptr; }
+
+    void Send(const uint8* Data, int32 Count);
+
+ private:
+    FSocket* Socket = nullptr;
+    TSharedPtr<FInternetAddr> Destination;
+};
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "Components/PrimitiveComponent.h"
+
+#include "LidarVisualizerComponent.generated.h"
+
+// One visualized beam of a revolution, in world space
+struct FLidarVisualPoint {
+    // Where the beam returned from, or where it ended if it didn't
+    FVector Position;
+    FVector BeamStart;
+    FColor Color;
+    bool bReturned;
+};
+
+/*Draws the latest revolution of a sensor as points, and optionally its beams.
+ * The points are handed over once per revolution and copied to the render thread, which
+ * draws them every frame in one batch until the next revolution replaces them. Nothing is
+ * drawn through the debug line batcher, so the game thread only pays for building the
+ * points of a revolution.*/
+UCLASS(ClassGroup = Rendering)
+class SPINNINGLIDARSENSORPLUGIN_API ULidarVisualizerComponent : public UPrimitiveComponent {
+    GENERATED_BODY()
+
+ public:
+    ULidarVisualizerComponent();
+
+    // Replace the points drawn. InPoints is left with the old points, to reuse its allocation.
+    void SetPoints(TArray<FLidarVisualPoint> &InPoints);
+
+    float PointSize = 3.f;
+    bool bDrawBeams = false;
+    float BeamThickness = 0.5f;
+    FColor BeamColor = FColor(255, 0, 0);
+
+    FPrimitiveSceneProxy* CreateSceneProxy() override;
+    FBoxSphereBounds CalcBounds(const FTransform &LocalToWorld) const override;
+
+ private:
+    friend class FLidarVisualizerSceneProxy;
+
+    TArray<FLidarVisualPoint> Points;
+    FBox PointBounds;
+};
@@ -3,6 +3,21 @@
 #pragma once
 #include "Engine.h"
 #include "GameFramework/Actor.h"
+#include "LidarFiringClock.h"
+#include "LidarLabelDictionary.h"
+#include "LidarCsvWriter.h"
+#include "LidarOutputWriter.h"
+#include "LidarPointFilter.h"
+#include "LidarPointCloudFormats.h"
+#include "LidarSensorModel.h"
+#include "LidarSensorProfiles.h"
+#include "LidarShmRing.h"
+#include "LidarUdpSender.h"
+#include "LidarRangeImage.h"
+#include "LidarRecording.h"
+#include "LidarVelodynePackets.h"
+#include "LidarVisualizerComponent.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
 
 #if __has_include("ConfigurationPlugin.h")
 #define ConfigurationPluginIncluded
@@ -13,6 +28,67 @@
 
 #include "SpinningLidarSensorActor.generated.h"
 
+// The format of the optional per-revolution perf report
+UENUM()
+enum class ELidarPerfReportFormat : uint8 {
+    None,
+    CSV,
+    // One JSON object per line
+    JSON
+};
+
+// How the beams fired during a tick are traced against the world
+UENUM()
+enum class ELidarTraceMode : uint8 {
+    // Trace every beam one at a time on the game thread
+    Sync,
+    // Trace the beams of a tick on worker threads, one column per task, and wait for them.
+    // The columns of every sensor in this mode are traced together in one batch.
+    Parallel,
+    // Queue the beams as async traces and collect the results on the next tick
+    Async,
+    // Like Parallel, but trace against a snapshot of the world's static meshes taken when the
+    // first sensor in this mode begins play, without going through the physics engine.
+    // Beams that may hit anything else fall back to an engine trace.
+    StaticSnapshot
+};
+
+// Which of the surfaces a beam reaches are reported as returns
+UENUM()
+enum class ELidarReturnMode : uint8 {
+    // The first surface the beam hits, from a single trace that stops there
+    First,
+    // The surface with the strongest return
+    Strongest,
+    // The furthest surface the beam reaches
+    Last,
+    // The strongest and the last, or the two strongest if the last is also the strongest
+    Dual
+};
+
+// How the visualized points are colored
+UENUM()
+enum class ELidarPointColorMode : uint8 {
+    // Every point in PointColor
+    Fixed,
+    // From red at the lowest intensity to green at the highest
+    Intensity,
+    // Through the hues from HeightColorMin to HeightColorMax above the sensor
+    Height
+};
+
+class ALidarScanManager;
+class ASpinningLidarSensorActor;
+
+// Fired on the game thread each time the sensor completes a revolution.
+// The native version passes the revolution's points, which stay valid as described at
+// GetLatestRevolution.
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FLidarRevolutionCompleted,
+                                             ASpinningLidarSensorActor*, Sensor,
+                                             int32, Revolution);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FLidarRevolutionCompletedNative,
+                                     ASpinningLidarSensorActor*, const FLidarPointCloud&);
+
 UCLASS()
 class SPINNINGLIDARSENSORPLUGIN_API ASpinningLidarSensorActor : public AActor, public CommonActor {
     GENERATED_BODY()
@@ -33,11 +109,9 @@ class SPINNINGLIDARSENSORPLUGIN_API ASpinningLidarSensorActor : public AActor, p
     UPROPERTY()
     UCapsuleComponent* RootCapsule;
 
-    UPROPERTY(EditAnywhere, Transient)
-    USceneCaptureComponent2D* SceneCap;
-
-    UPROPERTY(EditAnywhere, Transient)
-    UTextureRenderTarget2D* RenderTexture;
+    // Draws the points of the latest revolution
+    UPROPERTY(Transient)
+    ULidarVisualizerComponent* Visualizer;
 
     // The filename that the lidar data will be written do.
     // The file will appear in the top level of your Unreal project folder.
@@ -50,6 +124,13 @@ class SPINNINGLIDARSENSORPLUGIN_API ASpinningLidarSensorActor : public AActor, p
     UPROPERTY(EditAnywhere, Category = "Lidar Sensor Properties", meta = (UIMin = 0.f))
     float LidarRange = 10000.f;
 
+    // The beam layout of the sensor. Custom spaces NumBeams beams evenly between MinElevation and
+    // MaxElevation. The other profiles use the laser tables of real sensors, and override
+    // those three properties when play begins.
+    // In yaml, set "profile" to one of "custom", "HDL-32E", "VLP-16" or "OS1-64".
+    UPROPERTY(EditAnywhere, Category = "Lidar Sensor Properties")
+    ELidarSensorProfile SensorProfile = ELidarSensorProfile::Custom;
+
     // number of lidar beams
     UPROPERTY(EditANywhere, Category = "Lidar Sensor Properties", meta = (UIMin = 1))
     int32 NumBeams = 32;
@@ -91,6 +172,16 @@ class SPINNINGLIDARSENSORPLUGIN_API ASpinningLidarSensorActor : public AActor, p
     UPROPERTY(EditAnywhere, Category = "Lidar Sensor Properties", meta = (UIMin = 0.f))
     float FalloffStdDev = 10.f;
 
+    // Seed for the range noise and dropout models. Together with SensorId it keys a
+    // counter-based generator, so a rerun with the same seed produces bit-identical noise,
+    // whether the beams are processed serially or in parallel.
+    UPROPERTY(EditAnywhere, Category = "Lidar Sensor Properties")
+    int32 NoiseSeed = 0;
+
+    // Distinguishes sensors that share a seed, so that each one draws different noise
+    UPROPERTY(EditAnywhere, Category = "Lidar Sensor Properties")
+    int32 SensorId = 0;
+
     // If checked, lidar points in the output file will be in the
     // local coordinate frame of the sensor.
     // If unchecked, they will use world coordinates.
@@ -100,6 +191,21 @@ class SPINNINGLIDARSENSORPLUGIN_API ASpinningLidarSensorActor : public AActor, p
 
     /*Visualization Properties*/
 
+    // The most points of a revolution to visualize. Columns are skipped on top of the strides
+    // below until a revolution fits. 0 turns visualization off.
+    UPROPERTY(EditAnywhere, Category = "Visualization Properties", meta = (UIMin = 0))
+    int32 VisualizationPointBudget = 20000;
+
+    // Only visualize every Nth column of a revolution, and every Nth beam of those columns
+    UPROPERTY(EditAnywhere, Category = "Visualization Properties", meta = (UIMin = 1))
+    int32 VisualizeEveryNthColumn = 1;
+    UPROPERTY(EditAnywhere, Category = "Visualization Properties", meta = (UIMin = 1))
+    int32 VisualizeEveryNthBeam = 1;
+
+    // If checked, also draw the visualized beams, up to their return or to max range
+    UPROPERTY(EditAnywhere, Category = "Visualization Properties")
+    bool bVisualizeBeams = false;
+
     // Thickness of beams for raycast visualization
     UPROPERTY(EditAnywhere, Category = "Visualization Properties", meta = (UIMin = 0.f))
     float BeamThickness = 0.5f;
@@ -108,23 +214,23 @@ class SPINNINGLIDARSENSORPLUGIN_API ASpinningLidarSensorActor : public AActor, p
     UPROPERTY(EditAnywhere, Category = "Visualization Properties", meta = (UIMin = 0.f))
     float LidarPointSize = 3.f;
 
-    // Number of seconds that each visualized lidar hit will remain in the world
-    UPROPERTY(EditANywhere, Category = "Visualization Properties", meta = (UIMin = 0.f))
-    float PointLifetime = 1.f;
-
     // The color of the beam visualizations
     UPROPERTY(EditAnywhere, Category = "Visualization Properties")
     FColor BeamColor = FColor(255, 0, 0);
 
-    // The color of the visualized lidar points
+    // How the visualized lidar points are colored
+    UPROPERTY(EditAnywhere, Category = "Visualization Properties")
+    ELidarPointColorMode PointColorMode = ELidarPointColorMode::Fixed;
+
+    // The color of the visualized lidar points in Fixed mode
     UPROPERTY(EditAnywhere, Category = "Visualization Properties")
     FColor PointColor = FColor(10, 0, 0);
 
-    // If checked, the color of the visualized lidar points will reflect the
-    // intensity of the return, from red (low intensity) to green (high intensity).
-    // If unchecked, the lidar point color chosen above will be used.
+    // The heights in cm relative to the sensor that the Height color ramp spans
+    UPROPERTY(EditAnywhere, Category = "Visualization Properties")
+    float HeightColorMin = -200.f;
     UPROPERTY(EditAnywhere, Category = "Visualization Properties")
-    bool bVisualizeIntensity = false;
+    float HeightColorMax = 300.f;
 
 
     /*Simulation Properties*/
@@ -141,6 +247,51 @@ class SPINNINGLIDARSENSORPLUGIN_API ASpinningLidarSensorActor : public AActor, p
     // UIMin ensures this value will never be <= 0.
     // ASSUMPTION: The frame rate required for real time will never be <1.
 
+    /*If checked, each engine tick fires every azimuth column the sensor would have swept during
+     * that tick at the rate given by SimTimeFramerate, interpolating the sensor pose between the
+     * previous and current frame. The world runs at normal speed with no global time dilation.
+     * If unchecked, a single azimuth column is fired per tick and the whole world is slowed down
+     * with global time dilation so that each tick matches one sensor frame.*/
+    UPROPERTY(EditAnywhere, Category = "Simulation Properties")
+    bool bSubStepScan = true;
+
+    // How the beams fired during a tick are traced against the world.
+    // Async traces are collected on the following tick, so their output lags by one frame.
+    // StaticSnapshot is much faster in scenes that are mostly static meshes, but doesn't see
+    // changes to static geometry after the snapshot.
+    UPROPERTY(EditAnywhere, Category = "Simulation Properties")
+    ELidarTraceMode TraceMode = ELidarTraceMode::Parallel;
+
+    // Number of rays traced per second of wall-clock time spent tracing, averaged over recent
+    // ticks. In async mode this is measured from queueing the traces to collecting the results.
+    UPROPERTY(VisibleAnywhere, Transient, Category = "Simulation Properties")
+    float MeasuredRaysPerSecond = 0.f;
+
+    /*If checked, every beam of every column remembers what it hit the last time it was traced,
+     * and beams whose last hit was static geometry are not traced again while the sensor stays
+     * put. A beam is still traced if its last hit was on a movable component, or its path
+     * crosses the bounds of a movable actor that moved during the last revolution, and every
+     * beam of a column is traced once the sensor has moved away from where it was cached.
+     * Dropout, range noise and intensity are applied to reused hits as to traced ones.
+     * For parked or slowly moving sensors in mostly static scenes.*/
+    UPROPERTY(EditAnywhere, Category = "Simulation Properties")
+    bool bReuseStaticHits = false;
+
+    // How far in cm the sensor head or a movable actor can move before it counts as moved
+    UPROPERTY(EditAnywhere, Category = "Simulation Properties",
+              meta = (EditCondition = "bReuseStaticHits", ClampMin = 0.f))
+    float ReusePositionTolerance = 1.f;
+
+    // How far in degrees the sensor head or a movable actor can turn before it counts as moved
+    UPROPERTY(EditAnywhere, Category = "Simulation Properties",
+              meta = (EditCondition = "bReuseStaticHits", ClampMin = 0.f))
+    float ReuseRotationTolerance = 0.05f;
+
+    // The fraction of beams in the last scan step whose hit was reused instead of traced
+    UPROPERTY(VisibleAnywhere, Transient, Category = "Simulation Properties")
+    float ReusedHitFraction = 0.f;
+
+    // Only used when sub-stepping is disabled.
     // Choose a frame rate your machine can reliably achieve,
     // and the simulation will be capped at that.
     UPROPERTY(EditAnywhere, Category = "Simulation Properties", meta = (UIMin = 0.f))
@@ -156,35 +307,486 @@ class SPINNINGLIDARSENSORPLUGIN_API ASpinningLidarSensorActor : public AActor, p
     UPROPERTY(EditAnywhere, Category = "Simulation Properties", meta = (UIMin = 0.f, UIMax = 1.f))
     float IntensityAffectedByAngle = 1.f;
 
-    // The default pixel dimensions of the texture render target
-    // used to render the base colors of the scene
-    // from the perspective of the sensor, for use in calculating intensity values.
-    // To change the dimensions of the render target,
-    // open the render target itself and set these values directly.
-    UPROPERTY()
-    FVector2D RenderTextureDimensions = FVector2D(512, 512);
+    // How much of the beam each physical material reflects, from 0 to 1. A return's intensity
+    // is its surface's reflectivity on a scale of 0 to 255, scaled by the angle of incidence.
+    // Materials count as the physical material they are given in the material editor.
+    UPROPERTY(EditAnywhere, Category = "Simulation Properties")
+    TMap<UPhysicalMaterial*, float> MaterialReflectivity;
+
+    // The reflectivity of surfaces whose physical material isn't in MaterialReflectivity
+    UPROPERTY(EditAnywhere, Category = "Simulation Properties",
+              meta = (ClampMin = 0.f, ClampMax = 1.f))
+    float DefaultReflectivity = 0.5f;
+
+    /*Which returns of each beam are reported. In every mode but First, each beam is traced once
+     * with a multi-hit trace, which passes through components that overlap the Visibility
+     * channel instead of blocking it, and reports the surfaces it reached, ending at the first
+     * that blocks. Those are chosen by their return strength, from how much of the beam reaches
+     * each surface and is reflected, and the angle of incidence. Dual mode stores a second
+     * return for each beam, and the outputs carry a return index with each point.*/
+    UPROPERTY(EditAnywhere, Category = "Simulation Properties")
+    ELidarReturnMode ReturnMode = ELidarReturnMode::First;
+
+    // How much of the beam each partially transmissive physical material, such as foliage,
+    // glass or fences, lets through, from 0 (opaque) to 1. Only used in multi-return modes.
+    UPROPERTY(EditAnywhere, Category = "Simulation Properties")
+    TMap<UPhysicalMaterial*, float> TransmissiveMaterials;
+
+    // How much of the beam surfaces that overlap the Visibility channel let through when their
+    // physical material isn't in TransmissiveMaterials. Surfaces that block it let none through.
+    UPROPERTY(EditAnywhere, Category = "Simulation Properties",
+              meta = (ClampMin = 0.f, ClampMax = 1.f))
+    float OverlapTransmittance = 0.5f;
+
+    /*Output Properties*/
+
+    // The format of the output. CSV appends every beam to SaveFileName. The binary formats
+    // write one file per revolution containing only the beams that returned, named after
+    // SaveFileName with the revolution number appended, e.g. LidarRecording_000012.pcd.
+    // VelodynePcap writes the HDL-32E packet stream to a .pcap named after SaveFileName, which
+    // replays in VeloView or the ROS velodyne driver. Columns are cut or padded to 32 beams.
+    // RangeImage writes a .lri named after SaveFileName, with a range image of every
+    // revolution: a row per beam and a column per azimuth step. Recording writes a .lrec named
+    // after SaveFileName with every beam of every revolution and a frame index, which
+    // FLidarRecordingReader reads any revolution of directly.
+    UPROPERTY(EditAnywhere, Category = "Output Properties")
+    ELidarOutputFormat OutputFormat = ELidarOutputFormat::CSV;
+
+    // Decimals of the CSV timestamps, and of its positions and intensities. -1 writes the
+    // shortest text that reads back as the same value instead.
+    UPROPERTY(EditAnywhere, Category = "Output Properties",
+              meta = (ClampMin = -1, ClampMax = 17))
+    int32 CsvTimestampDecimals = 9;
+
+    UPROPERTY(EditAnywhere, Category = "Output Properties",
+              meta = (ClampMin = -1, ClampMax = 17))
+    int32 CsvDecimals = 6;
+
+    /*Ground Truth Properties*/
+
+    // Label every point with the instance and class of the actor it hit. The CSV, PCD and PLY
+    // outputs get integer instance id and class id columns, and KITTI revolutions a
+    // SemanticKITTI .label file each. The names behind the ids are written once each, as
+    // they are first hit, to a file named after SaveFileName ending in _labels.csv.
+    UPROPERTY(EditAnywhere, Category = "Ground Truth Properties")
+    bool bWriteLabels = false;
+
+    // An actor tagged with this prefix followed by a class name, such as "class:car", is of
+    // that class
+    UPROPERTY(EditAnywhere, Category = "Ground Truth Properties",
+              meta = (EditCondition = "bWriteLabels"))
+    FString ClassTagPrefix = TEXT("class:");
+
+    // The classes of actors without a class tag, by one of their tags or by the name of their
+    // actor class, such as StaticMeshActor. Actors that match nothing are of class 0.
+    UPROPERTY(EditAnywhere, Category = "Ground Truth Properties",
+              meta = (EditCondition = "bWriteLabels"))
+    TMap<FName, FString> LabelClasses;
+
+    /*Filter Properties*/
+
+    // Leave out the beams that didn't return, which the CSV output otherwise writes as
+    // 0, 0, 0 rows
+    UPROPERTY(EditAnywhere, Category = "Filter Properties")
+    bool bDropMisses = false;
+
+    // Only write the returns inside a box placed relative to the sensor, such as the area
+    // around a vehicle. The box has its centre at RegionCenter, half its size in RegionExtent
+    // and is turned by RegionRotation, all in the sensor's frame, so with no rotation it is
+    // aligned with the sensor.
+    UPROPERTY(EditAnywhere, Category = "Filter Properties")
+    bool bCropToRegion = false;
+
+    UPROPERTY(EditAnywhere, Category = "Filter Properties",
+              meta = (EditCondition = "bCropToRegion"))
+    FVector RegionCenter = FVector::ZeroVector;
+
+    UPROPERTY(EditAnywhere, Category = "Filter Properties",
+              meta = (EditCondition = "bCropToRegion", ClampMin = 0.f))
+    FVector RegionExtent = FVector(2000.f, 2000.f, 500.f);
+
+    UPROPERTY(EditAnywhere, Category = "Filter Properties",
+              meta = (EditCondition = "bCropToRegion"))
+    FRotator RegionRotation = FRotator::ZeroRotator;
+
+    // Thin out each revolution to one return per cube of this size in cm, on a grid aligned
+    // with the world axes. 0 writes every return.
+    UPROPERTY(EditAnywhere, Category = "Filter Properties", meta = (ClampMin = 0.f))
+    float VoxelSize = 0.f;
+
+    // The range resolution of the RangeImage output, in cm. Ranges are stored as 16-bit
+    // integers, so the default of 0.5 cm reaches out to 327 m.
+    UPROPERTY(EditAnywhere, Category = "Output Properties", meta = (ClampMin = 0.01f))
+    float RangeImageResolution = 0.5f;
+
+    // Compress each range image with zlib. Uncompressed frames can be memory-mapped straight
+    // into a tensor, but are several times larger.
+    UPROPERTY(EditAnywhere, Category = "Output Properties")
+    bool bCompressRangeImage = true;
+
+    // Also send the HDL-32E packet stream over UDP, to VelodyneUdpAddress:VelodyneUdpPort,
+    // so a driver can read the simulated sensor live
+    UPROPERTY(EditAnywhere, Category = "Output Properties")
+    bool bSendVelodyneUdp = false;
+
+    UPROPERTY(EditAnywhere, Category = "Output Properties",
+              meta = (EditCondition = "bSendVelodyneUdp"))
+    FString VelodyneUdpAddress = TEXT("127.0.0.1");
+
+    UPROPERTY(EditAnywhere, Category = "Output Properties",
+              meta = (EditCondition = "bSendVelodyneUdp"))
+    int32 VelodyneUdpPort = FLidarVelodynePacketEncoder::DataPort;
+
+    // What happens when the output writer thread falls behind the sensor.
+    // Block stalls the game thread until there is room, DropOldest discards the oldest
+    // unwritten batches, and Grow buffers them in memory until the writer catches up.
+    // Formats with a frame index grow rather than drop, as the index expects every frame.
+    UPROPERTY(EditAnywhere, Category = "Output Properties")
+    ELidarWriterBackpressure WriterBackpressure = ELidarWriterBackpressure::Grow;
+
+    // The number of batches (one per tick) that can be queued for the writer thread
+    UPROPERTY(EditAnywhere, Category = "Output Properties", meta = (UIMin = 2))
+    int32 WriterQueueCapacity = 256;
+
+    // Write a summary of where the sensor's time went after every revolution, to a file named
+    // after SaveFileName ending in _perf.csv or _perf.json
+    UPROPERTY(EditAnywhere, Category = "Output Properties")
+    ELidarPerfReportFormat PerfReportFormat = ELidarPerfReportFormat::None;
+
+    // Batches currently waiting to be written, and the most that have ever been waiting at once
+    UPROPERTY(VisibleAnywhere, Transient, Category = "Output Properties")
+    int32 WriterQueueDepth = 0;
+
+    UPROPERTY(VisibleAnywhere, Transient, Category = "Output Properties")
+    int32 WriterPeakQueueDepth = 0;
+
+    // Batches discarded by the DropOldest backpressure policy
+    UPROPERTY(VisibleAnywhere, Transient, Category = "Output Properties")
+    int64 WriterBatchesDropped = 0;
+
+    // Bytes written to the output file so far
+    UPROPERTY(VisibleAnywhere, Transient, Category = "Output Properties")
+    int64 WriterBytesWritten = 0;
+
+    // How many of the most recent revolutions stay readable through GetLatestRevolution.
+    // With the default of 3, a consumer can hold on to the latest revolution while the next
+    // one is published and a third is being filled.
+    UPROPERTY(EditAnywhere, Category = "Output Properties", meta = (ClampMin = 1))
+    int32 PublishedRevolutionBuffers = 3;
+
+    // Also publish every completed revolution into a shared-memory ring named
+    // SharedMemoryName, for other processes on this machine to read with
+    // FLidarShmRingReader. The ring holds the last SharedMemorySlots revolutions.
+    UPROPERTY(EditAnywhere, Category = "Output Properties")
+    bool bPublishSharedMemory = false;
+
+    UPROPERTY(EditAnywhere, Category = "Output Properties",
+              meta = (EditCondition = "bPublishSharedMemory"))
+    FString SharedMemoryName = TEXT("SpinningLidar");
+
+    UPROPERTY(EditAnywhere, Category = "Output Properties",
+              meta = (EditCondition = "bPublishSharedMemory", ClampMin = 2))
+    int32 SharedMemorySlots = 4;
+
+    /*In-process access to the point cloud, so that other actors don't have to read the file*/
+
+    UPROPERTY(BlueprintAssignable, Category = "Lidar Sensor Output")
+    FLidarRevolutionCompleted OnRevolutionCompleted;
+
+    FLidarRevolutionCompletedNative OnRevolutionCompletedNative;
+
+    // The latest complete revolution, or null before the first one. Every beam is in it,
+    // including those with no return, in the frame chosen with bUseLocalCoordinates.
+    // The cloud is read-only and shared, not copied. It stays valid until
+    // PublishedRevolutionBuffers more revolutions have completed, or the sensor's EndPlay.
+    const FLidarPointCloud* GetLatestRevolution() const;
+
+    // The index of the latest complete revolution, or -1 before the first one
+    UFUNCTION(BlueprintPure, Category = "Lidar Sensor Output")
+    int32 GetLatestRevolutionIndex() const;
+
+    // The rays traced, and the beams that returned, since BeginPlay
+    int64 GetTotalRays() const { return TotalRays + RevolutionPerf.Rays; }
+    int64 GetTotalHits() const { return TotalHits + RevolutionPerf.Hits; }
+
+    // Write the outputs into Directory instead, keeping their file names.
+    // Must be called before BeginPlay.
+    void SetSaveDirectory(const FString &Directory);
+
+    // Copy out the points of the latest complete revolution that returned, with their
+    // intensities. Returns false if no revolution has completed yet.
+    UFUNCTION(BlueprintCallable, Category = "Lidar Sensor Output")
+    bool GetLatestRevolutionPoints(TArray<FVector> &OutPoints,
+                                   TArray<float> &OutIntensities) const;
 
  protected:
     // Called when the game starts or when spawned
     void BeginPlay() override;
 
- public:
-    // Called every frame
-    void Tick(float DeltaTime) override;
+    // Called when the game ends or the actor is destroyed
+    void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
  private:
-    void WriteLidarPointsToFile(TArray<FHitResult> &LidarHits);
-    void GetSceneView(USceneCaptureComponent2D * SceneCapture, TSharedPtr<FSceneView> &SceneView);
-    void AddGaussianRangeNoise(FHitResult &Hit);
-    void RandomizeWhetherHitReturns(FHitResult &Hit);
-    FHitResult FireLidarBeam(float);
-    void GetLidarPointIntensity(FHitResult &Hit, TArray<FColor> &ImageBitmap,
-                                TSharedPtr<FSceneView> SceneView, FColor &PointColorFromScene,
-                                float &HitIntensity);
-    void VisualizeBeam(FHitResult &Hit, FColor &PointColorFromScene);
-    float BeamSpacing;
+    // The pose and timestamp of one azimuth column of beams fired during a tick
+    struct FLidarScanColumn {
+        // Transform of the actor (root component) when the column was fired
+        FTransform ActorTransform;
+        // Rotation and start location of the spinning sensor head when the column was fired,
+        // and its azimuth in degrees relative to the root
+        FTransform BeamTransform;
+        float Azimuth;
+        // When the column's first beam fired, in seconds
+        double Timestamp;
+        // Where every beam in the column starts
+        FVector BeamStart;
+        // The revolution of the sensor head this column belongs to,
+        // and the index of the column within that revolution
+        int32 Revolution;
+        int32 RevolutionColumn;
+        // The point cloud of that revolution, and the index of this column's first point in it
+        FLidarPointCloud* Cloud;
+        int32 FirstPoint;
+        // Whether the column reads and writes the hit cache. Only one column of a batch may
+        // use each place in the revolution.
+        bool bCacheHits;
+        // This column's slots in its batch's PointComponents, or null if labels aren't written
+        TWeakObjectPtr<UPrimitiveComponent>* PointComponents;
+    };
+
+    // Every ray fired during a tick, NumBeams per column. The results are written straight
+    // into the point clouds of the columns' revolutions.
+    // Rays whose hit was reused from the cache are stored when the batch is built, and are
+    // skipped by the trace stage.
+    // Batches are reused between ticks so that their arrays keep their allocations.
+    struct FLidarTraceBatch {
+        TArray<FLidarScanColumn> Columns;
+        TArray<FVector> RayEnds;
+        TArray<bool> TraceRays;
+        TArray<FTraceHandle> AsyncHandles;
+        // The component each point of the batch hit, PointsPerColumn per column, when labels
+        // are written. Stored by the traces on any thread and turned into labels on the game
+        // thread.
+        TArray<TWeakObjectPtr<UPrimitiveComponent>> PointComponents;
+        int32 NumTracedRays = 0;
+        double TraceStartSeconds = 0.0;
+
+        void Reset();
+    };
+
+    // The last trace of one beam of one column, kept when bReuseStaticHits is checked
+    struct FLidarCachedHit {
+        FVector ImpactPoint;
+        FVector ImpactNormal;
+        float Distance;
+        float Reflectivity;
+        TWeakObjectPtr<UPrimitiveComponent> Component;
+        bool bBlockingHit;
+        // Whether the component could move, so the hit can't be reused
+        bool bMovable;
+    };
+
+    // Where the sensor head was when a column's hits were cached
+    struct FLidarCachedColumn {
+        FVector BeamStart;
+        FQuat BeamRotation;
+        bool bValid = false;
+    };
+
+    // A movable actor in range of the sensor, with the pose and bounds it last moved to and
+    // the firing at which it did
+    struct FLidarTrackedActor {
+        FTransform Transform;
+        FBox Bounds;
+        int64 MovedAtFiring;
+    };
+
+    // The ground-truth ids of the points on a component
+    struct FLidarPointLabel {
+        uint32 InstanceId = 0;
+        uint16 ClassId = 0;
+    };
+
+    // Timings and counts gathered over one revolution for the perf report
+    struct FLidarRevolutionPerf {
+        double TickSeconds = 0.0;
+        double BuildRaysSeconds = 0.0;
+        double RaycastsSeconds = 0.0;
+        double RandomizeReturnsSeconds = 0.0;
+        double RangeNoiseSeconds = 0.0;
+        double IntensitySeconds = 0.0;
+        double VisualizeSeconds = 0.0;
+        double FilterSeconds = 0.0;
+        double SerializeSeconds = 0.0;
+        int64 Rays = 0;
+        int64 Hits = 0;
+        double StartRealTimeSeconds = 0.0;
+        int64 StartBytesWritten = 0;
+    };
+
+    // The ALidarScanManager scans with every sensor once per frame. BeginScanStep builds the
+    // rays of the columns swept since the last step. The manager then traces the columns of
+    // sensors in Parallel and StaticSnapshot mode together, and EndScanStep traces the rest or
+    // queues them, applies the return model and writes out the results. SharedTraceSeconds is
+    // this sensor's share of the time spent on the shared trace.
+    friend class ALidarScanManager;
+    void BeginScanStep(float DeltaTime);
+    void EndScanStep(double SharedTraceSeconds);
+    bool IsTracedByScanManager() const {
+        return TraceMode == ELidarTraceMode::Parallel ||
+               TraceMode == ELidarTraceMode::StaticSnapshot;
+    }
+    void AddLidarColumn(FLidarTraceBatch &Batch, const FLidarScanColumn &Column);
+    void TraceLidarBatch(FLidarTraceBatch &Batch);
+    void TraceLidarColumn(FLidarTraceBatch &Batch, int32 ColumnIndex);
+    void UpdateMeasuredRaysPerSecond(int32 NumRays, double TraceSeconds);
+    void QueueAsyncLidarBatch(FLidarTraceBatch &Batch);
+    void CollectAsyncLidarBatch(FLidarTraceBatch &Batch);
+    void TraceStaticSnapshotColumn(FLidarTraceBatch &Batch, int32 ColumnIndex);
+    void TraceLidarBeam(UWorld* World, const FLidarScanColumn &Column, int32 BeamIndex,
+                        const FVector &RayEnd, TArray<FHitResult> &Hits);
+    bool TraceLidarBeamSpan(UWorld* World, const FLidarScanColumn &Column, int32 BeamIndex,
+                            const FVector &SpanStart, const FVector &SpanEnd,
+                            const FVector &RayEnd, TArray<FHitResult> &Hits);
+    void StoreLidarHit(const FLidarScanColumn &Column, int32 BeamIndex, const FHitResult &Hit);
+    void StoreLidarHits(const FLidarScanColumn &Column, int32 BeamIndex,
+                        const TArray<FHitResult> &Hits, const FVector &TraceEnd);
+    float GetTransmittance(const FHitResult &Hit) const;
+    float GetReflectivity(const UPhysicalMaterial* PhysicalMaterial) const;
+    void StoreLidarPoint(const FLidarScanColumn &Column, int32 BeamIndex, bool bBlockingHit,
+                         const FVector &ImpactPoint, const FVector &ImpactNormal, float Distance,
+                         float Reflectivity, const TWeakObjectPtr<UPrimitiveComponent> &Component,
+                         const FVector &TraceEnd);
+    void CacheLidarHit(const FLidarScanColumn &Column, int32 BeamIndex, bool bBlockingHit,
+                       const FVector &ImpactPoint, const FVector &ImpactNormal, float Distance,
+                       float Reflectivity, const TWeakObjectPtr<UPrimitiveComponent> &Component,
+                       bool bMovable);
+    void ReuseCachedHits(FLidarTraceBatch &Batch, int32 ColumnIndex);
+    void UpdateMovedActors();
+    void FinishLidarBatch(FLidarTraceBatch &Batch);
+    void LabelColumns(const FLidarTraceBatch &Batch);
+    FLidarPointLabel GetComponentLabel(const TWeakObjectPtr<UPrimitiveComponent> &Component);
+    FString GetLabelClassName(const AActor* Actor) const;
+    void CompleteRevolution(FLidarPointCloud* Cloud, bool bPublish = true);
+    void PublishRevolution(FLidarPointCloud* Cloud);
+    void WriteRevolutionFile(const FLidarPointCloud &Cloud);
+    void WriteRangeImageFrame(const FLidarPointCloud &Cloud);
+    void WriteRecordingFrame(const FLidarPointCloud &Cloud);
+    void WritePerfReport(int32 Revolution);
+    void WritePerfReportLine(const FString &Line);
+    void WriteLidarPointsToFile(const FLidarTraceBatch &Batch);
+    void WriteVelodynePackets(const FLidarTraceBatch &Batch);
+    void FlushVelodynePackets();
+    void EmitVelodynePacket(TArray<uint8>* PcapBuffer);
+    void VisualizeColumns(const FLidarTraceBatch &Batch);
+    FColor GetVisualPointColor(const FLidarVisualPoint &Point, float Intensity) const;
+    void BuildBeamTable();
+
+    // The beams of each column, with their directions relative to the sensor head
+    FLidarScanPattern ScanPattern;
     FString SaveFilePath;
-    float SimTimeSeconds;
+
+    // The sensor's time base, which fires columns at SimTimeFramerate however long the
+    // simulation runs, and the time between the firings of consecutive beams of a column
+    FLidarFiringClock ScanClock;
+    double BeamFiringIntervalSeconds;
+
+    // Sub-stepping state: the actor pose at the end of the previous tick,
+    // the current azimuth of the sensor head relative to the root,
+    // and the real time in seconds since BeginPlay at the end of the previous tick.
+    FTransform PreviousActorTransform;
+    float ScanAzimuth;
+    double RealTimeStartSeconds;
+    double PreviousRealTimeSeconds;
+
+    // The manager that drives this sensor, and the revolution when the current scan step
+    // began, to spot the ones it completed
+    TWeakObjectPtr<ALidarScanManager> ScanManager;
+    int32 ScanStepStartRevolution;
+
+    // The cached hits of every beam of a revolution, NumBeams per column, the sensor pose of
+    // each column when it was cached, and the movable actors whose moves invalidate them
+    TArray<FLidarCachedHit> CachedHits;
+    TArray<FLidarCachedColumn> CachedColumns;
+    TMap<TWeakObjectPtr<AActor>, FLidarTrackedActor> TrackedActors;
+    TArray<FBox> MovedActorBounds;
+
+    // The batch being built this tick, and in async mode the batch queued on the previous tick
+    FLidarTraceBatch TraceBatch;
+    FLidarTraceBatch PendingAsyncBatch;
+
+    // Revolution tracking: the number of azimuth columns in a full revolution,
+    // the current revolution and how many of its columns have been fired
+    int32 ColumnsPerRevolution;
+    int32 RevolutionIndex;
+    int32 RevolutionColumn;
+
+    // The points stored for each column: NumBeams, or twice that in dual-return mode
+    int32 PointsPerColumn;
+
+    // False under -nullrhi and in commandlets, where nothing is rendered and the points
+    // aren't visualized
+    bool bRendering = true;
+
+    // The column and beam strides that keep a revolution within VisualizationPointBudget, and
+    // the points of the revolution being visualized, handed to the visualizer once complete
+    int32 VisualColumnStride;
+    int32 VisualBeamStride;
+    TArray<FLidarVisualPoint> PendingVisualPoints;
+
+    // The point cloud that columns of the current revolution are added to,
+    // and the pool it and the clouds of later revolutions come from
+    FLidarPointCloud* CurrentCloud;
+    FLidarPointCloudPool PointCloudPool;
+
+    // The most recent complete revolutions handed to consumers, oldest first.
+    // Each goes back to the pool once PublishedRevolutionBuffers newer ones have completed.
+    TArray<FLidarPointCloud*> PublishedClouds;
+
+    // Writes the output file on its own thread, open from BeginPlay until EndPlay
+    TUniquePtr<FLidarOutputWriter> OutputWriter;
+
+    // The labels of the components hit so far, the instance of each actor, and the names
+    // behind them, with the writer of the _labels.csv file
+    TMap<TWeakObjectPtr<UPrimitiveComponent>, FLidarPointLabel> ComponentLabels;
+    TMap<TWeakObjectPtr<AActor>, uint32> ActorInstanceIds;
+    FLidarLabelDictionary LabelDictionary;
+    TUniquePtr<FLidarOutputWriter> LabelWriter;
+
+    // Removes the points that aren't to be written, before they are serialized
+    FLidarPointFilter PointFilter;
+
+    // Formats the CSV rows, reusing its buffer from one batch to the next
+    FLidarCsvWriter CsvWriter;
+
+    // Packs columns into Velodyne packets for the pcap output and the UDP stream
+    FLidarVelodynePacketEncoder VelodynePackets;
+    FLidarUdpSender VelodyneUdpSender;
+
+    // Builds the range image frames, and the buffer each is compressed into
+    FLidarRangeImageEncoder RangeImage;
+    TArray<uint8> RangeImageStorage;
+
+    // Lays out the recording output's frames and index
+    FLidarRecordingEncoder Recording;
+
+    // Hands completed revolutions to other processes
+    FLidarShmRingWriter SharedMemoryRing;
+
+    // The perf report for the current revolution, and the writer for the report file
+    FLidarRevolutionPerf RevolutionPerf;
+    int64 TotalRays = 0;
+    int64 TotalHits = 0;
+    TUniquePtr<FLidarOutputWriter> PerfReportWriter;
+
+    // The return model in the lidar core: dropout, range noise and intensity
+    FLidarSensorModel SensorModel;
+
+    // MaterialReflectivity clamped to 0 to 1, built in BeginPlay for traces on any thread to
+    // look up the physical materials they hit
+    TMap<const UPhysicalMaterial*, float> Reflectivities;
+
+    // Raycasting parameters, built once in BeginPlay and shared by every trace
+    FCollisionQueryParams RaycastParameters;
 
  public:
 #ifdef ConfigurationPluginIncluded
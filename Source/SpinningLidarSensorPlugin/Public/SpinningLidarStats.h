@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+#if __has_include("ProfilingDebugging/CpuProfilerTrace.h")
+#define UnrealInsightsIncluded
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#endif
+
+// Set to 1 to compile in a log line for every lidar point, at VeryVerbose verbosity.
+// With the default of 0 the per-point log statements are compiled out entirely.
+#ifndef SPINNING_LIDAR_POINT_LOGGING
+#define SPINNING_LIDAR_POINT_LOGGING 0
+#endif
+
+#if SPINNING_LIDAR_POINT_LOGGING
+DECLARE_LOG_CATEGORY_EXTERN(LogSpinningLidar, Log, All);
+#else
+DECLARE_LOG_CATEGORY_EXTERN(LogSpinningLidar, Log, Verbose);
+#endif
+
+// "stat SpinningLidar" in the console shows these, and they appear in captured stat files
+DECLARE_STATS_GROUP(TEXT("SpinningLidar"), STATGROUP_SpinningLidar, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tick"), STAT_LidarTick, STATGROUP_SpinningLidar,
+                          SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build rays"), STAT_LidarBuildRays, STATGROUP_SpinningLidar,
+                          SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Raycasts"), STAT_LidarRaycasts, STATGROUP_SpinningLidar,
+                          SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Label points"), STAT_LidarLabels, STATGROUP_SpinningLidar,
+                          SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Randomize returns"), STAT_LidarRandomizeReturns,
+                          STATGROUP_SpinningLidar, SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Range noise"), STAT_LidarRangeNoise, STATGROUP_SpinningLidar,
+                          SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Intensity"), STAT_LidarIntensity, STATGROUP_SpinningLidar,
+                          SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Visualize beams"), STAT_LidarVisualize, STATGROUP_SpinningLidar,
+                          SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Filter points"), STAT_LidarFilter, STATGROUP_SpinningLidar,
+                          SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Serialize"), STAT_LidarSerialize, STATGROUP_SpinningLidar,
+                          SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("File I/O"), STAT_LidarFileIO, STATGROUP_SpinningLidar,
+                          SPINNINGLIDARSENSORPLUGIN_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Rays"), STAT_LidarRays, STATGROUP_SpinningLidar,
+                                  SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hits"), STAT_LidarHits, STATGROUP_SpinningLidar,
+                                  SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Reused hits"), STAT_LidarReusedHits,
+                                  STATGROUP_SpinningLidar, SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Snapshot fallback rays"), STAT_LidarSnapshotFallbackRays,
+                                  STATGROUP_SpinningLidar, SPINNINGLIDARSENSORPLUGIN_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Bytes written"), STAT_LidarBytesWritten,
+                                  STATGROUP_SpinningLidar, SPINNINGLIDARSENSORPLUGIN_API);
+
+// A scoped cycle counter that also shows up as a CPU event in Unreal Insights, where available
+#ifdef UnrealInsightsIncluded
+#define LIDAR_SCOPE_CYCLE_COUNTER(Stat) \
+    SCOPE_CYCLE_COUNTER(Stat); \
+    TRACE_CPUPROFILER_EVENT_SCOPE(Stat)
+#else
+#define LIDAR_SCOPE_CYCLE_COUNTER(Stat) SCOPE_CYCLE_COUNTER(Stat)
+#endif
+
+// Adds the time spent in its scope to a running total in seconds.
+// Unlike the stats above, this works in every build configuration, for the perf report.
+struct FLidarScopedTimer {
+    explicit FLidarScopedTimer(double &InTotalSeconds)
+        : TotalSeconds(InTotalSeconds), StartCycles(FPlatformTime::Cycles64()) {}
+    ~FLidarScopedTimer() {
+        TotalSeconds += FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+    }
+
+ private:
+    double &TotalSeconds;
+    uint64 StartCycles;
+};
@@ -9,6 +9,7 @@ public class SpinningLidarSensorPlugin : ModuleRules
 	public SpinningLidarSensorPlugin(ReadOnlyTargetRules Target) : base(Target)
 	{
 		PCHUsage = ModuleRules.PCHUsageMode.UseExplicitOrSharedPCHs;
+		CppStandard = CppStandardVersion.Cpp17;
 		
 		PublicIncludePaths.AddRange(
 			new string[] {
@@ -29,6 +30,7 @@ public class SpinningLidarSensorPlugin : ModuleRules
 			new string[]
 			{
 				"Core",
+				"SpinningLidarCore",
 				// ... add other public dependencies that you statically link with here ...
 			}
 			);
@@ -39,6 +41,9 @@ public class SpinningLidarSensorPlugin : ModuleRules
 			{
 				"CoreUObject",
 				"Engine",
+				"RenderCore",
+				"Networking",
+				"Sockets",
 				"Slate",
 				"SlateCore",
 				// ... add private dependencies that you statically link with here ...	